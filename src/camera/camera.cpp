@@ -1,11 +1,13 @@
 #include "camera.h"
 #include <cmath>
+std::atomic<uint64_t> Camera::version_counter{0};
+
 Camera::Camera(std::vector<float> pos,std::vector<float> orientation, 
     //std::vector<float> velocity,
     float zoom)
     :
     // velocity(velocity),
-    pos(pos),orientation(orientation),zoom(zoom)
+    pos(pos),orientation(orientation),zoom(zoom),version(++version_counter)
 {
     fov_width_deg=2*std::atan(sensorwidth/(2*zoom*1000))*180/3.14159265359;
     fov_height_deg=2*std::atan(sensorheight/(2*zoom*1000))*180/3.14159265359;
@@ -14,3 +16,15 @@ Camera::Camera(std::vector<float> pos,std::vector<float> orientation,
 Camera::~Camera()
 {
 }
+
+void Camera::set_pos(std::vector<float> new_pos)
+{
+    pos = new_pos;
+    version = ++version_counter;
+}
+
+void Camera::set_orientation(std::vector<float> new_orientation)
+{
+    orientation = new_orientation;
+    version = ++version_counter;
+}
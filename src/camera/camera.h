@@ -2,9 +2,11 @@
 #define CAMERA_H
 
 #include <vector>
+#include <atomic>
+#include <cstdint>
 class Camera{
 private:
-    /* data */
+    static std::atomic<uint64_t> version_counter;
 public:
     std::vector<float> pos; // Now includes z-index
     std::vector<float> orientation;
@@ -15,7 +17,14 @@ public:
     float fov_width_deg;
     float fov_height_deg;
     float zoom;
+    // Changes whenever pos or orientation is set, unique across all cameras.
+    // Renderer caches compare it to know when projected positions are stale.
+    uint64_t version;
     Camera(std::vector<float> pos,std::vector<float> orientation,float zoom);
+    void set_pos(std::vector<float> new_pos);
+    void set_orientation(std::vector<float> new_orientation);
+    // Latest version handed out to any camera, safe to read from other threads.
+    static uint64_t get_latest_version() { return version_counter.load(); }
     ~Camera();
 };
 #endif // CAMERA_H
@@ -0,0 +1,213 @@
+#include "shm_ring.h"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace shm;
+
+namespace {
+size_t align64(size_t v) { return (v + 63) & ~size_t(63); }
+}
+
+uint64_t ShmRing::now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool ShmRing::layout_bytes(uint32_t slot_count, uint64_t slot_bytes, size_t& bytes)
+{
+    const size_t max = SIZE_MAX;
+    if (slot_count == 0 || slot_bytes > max - 63) return false;
+    size_t per_slot = sizeof(SlotHeader) + align64((size_t)slot_bytes);
+    if (per_slot > (max - sizeof(RingHeader)) / slot_count) return false;
+    bytes = sizeof(RingHeader) + per_slot * slot_count;
+    return true;
+}
+
+SlotHeader* ShmRing::slot(uint32_t index) const
+{
+    return reinterpret_cast<SlotHeader*>(reinterpret_cast<uint8_t*>(base) + sizeof(RingHeader)) + index;
+}
+
+uint8_t* ShmRing::payload(uint32_t index) const
+{
+    return reinterpret_cast<uint8_t*>(base) + sizeof(RingHeader) + sizeof(SlotHeader) * slot_count
+         + align64(slot_bytes) * index;
+}
+
+// bytes == 0 maps the whole existing segment
+bool ShmRing::map(const std::string& name, size_t bytes, bool create)
+{
+#ifdef _WIN32
+    os_name = "Local\\" + name;
+    if (create) {
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                     (DWORD)((uint64_t)bytes >> 32), (DWORD)(bytes & 0xffffffffu), os_name.c_str());
+    } else {
+        mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, os_name.c_str());
+    }
+    if (!mapping) return false;
+    base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    if (!base) return false;
+    if (!bytes) {
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery(base, &info, sizeof(info));
+        bytes = info.RegionSize;
+    }
+#else
+    os_name = "/" + name;
+    int fd;
+    if (create) {
+        shm_unlink(os_name.c_str()); // stale segment of a crashed producer
+        fd = shm_open(os_name.c_str(), O_CREAT | O_RDWR, 0600);
+        if (fd >= 0 && ftruncate(fd, (off_t)bytes) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        fd = shm_open(os_name.c_str(), O_RDWR, 0600);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0) bytes = (size_t)st.st_size;
+    }
+    if (fd < 0) return false;
+    void* p = bytes ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (p == MAP_FAILED) return false;
+    base = p;
+#endif
+    mapped_bytes = bytes;
+    header = reinterpret_cast<RingHeader*>(base);
+    owner = create;
+    return true;
+}
+
+std::unique_ptr<ShmRing> ShmRing::create(const std::string& name, uint32_t slot_count, size_t slot_bytes)
+{
+    std::unique_ptr<ShmRing> ring(new ShmRing());
+    size_t bytes = 0;
+    if (!layout_bytes(slot_count, slot_bytes, bytes) || !ring->map(name, bytes, true)) {
+        std::cerr << "Could not create shared memory ring " << name << std::endl;
+        return nullptr;
+    }
+    std::memset(ring->base, 0, bytes);
+    RingHeader& h = *ring->header;
+    h.slot_count = slot_count;
+    h.slot_bytes = slot_bytes;
+    h.version = VERSION;
+    ring->slot_count = slot_count;
+    ring->slot_bytes = slot_bytes;
+    // Readers check the magic last
+    std::atomic_thread_fence(std::memory_order_release);
+    h.magic = MAGIC;
+    return ring;
+}
+
+std::unique_ptr<ShmRing> ShmRing::open(const std::string& name)
+{
+    std::unique_ptr<ShmRing> ring(new ShmRing());
+    if (!ring->map(name, 0, false)) return nullptr;
+    const RingHeader& h = *ring->header;
+    if (ring->mapped_bytes < sizeof(RingHeader) || h.magic == 0) return nullptr; // producer still initializing
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Read once: the producer could rewrite the header later, everything after this point
+    // uses the checked copies
+    uint32_t slot_count = h.slot_count;
+    uint64_t slot_bytes = h.slot_bytes;
+    size_t bytes = 0;
+    if (h.magic != MAGIC || h.version != VERSION || !layout_bytes(slot_count, slot_bytes, bytes)
+        || ring->mapped_bytes < bytes) {
+        std::cerr << "Shared memory ring " << name << " has an unknown layout" << std::endl;
+        return nullptr;
+    }
+    ring->slot_count = slot_count;
+    ring->slot_bytes = slot_bytes;
+    return ring;
+}
+
+ShmRing::~ShmRing()
+{
+#ifdef _WIN32
+    if (base) UnmapViewOfFile(base);
+    if (mapping) CloseHandle(mapping);
+#else
+    if (base) munmap(base, mapped_bytes);
+    if (owner) shm_unlink(os_name.c_str());
+#endif
+}
+
+void* ShmRing::begin_write(uint64_t frame)
+{
+    SlotHeader* s = slot((uint32_t)(frame % slot_count));
+    uint32_t seq = s->seq.load(std::memory_order_relaxed);
+    s->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return payload((uint32_t)(frame % slot_count));
+}
+
+void ShmRing::end_write(uint64_t frame, const FrameInfo& info)
+{
+    SlotHeader* s = slot((uint32_t)(frame % slot_count));
+    s->type = info.type;
+    s->frame = frame;
+    s->count = info.count;
+    s->width = info.width;
+    s->height = info.height;
+    s->stride = info.stride;
+    s->format = info.format;
+    s->write_ns = now_ns();
+    s->seq.store(s->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    header->latest.store(frame + 1, std::memory_order_release);
+}
+
+bool ShmRing::acquire(FrameView& view) const
+{
+    uint64_t latest = header->latest.load(std::memory_order_acquire);
+    if (latest == 0) return false;
+    uint32_t index = (uint32_t)((latest - 1) % slot_count);
+    const SlotHeader* s = slot(index);
+    uint32_t seq = s->seq.load(std::memory_order_acquire);
+    if (seq & 1) return false;
+    view.type = (PayloadType)s->type;
+    view.frame = s->frame;
+    view.write_ns = s->write_ns;
+    view.count = s->count;
+    view.width = s->width;
+    view.height = s->height;
+    view.stride = s->stride;
+    view.format = (PixelFormat)s->format;
+    view.seq = seq;
+    view.slot = index;
+    view.payload = payload(index);
+    if (!validate(view)) return false;
+
+    // Never trust sizes coming from another process
+    uint64_t need = 0;
+    if (view.type == PAYLOAD_POINTS) need = (uint64_t)view.count * sizeof(PointRecord);
+    else if (view.type == PAYLOAD_PIXELS) need = (uint64_t)view.stride * view.height;
+    if (need > slot_bytes) return false;
+    if (view.type == PAYLOAD_PIXELS && (format_bytes(view.format) == 0 || view.stride < (uint64_t)view.width * format_bytes(view.format))) return false;
+    return true;
+}
+
+bool ShmRing::validate(const FrameView& view) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot(view.slot)->seq.load(std::memory_order_relaxed) == view.seq;
+}
+
+void ShmRing::report_presented(const FrameView& view)
+{
+    header->presented_write_ns.store(view.write_ns, std::memory_order_relaxed);
+    header->presented_ns.store(now_ns(), std::memory_order_relaxed);
+    header->presented_frame.store(view.frame + 1, std::memory_order_release);
+}
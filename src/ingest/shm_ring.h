@@ -0,0 +1,145 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Frame ring in shared memory, written by an external producer process and read by the
+// display without copying or parsing: the renderer projects points / uploads pixels straight
+// out of the mapping.
+//
+// Layout: RingHeader | SlotHeader[slot_count] | payload[slot_count] (slot_bytes each, 64 aligned)
+// Frame f goes to slot f % slot_count. Every slot is guarded by a seqlock: the producer makes
+// seq odd, writes header fields and payload, then makes seq even again and publishes the frame
+// in RingHeader::latest. A reader remembers seq when it picks up a frame and checks it again
+// after using the payload; a changed value means the producer lapped the ring meanwhile and
+// what was read may be torn, so the frame is dropped.
+namespace shm {
+
+constexpr uint32_t MAGIC = 0x53444256;   // "VBDS"
+constexpr uint32_t VERSION = 1;
+
+enum PayloadType : uint32_t {
+    PAYLOAD_NONE = 0,
+    PAYLOAD_POINTS = 1,     // count PointRecords
+    PAYLOAD_PIXELS = 2,     // height rows of stride bytes, format below
+};
+
+// Same values as the renderer's PixelFormat.
+enum PixelFormat : uint32_t {
+    PIXEL_RGBA8 = 0,
+    PIXEL_BGRA8 = 1,
+    PIXEL_RGB8 = 2,
+    PIXEL_MONO8 = 3,
+    PIXEL_MONO16 = 4,
+};
+
+inline uint32_t format_bytes(uint32_t format) {
+    static const uint32_t bytes[] = {4, 4, 3, 1, 2};
+    return format < 5 ? bytes[format] : 0;
+}
+
+struct PointRecord {
+    float pos[3];
+    uint8_t color[4];       // rgb + unused
+};
+static_assert(sizeof(PointRecord) == 16, "PointRecord is part of the wire format");
+
+struct alignas(64) SlotHeader {
+    std::atomic<uint32_t> seq;
+    uint32_t type;
+    uint64_t frame;
+    uint64_t write_ns;      // ShmRing::now_ns() when the producer finished the frame
+    uint32_t count;
+    uint32_t width, height, stride, format;
+};
+
+struct alignas(64) RingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t reserved;
+    uint64_t slot_bytes;
+    std::atomic<uint64_t> latest;           // newest complete frame + 1, 0 = none yet
+    // Written by the display after the swap that showed a frame, for latency measurements
+    std::atomic<uint64_t> presented_frame;  // frame + 1
+    std::atomic<uint64_t> presented_write_ns;
+    std::atomic<uint64_t> presented_ns;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory atomics must be lock free");
+
+// Header fields the producer sets for a frame.
+struct FrameInfo {
+    PayloadType type = PAYLOAD_NONE;
+    uint32_t count = 0;
+    uint32_t width = 0, height = 0, stride = 0;
+    PixelFormat format = PIXEL_RGBA8;
+};
+
+// A frame picked up by the reader: a copy of its header fields plus a pointer into the mapping.
+struct FrameView {
+    PayloadType type = PAYLOAD_NONE;
+    uint64_t frame = 0;
+    uint64_t write_ns = 0;
+    uint32_t seq = 0;
+    uint32_t slot = 0;
+    uint32_t count = 0;
+    uint32_t width = 0, height = 0, stride = 0;
+    PixelFormat format = PIXEL_RGBA8;
+    const void* payload = nullptr;
+};
+
+} // namespace shm
+
+class ShmRing {
+public:
+    // Producer: creates the segment (replacing a stale one with the same name).
+    static std::unique_ptr<ShmRing> create(const std::string& name, uint32_t slot_count, size_t slot_bytes);
+    // Reader: maps an existing segment. Returns nullptr if there is none or it does not match.
+    static std::unique_ptr<ShmRing> open(const std::string& name);
+    ~ShmRing();
+
+    // Producer: returns the payload of frame's slot (slot_bytes large) with its seqlock taken.
+    void* begin_write(uint64_t frame);
+    // Producer: fills the slot header, releases the seqlock and publishes frame.
+    void end_write(uint64_t frame, const shm::FrameInfo& info);
+
+    // Reader: newest complete frame. False if there is none or its slot is being rewritten.
+    bool acquire(shm::FrameView& view) const;
+    // Reader: true if the view's payload was not touched since acquire.
+    bool validate(const shm::FrameView& view) const;
+    // Reader: records that view is on screen now.
+    void report_presented(const shm::FrameView& view);
+
+    size_t get_slot_bytes() const { return (size_t)slot_bytes; }
+    uint32_t get_slot_count() const { return slot_count; }
+    shm::RingHeader& get_header() { return *header; }
+
+    // Monotonic clock shared by all processes on the machine (steady_clock).
+    static uint64_t now_ns();
+
+private:
+    ShmRing() = default;
+    bool map(const std::string& name, size_t bytes, bool create);
+    // False for zero slots or a layout that does not fit in size_t.
+    static bool layout_bytes(uint32_t slot_count, uint64_t slot_bytes, size_t& bytes);
+    shm::SlotHeader* slot(uint32_t index) const;
+    uint8_t* payload(uint32_t index) const;
+
+    shm::RingHeader* header = nullptr;
+    uint32_t slot_count = 0;    // copied from the header when the ring was created or opened
+    uint64_t slot_bytes = 0;
+    void* base = nullptr;
+    size_t mapped_bytes = 0;
+    bool owner = false;
+    std::string os_name;
+#ifdef _WIN32
+    void* mapping = nullptr;
+#endif
+};
+
+#endif // SHM_RING_H
@@ -0,0 +1,343 @@
+#include "file_reader.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+uint8_t* aligned_alloc_bytes(size_t bytes) {
+#ifdef _WIN32
+    return static_cast<uint8_t*>(_aligned_malloc(bytes, FileReader::ALIGNMENT));
+#else
+    void* p = nullptr;
+    return posix_memalign(&p, FileReader::ALIGNMENT, bytes) == 0 ? static_cast<uint8_t*>(p) : nullptr;
+#endif
+}
+
+void aligned_free_bytes(uint8_t* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+size_t round_up(size_t v, size_t a) { return (v + a - 1) / a * a; }
+}
+
+#ifdef __linux__
+// Minimal io_uring over the raw syscalls (no liburing dependency): one submission and one
+// completion ring, the caller keeps at most `entries` requests in flight.
+struct FileReader::Uring {
+    int fd = -1;
+    bool fixed_buffers = false;
+    void* sq_ring = MAP_FAILED;
+    void* cq_ring = MAP_FAILED;
+    size_t sq_ring_bytes = 0, cq_ring_bytes = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_bytes = 0;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    io_uring_cqe* cqes;
+    unsigned pending_submit = 0;
+
+    static std::unique_ptr<Uring> create(unsigned entries, const std::vector<uint8_t*>& buffers, size_t buffer_bytes) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+        if (fd < 0) return nullptr; // ENOSYS, EPERM under seccomp, ...
+        auto ring = std::make_unique<Uring>();
+        ring->fd = fd;
+        ring->sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) ring->sq_ring_bytes = ring->cq_ring_bytes = std::max(ring->sq_ring_bytes, ring->cq_ring_bytes);
+        ring->sq_ring = mmap(nullptr, ring->sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (ring->sq_ring == MAP_FAILED) return nullptr;
+        ring->cq_ring = single ? ring->sq_ring
+                               : mmap(nullptr, ring->cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) return nullptr;
+        ring->sqes_bytes = params.sq_entries * sizeof(io_uring_sqe);
+        ring->sqes = static_cast<io_uring_sqe*>(mmap(nullptr, ring->sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (ring->sqes == MAP_FAILED) return nullptr;
+
+        uint8_t* sq = static_cast<uint8_t*>(ring->sq_ring);
+        uint8_t* cq = static_cast<uint8_t*>(ring->cq_ring);
+        ring->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        ring->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        ring->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // Registered buffers save the per read page pinning; needs enough RLIMIT_MEMLOCK
+        std::vector<iovec> iovs(buffers.size());
+        for (size_t i = 0; i < buffers.size(); ++i) iovs[i] = {buffers[i], buffer_bytes};
+        ring->fixed_buffers = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iovs.data(), (unsigned)iovs.size()) == 0;
+        return ring;
+    }
+
+    ~Uring() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqes_bytes);
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring) munmap(cq_ring, cq_ring_bytes);
+        if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_bytes);
+        if (fd >= 0) close(fd);
+    }
+
+    void queue_read(int file_fd, uint8_t* buffer, unsigned buffer_index, size_t length, uint64_t offset, uint64_t user_data) {
+        unsigned tail = *sq_tail;
+        unsigned index = tail & *sq_mask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = file_fd;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer);
+        sqe->len = (uint32_t)length;
+        sqe->off = offset;
+        sqe->buf_index = (uint16_t)buffer_index;
+        sqe->user_data = user_data;
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        pending_submit++;
+    }
+
+    // Submits what was queued and waits until at least one completion is available.
+    bool submit_and_wait() {
+        for (;;) {
+            int r = (int)syscall(__NR_io_uring_enter, fd, pending_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (r >= 0) {
+                pending_submit -= std::min<unsigned>(pending_submit, (unsigned)r);
+                return true;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) return false;
+        }
+    }
+
+    template <typename Fn>
+    void reap(Fn&& fn) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes[head & *cq_mask];
+            fn(cqe.user_data, cqe.res);
+            head++;
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+};
+#else
+struct FileReader::Uring {};
+#endif
+
+FileReader::FileReader(size_t chunk_bytes, unsigned queue_depth, Backend preferred)
+    : chunk_bytes(round_up(std::max<size_t>(chunk_bytes, ALIGNMENT), ALIGNMENT)),
+      queue_depth(std::max(1u, queue_depth))
+{
+    const char* env = std::getenv("VBD_IO_BACKEND");
+    if (env && std::strcmp(env, "blocking") == 0) preferred = BLOCKING;
+    unsigned buffer_count = preferred == IO_URING ? this->queue_depth : 1;
+    for (unsigned i = 0; i < buffer_count; ++i) {
+        uint8_t* buffer = aligned_alloc_bytes(this->chunk_bytes);
+        if (!buffer) throw std::runtime_error("FileReader: out of memory for read buffers");
+        buffers.push_back(buffer);
+    }
+#ifdef __linux__
+    if (preferred == IO_URING) uring = Uring::create(this->queue_depth, buffers, this->chunk_bytes);
+#endif
+}
+
+FileReader::~FileReader()
+{
+    uring.reset();
+    for (uint8_t* buffer : buffers) aligned_free_bytes(buffer);
+}
+
+const char* FileReader::get_backend_name() const
+{
+#ifdef __linux__
+    if (uring) return uring->fixed_buffers ? "io_uring (registered buffers)" : "io_uring";
+#endif
+    return "blocking";
+}
+
+std::vector<FileReader::FileResult> FileReader::read(const std::vector<std::string>& paths, const ChunkCallback& on_chunk)
+{
+    return uring ? read_uring(paths, on_chunk) : read_blocking(paths, on_chunk);
+}
+
+std::vector<FileReader::FileResult> FileReader::read_blocking(const std::vector<std::string>& paths, const ChunkCallback& on_chunk)
+{
+    std::vector<FileResult> results(paths.size());
+    for (size_t f = 0; f < paths.size(); ++f) {
+        std::FILE* file = std::fopen(paths[f].c_str(), "rb");
+        if (!file) {
+            results[f].error = std::strerror(errno);
+            continue;
+        }
+        uint64_t offset = 0;
+        size_t got;
+        while ((got = std::fread(buffers[0], 1, chunk_bytes, file)) > 0) {
+            on_chunk(f, offset, buffers[0], got);
+            offset += got;
+        }
+        results[f].size = offset;
+        results[f].ok = !std::ferror(file);
+        if (!results[f].ok) results[f].error = "read error";
+        std::fclose(file);
+    }
+    return results;
+}
+
+#ifdef __linux__
+std::vector<FileReader::FileResult> FileReader::read_uring(const std::vector<std::string>& paths, const ChunkCallback& on_chunk)
+{
+    struct FileState {
+        int fd = -1;
+        bool direct = false;
+        uint64_t size = 0, next = 0, delivered = 0;
+        int inflight = 0;
+        bool failed = false;
+    };
+    struct Range {
+        size_t file;
+        uint64_t offset;
+        size_t length;
+    };
+    std::vector<FileResult> results(paths.size());
+    std::vector<FileState> files(paths.size());
+    std::vector<Range> in_buffer(buffers.size());
+    std::vector<unsigned> free_buffers;
+    for (unsigned i = buffers.size(); i-- > 0;) free_buffers.push_back(i);
+    std::deque<Range> retries;   // remainders of short reads
+    size_t cursor = 0;           // next file to hand out ranges of; at most queue_depth files are open
+    int inflight = 0;
+
+    auto finish_if_done = [&](size_t f) {
+        FileState& s = files[f];
+        if (s.inflight > 0 || (!s.failed && s.delivered < s.size)) return;
+        if (s.fd >= 0) close(s.fd);
+        s.fd = -1;
+        results[f].ok = !s.failed;
+    };
+    auto fail = [&](size_t f, int error) {
+        if (!files[f].failed) results[f].error = std::strerror(error);
+        files[f].failed = true;
+    };
+    auto next_range = [&](Range& r) -> bool {
+        while (!retries.empty()) {
+            r = retries.front();
+            retries.pop_front();
+            if (!files[r.file].failed) return true;
+        }
+        while (cursor < files.size()) {
+            FileState& s = files[cursor];
+            if (s.fd < 0 && !s.failed && s.next == 0) {
+                s.fd = direct ? open(paths[cursor].c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC) : -1;
+                s.direct = s.fd >= 0;
+                if (s.fd < 0) s.fd = open(paths[cursor].c_str(), O_RDONLY | O_CLOEXEC); // e.g. tmpfs has no O_DIRECT
+                struct stat st;
+                if (s.fd < 0 || fstat(s.fd, &st) != 0) fail(cursor, errno);
+                else results[cursor].size = s.size = st.st_size;
+            }
+            if (!s.failed && s.next < s.size) {
+                r = {cursor, s.next, (size_t)std::min<uint64_t>(chunk_bytes, s.size - s.next)};
+                s.next += r.length;
+                return true;
+            }
+            finish_if_done(cursor);
+            cursor++;
+        }
+        return false;
+    };
+
+    for (;;) {
+        Range r;
+        while (!free_buffers.empty() && next_range(r)) {
+            unsigned b = free_buffers.back();
+            free_buffers.pop_back();
+            in_buffer[b] = r;
+            FileState& s = files[r.file];
+            // O_DIRECT wants whole blocks, the read simply stops at the end of the file
+            size_t length = s.direct ? round_up(r.length, ALIGNMENT) : r.length;
+            uring->queue_read(s.fd, buffers[b], b, length, r.offset, b);
+            s.inflight++;
+            inflight++;
+        }
+        if (inflight == 0) break;
+        if (!uring->submit_and_wait()) throw std::runtime_error(std::string("io_uring_enter: ") + std::strerror(errno));
+        uring->reap([&](uint64_t user_data, int res) {
+            unsigned b = (unsigned)user_data;
+            Range done = in_buffer[b];
+            FileState& s = files[done.file];
+            s.inflight--;
+            inflight--;
+            if (res < 0) {
+                fail(done.file, -res);
+            } else if (res == 0) {
+                fail(done.file, EIO); // file shrank while reading
+            } else if (!s.failed) {
+                size_t got = std::min<size_t>(res, done.length);
+                on_chunk(done.file, done.offset, buffers[b], got);
+                s.delivered += got;
+                if (got < done.length) retries.push_back({done.file, done.offset + got, done.length - got});
+            }
+            free_buffers.push_back(b);
+            finish_if_done(done.file);
+        });
+    }
+    return results;
+}
+#else
+std::vector<FileReader::FileResult> FileReader::read_uring(const std::vector<std::string>& paths, const ChunkCallback& on_chunk)
+{
+    return read_blocking(paths, on_chunk);
+}
+#endif
+
+std::vector<std::string> FileReader::read_all(const std::vector<std::string>& paths, std::vector<FileResult>* results)
+{
+    std::vector<std::string> texts(paths.size());
+    for (size_t f = 0; f < paths.size(); ++f) {
+        std::error_code ec;
+        uintmax_t size = std::filesystem::file_size(paths[f], ec);
+        if (!ec) texts[f].resize(size);
+    }
+    std::vector<FileResult> r = read(paths, [&](size_t f, uint64_t offset, const uint8_t* data, size_t size) {
+        if (offset + size > texts[f].size()) texts[f].resize(offset + size); // grew since file_size
+        std::memcpy(&texts[f][offset], data, size);
+    });
+    for (size_t f = 0; f < paths.size(); ++f) {
+        if (!r[f].ok) texts[f].clear();
+        else texts[f].resize(r[f].size);
+    }
+    if (results) *results = std::move(r);
+    return texts;
+}
+
+std::string FileReader::read_file(const std::string& path)
+{
+    FileReader reader(1 << 20, 4);
+    std::vector<FileResult> results;
+    std::vector<std::string> texts = reader.read_all({path}, &results);
+    if (!results[0].ok) throw std::runtime_error("Failed to read " + path + ": " + results[0].error);
+    return std::move(texts[0]);
+}
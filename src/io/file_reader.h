@@ -0,0 +1,62 @@
+#ifndef FILE_READER_H
+#define FILE_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Batched file reading for assets and scans. On Linux the reads go through io_uring: up to
+// queue_depth chunk reads over all files are in flight at once, into registered buffers
+// (IORING_OP_READ_FIXED) and with O_DIRECT where the file system allows it, so the kernel
+// skips the page cache copy. Without io_uring (other platforms, old kernels, seccomp) or with
+// VBD_IO_BACKEND=blocking the same interface reads one chunk after the other.
+class FileReader {
+public:
+    enum Backend { BLOCKING, IO_URING };
+
+    // Chunks of a file may arrive in any order and interleaved with other files. data is
+    // ALIGNMENT aligned and only valid until the callback returns.
+    using ChunkCallback = std::function<void(size_t file, uint64_t offset, const uint8_t* data, size_t size)>;
+
+    struct FileResult {
+        uint64_t size = 0;
+        bool ok = false;
+        std::string error;
+    };
+
+    static constexpr size_t ALIGNMENT = 4096;
+
+    // chunk_bytes is rounded up to ALIGNMENT. queue_depth buffers of that size are allocated.
+    explicit FileReader(size_t chunk_bytes = 1 << 20, unsigned queue_depth = 32, Backend preferred = IO_URING);
+    ~FileReader();
+
+    // Reads every file completely, calling on_chunk for each piece. Returns per file results.
+    std::vector<FileResult> read(const std::vector<std::string>& paths, const ChunkCallback& on_chunk);
+    // Reads whole files into strings. Failed files stay empty, see results.
+    std::vector<std::string> read_all(const std::vector<std::string>& paths, std::vector<FileResult>* results = nullptr);
+    // One file, throws std::runtime_error if it can't be read.
+    static std::string read_file(const std::string& path);
+
+    Backend get_backend() const { return uring ? IO_URING : BLOCKING; }
+    const char* get_backend_name() const;
+    size_t get_chunk_bytes() const { return chunk_bytes; }
+    // O_DIRECT for io_uring reads (default on). Off keeps files in the page cache.
+    void set_direct(bool enabled) { direct = enabled; }
+
+private:
+    struct Uring;
+
+    std::vector<FileResult> read_blocking(const std::vector<std::string>& paths, const ChunkCallback& on_chunk);
+    std::vector<FileResult> read_uring(const std::vector<std::string>& paths, const ChunkCallback& on_chunk);
+
+    size_t chunk_bytes;
+    unsigned queue_depth;
+    bool direct = true;
+    std::vector<uint8_t*> buffers;
+    std::unique_ptr<Uring> uring;
+};
+
+#endif // FILE_READER_H
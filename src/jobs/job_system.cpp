@@ -0,0 +1,222 @@
+#include "job_system.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+thread_local JobSystem* tls_owner = nullptr;
+thread_local int tls_worker = -1;
+
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+JobSystem::JobSystem(int worker_count)
+{
+    if (worker_count < 0) {
+        const char* env = std::getenv("VBD_JOB_THREADS");
+        if (env) worker_count = std::atoi(env);
+        else worker_count = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    }
+    for (int i = 0; i < worker_count + 1; ++i) queues.push_back(std::make_unique<WorkerQueue>());
+    for (int i = 0; i < worker_count; ++i) workers.emplace_back(&JobSystem::worker_loop, this, i);
+    std::cout << "Job system: " << worker_count << " workers" << std::endl;
+}
+
+JobSystem::~JobSystem()
+{
+    stopping = true;
+    wake.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+JobSystem& JobSystem::global()
+{
+    static JobSystem instance;
+    return instance;
+}
+
+void JobSystem::set_profiler(Profiler p)
+{
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    profiler = p ? std::make_shared<Profiler>(std::move(p)) : nullptr;
+}
+
+JobSystem::JobHandle JobSystem::run(const char* name, std::function<void()> fn, const std::vector<JobHandle>& dependencies)
+{
+    auto task = std::make_shared<Task>();
+    task->name = name;
+    task->fn = std::move(fn);
+    task->pending = (int)dependencies.size() + 1;
+    for (const auto& dep : dependencies) {
+        std::lock_guard<std::mutex> lock(dep->continuation_mutex);
+        if (dep->done) task->pending--;
+        else dep->continuations.push_back(task);
+    }
+    // Drop the submission reference; whoever brings pending to zero schedules the task
+    if (--task->pending == 0) schedule(task);
+    return task;
+}
+
+void JobSystem::schedule(const JobHandle& task)
+{
+    if (workers.empty()) {
+        execute(task);
+        return;
+    }
+    // Workers push to their own deque, everyone else to the injection queue
+    WorkerQueue& q = (tls_owner == this && tls_worker >= 0) ? *queues[tls_worker] : *queues.back();
+    {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(task);
+    }
+    queued++;
+    wake.notify_one();
+}
+
+JobSystem::JobHandle JobSystem::pop_task()
+{
+    int self = (tls_owner == this) ? tls_worker : -1;
+    if (self >= 0) {
+        WorkerQueue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            JobHandle t = own.tasks.back();
+            own.tasks.pop_back();
+            queued--;
+            return t;
+        }
+    }
+    // Steal the oldest task, starting after ourselves so victims are spread out
+    int n = (int)queues.size();
+    int start = self >= 0 ? self + 1 : 0;
+    for (int k = 0; k < n; ++k) {
+        WorkerQueue& victim = *queues[(start + k) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            JobHandle t = victim.tasks.front();
+            victim.tasks.pop_front();
+            queued--;
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+bool JobSystem::try_run_one()
+{
+    JobHandle task = pop_task();
+    if (!task) return false;
+    execute(task);
+    return true;
+}
+
+void JobSystem::execute(const JobHandle& task)
+{
+    // Queued but already run by a waiter
+    if (task->started.exchange(true)) return;
+    std::shared_ptr<Profiler> hook;
+    {
+        std::lock_guard<std::mutex> lock(profiler_mutex);
+        hook = profiler;
+    }
+    uint64_t start = hook ? now_ns() : 0;
+    try {
+        task->fn();
+    } catch (...) {
+        task->error = std::current_exception();
+    }
+    if (hook) (*hook)(task->name, tls_owner == this ? tls_worker : -1, start, now_ns());
+    complete(task);
+}
+
+void JobSystem::complete(const JobHandle& task)
+{
+    std::vector<JobHandle> ready;
+    {
+        std::lock_guard<std::mutex> lock(task->continuation_mutex);
+        task->done = true;
+        ready.swap(task->continuations);
+    }
+    task->finished.notify_all();
+    for (const auto& next : ready) {
+        if (--next->pending == 0) schedule(next);
+    }
+}
+
+void JobSystem::wait(const JobHandle& job)
+{
+    // Scheduled and not picked up yet: run it here, the queue entry is skipped later
+    if (job->pending == 0 && !job->started) execute(job);
+    {
+        std::unique_lock<std::mutex> lock(job->continuation_mutex);
+        job->finished.wait(lock, [&] { return job->done.load(); });
+    }
+    if (job->error) std::rethrow_exception(job->error);
+}
+
+void JobSystem::worker_loop(int index)
+{
+    tls_owner = this;
+    tls_worker = index;
+    while (!stopping) {
+        if (try_run_one()) continue;
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        // Timed wait: a missed notify only costs a millisecond
+        wake.wait_for(lock, std::chrono::milliseconds(1), [&] { return stopping || queued > 0; });
+    }
+}
+
+void JobSystem::parallel_for(const char* name, size_t begin, size_t end,
+                             const std::function<void(size_t, size_t)>& body, size_t min_grain)
+{
+    if (end <= begin) return;
+    size_t n = end - begin;
+    // ~4 chunks per thread balances claiming overhead against load imbalance
+    size_t grain = std::max<size_t>(std::max<size_t>(min_grain, 1), n / ((workers.size() + 1) * 4));
+    if (workers.empty() || n <= grain) {
+        body(begin, end);
+        return;
+    }
+
+    // Shared with the helper tasks, which may start after this call returned: a late helper
+    // finds no chunk left and never touches body
+    struct Range {
+        const std::function<void(size_t, size_t)>* body;
+        size_t begin, end, grain, chunks;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> finished{0};
+        std::mutex error_mutex;
+        std::exception_ptr first_error;
+
+        void drain() {
+            size_t c;
+            while ((c = next++) < chunks) {
+                size_t b = begin + c * grain;
+                try {
+                    (*body)(b, std::min(end, b + grain));
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!first_error) first_error = std::current_exception();
+                }
+                finished++;
+            }
+        }
+    };
+    auto range = std::make_shared<Range>();
+    range->body = &body;
+    range->begin = begin;
+    range->end = end;
+    range->grain = grain;
+    range->chunks = (n + grain - 1) / grain;
+
+    size_t helpers = std::min(workers.size(), range->chunks - 1);
+    for (size_t i = 0; i < helpers; ++i) run(name, [range] { range->drain(); });
+    range->drain();
+    // Every chunk is claimed, the ones still running are on threads that are already at it
+    while (range->finished < range->chunks) std::this_thread::yield();
+    if (range->first_error) std::rethrow_exception(range->first_error);
+}
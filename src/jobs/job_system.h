@@ -0,0 +1,89 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing scheduler shared by the loader, physics and render preparation.
+// Every worker owns a deque: it pushes and pops at the back, idle workers steal from the
+// front of other deques, so the oldest pieces of work migrate. Threads that are not workers
+// submit into a shared injection queue.
+// Waiting never runs unrelated tasks: wait() runs the awaited task itself when nobody has
+// started it yet, parallel_for drains its own chunks. A frame loop blocked on a parallel_for
+// therefore never ends up inside an asset load or a BVH build that happened to be queued.
+class JobSystem {
+public:
+    struct Task {
+        const char* name = "task";
+        std::function<void()> fn;
+        std::atomic<int> pending{1};       // unfinished dependencies + 1 until submitted
+        std::atomic<bool> started{false};  // claimed by a worker or by a waiter, runs once
+        std::atomic<bool> done{false};
+        std::mutex continuation_mutex;
+        std::condition_variable finished;
+        std::vector<std::shared_ptr<Task>> continuations;
+        std::exception_ptr error;
+    };
+    using JobHandle = std::shared_ptr<Task>;
+    // Called once per executed task, worker is -1 for tasks run by a non-worker thread.
+    using Profiler = std::function<void(const char* name, int worker, uint64_t start_ns, uint64_t end_ns)>;
+
+    // worker_count < 0: one worker per hardware thread minus the caller,
+    // overridable with the VBD_JOB_THREADS environment variable. 0 runs everything inline.
+    explicit JobSystem(int worker_count = -1);
+    ~JobSystem();
+
+    // Process wide scheduler, created on first use.
+    static JobSystem& global();
+
+    // Schedules fn once all dependencies have finished.
+    JobHandle run(const char* name, std::function<void()> fn, const std::vector<JobHandle>& dependencies = {});
+    // Continuation: fn runs after before has finished.
+    JobHandle then(const JobHandle& before, const char* name, std::function<void()> fn) { return run(name, std::move(fn), {before}); }
+    // Blocks until job has finished, running it on the calling thread if no worker has started it.
+    // Rethrows the task's exception.
+    void wait(const JobHandle& job);
+
+    // Calls body(chunk_begin, chunk_end) over [begin, end). The range is cut into chunks of the
+    // grain size, which adapts to range length and worker count but is never below min_grain;
+    // the caller and helper tasks claim chunks from a shared counter until none are left.
+    // Returns when all chunks are done; rethrows the first exception.
+    void parallel_for(const char* name, size_t begin, size_t end,
+                      const std::function<void(size_t, size_t)>& body, size_t min_grain = 1);
+
+    int get_worker_count() const { return (int)workers.size(); }
+    void set_profiler(Profiler profiler);
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<JobHandle> tasks;
+    };
+
+    void worker_loop(int index);
+    void schedule(const JobHandle& task);
+    void execute(const JobHandle& task);
+    void complete(const JobHandle& task);
+    bool try_run_one();
+    JobHandle pop_task();
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;   // one per worker + injection queue at the end
+    std::atomic<bool> stopping{false};
+    std::atomic<int> queued{0};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::mutex profiler_mutex;
+    std::shared_ptr<Profiler> profiler;
+};
+
+#endif // JOB_SYSTEM_H
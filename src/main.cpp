@@ -18,9 +18,67 @@
 #include "camera/camera.h"
 #include <filesystem>
 #include "scene/scene.h"
+#include "pipeline/frame_pipeline.h"
+#include "pipeline/frame_pacer.h"
+#include "pipeline/input_recording.h"
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <vector>
 
 //#include <SDL_mouse_c.h"
 
+// Test image for --pixel-test: a bar sweeping over a gradient. Only the columns the bar
+// leaves and enters are rewritten and marked dirty, like a producer updating part of a frame.
+struct PixelTest {
+    int width = 0, height = 0;
+    PixelFormat format = PIXEL_RGBA8;
+    std::vector<uint8_t> pixels;
+    int bar = -1;
+    PixelRect dirty[2];
+};
+
+static void paint_pixel_test(PixelTest& t, const PixelRect& r, bool bar) {
+    size_t px = pixel_bytes(t.format);
+    for (int y = r.y; y < r.y + r.height; ++y) {
+        uint8_t* row = t.pixels.data() + (size_t)y * t.width * px;
+        for (int x = r.x; x < r.x + r.width; ++x) {
+            uint8_t c[4] = {(uint8_t)(x * 255 / t.width), (uint8_t)(y * 255 / t.height), (uint8_t)((x ^ y) & 0xff), 255};
+            if (bar) c[0] = c[1] = c[2] = 255;
+            uint8_t* p = row + x * px;
+            switch (t.format) {
+                case PIXEL_BGRA8: p[0] = c[2]; p[1] = c[1]; p[2] = c[0]; p[3] = 255; break;
+                case PIXEL_MONO8: p[0] = c[0]; break;
+                case PIXEL_MONO16: { uint16_t v = c[0] * 257; std::memcpy(p, &v, 2); break; }
+                default: std::memcpy(p, c, px); break; // rgba8, rgb8
+            }
+        }
+    }
+}
+
+static PixelFrame step_pixel_test(PixelTest& t) {
+    const int BAR = 64, SPEED = 8;
+    PixelFrame frame;
+    frame.data = t.pixels.data();
+    frame.width = t.width;
+    frame.height = t.height;
+    frame.format = t.format;
+    if (t.bar < 0) {
+        t.pixels.resize((size_t)t.width * t.height * pixel_bytes(t.format));
+        paint_pixel_test(t, {0, 0, t.width, t.height}, false);
+        t.bar = 0;
+        return frame; // no dirty list: full upload
+    }
+    int next = (t.bar + SPEED) % t.width;
+    t.dirty[0] = {t.bar, 0, std::min(BAR, t.width - t.bar), t.height};
+    t.dirty[1] = {next, 0, std::min(BAR, t.width - next), t.height};
+    paint_pixel_test(t, t.dirty[0], false);
+    paint_pixel_test(t, t.dirty[1], true);
+    t.bar = next;
+    frame.dirty = t.dirty;
+    frame.dirty_count = 2;
+    return frame;
+}
 
 
 int main(int argc, char* argv[]) {
@@ -29,6 +87,111 @@ int main(int argc, char* argv[]) {
     try {
         int WIDTH = 800;
         int HEIGHT = 600;
+        // 1 = sequential, 2-3 = overlap simulation/render-list build with GL submission
+        int pipelineDepth = 1;
+        // Render statistics: bar graph overlay (toggle with F3) and per frame CSV log
+        // continuous: draw every iteration (animated scenes)
+        // on-change: draw only after input or scene/camera changes, otherwise sleep in SDL_WaitEventTimeout
+        bool continuousRedraw = true;
+        const int IDLE_WAIT_MS = 100;
+        // Frame pacing: uncapped (default), --vsync or --fps N
+        FramePacer::Mode pacingMode = FramePacer::UNCAPPED;
+        double targetFps = 60.0;
+        // Dynamic resolution: --dynamic-res MIN:MAX scale bounds, --gpu-budget ms per frame
+        bool dynamicResolution = false;
+        ResolutionSettings resolutionSettings;
+        // Software occlusion culling: --occlusion, --occlusion-verify adds accuracy statistics
+        bool occlusionCulling = false;
+        bool occlusionVerify = false;
+        // Shared memory ring of an external producer (tools/shm_producer.cpp)
+        const char* ingestName = nullptr;
+        // Out-of-core point cloud (page file, PLY or XYZ) and its cache size
+        const char* pointCloud = nullptr;
+        size_t cloudCacheMb = 512;
+        // Binary scene files: start from one instead of the demo scene, write one on exit
+        const char* loadScene = nullptr;
+        const char* saveScene = nullptr;
+        // Input recording for repeatable performance runs: --record file writes the input,
+        // --replay file plays it back frame exact (--replay-step ms: fixed clock instead of the
+        // recorded one) and prints a frame time summary, --replay-csv adds per frame timings.
+        // --headless keeps the window hidden.
+        const char* recordInput = nullptr;
+        const char* replayInput = nullptr;
+        const char* replayCsv = nullptr;
+        double replayStepMs = 0.0;
+        bool headless = false;
+        // Particle load test: --particles N keeps about N particles alive in a cloud ahead of the camera
+        size_t stressParticles = 0;
+        // Animated CPU pixel buffer shown through the PBO upload path: --pixel-test WxH, --pixel-format fmt
+        PixelTest pixelTest;
+        bool statsOverlay = false;
+        const char* statsCsv = nullptr;
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], "--pipeline-depth") == 0 && i + 1 < argc) {
+                pipelineDepth = std::atoi(argv[++i]);
+            } else if (std::strcmp(argv[i], "--stats-overlay") == 0) {
+                statsOverlay = true;
+            } else if (std::strcmp(argv[i], "--stats-csv") == 0 && i + 1 < argc) {
+                statsCsv = argv[++i];
+            } else if (std::strcmp(argv[i], "--redraw") == 0 && i + 1 < argc) {
+                continuousRedraw = std::strcmp(argv[++i], "on-change") != 0;
+            } else if (std::strcmp(argv[i], "--vsync") == 0) {
+                pacingMode = FramePacer::VSYNC;
+            } else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+                pacingMode = FramePacer::TARGET_FPS;
+                targetFps = std::atof(argv[++i]);
+            } else if (std::strcmp(argv[i], "--dynamic-res") == 0 && i + 1 < argc) {
+                dynamicResolution = true;
+                std::sscanf(argv[++i], "%f:%f", &resolutionSettings.min_scale, &resolutionSettings.max_scale);
+            } else if (std::strcmp(argv[i], "--occlusion") == 0) {
+                occlusionCulling = true;
+            } else if (std::strcmp(argv[i], "--occlusion-verify") == 0) {
+                occlusionCulling = true;
+                occlusionVerify = true;
+            } else if (std::strcmp(argv[i], "--gpu-budget") == 0 && i + 1 < argc) {
+                resolutionSettings.budget_ms = std::atof(argv[++i]);
+            } else if (std::strcmp(argv[i], "--ingest") == 0 && i + 1 < argc) {
+                ingestName = argv[++i];
+            } else if (std::strcmp(argv[i], "--point-cloud") == 0 && i + 1 < argc) {
+                pointCloud = argv[++i];
+            } else if (std::strcmp(argv[i], "--cloud-cache-mb") == 0 && i + 1 < argc) {
+                cloudCacheMb = std::strtoull(argv[++i], nullptr, 10);
+            } else if (std::strcmp(argv[i], "--load-scene") == 0 && i + 1 < argc) {
+                loadScene = argv[++i];
+            } else if (std::strcmp(argv[i], "--save-scene") == 0 && i + 1 < argc) {
+                saveScene = argv[++i];
+            } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+                recordInput = argv[++i];
+            } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+                replayInput = argv[++i];
+            } else if (std::strcmp(argv[i], "--replay-csv") == 0 && i + 1 < argc) {
+                replayCsv = argv[++i];
+            } else if (std::strcmp(argv[i], "--replay-step") == 0 && i + 1 < argc) {
+                replayStepMs = std::atof(argv[++i]);
+            } else if (std::strcmp(argv[i], "--particles") == 0 && i + 1 < argc) {
+                stressParticles = std::strtoull(argv[++i], nullptr, 10);
+            } else if (std::strcmp(argv[i], "--headless") == 0) {
+                headless = true;
+            } else if (std::strcmp(argv[i], "--pixel-test") == 0 && i + 1 < argc) {
+                std::sscanf(argv[++i], "%dx%d", &pixelTest.width, &pixelTest.height);
+            } else if (std::strcmp(argv[i], "--pixel-format") == 0 && i + 1 < argc) {
+                if (!parse_pixel_format(argv[++i], pixelTest.format)) {
+                    std::cerr << "Unknown pixel format " << argv[i] << ", using rgba8" << std::endl;
+                }
+            }
+        }
+
+        // A replay runs at the recorded window size and draws every frame
+        std::shared_ptr<InputReplay> replay;
+        std::unique_ptr<ReplayReport> replayReport;
+        if (replayInput) {
+            replay = std::make_shared<InputReplay>(replayInput);
+            replay->set_fixed_step_ms(replayStepMs);
+            replayReport.reset(new ReplayReport(replayCsv ? replayCsv : ""));
+            WIDTH = replay->get_width();
+            HEIGHT = replay->get_height();
+            continuousRedraw = true;
+        }
 
         // Initialize SDL with video support
         if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -40,7 +203,7 @@ int main(int argc, char* argv[]) {
         // Create an SDL window with the SDL_WINDOW_OPENGL flag
         SDL_Window* window = SDL_CreateWindow("Pixel Buffer Renderer",
                                               WIDTH, HEIGHT,
-                                              SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL);
+                                              SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL | (headless ? SDL_WINDOW_HIDDEN : 0));
         if (!window) {
             SDL_Log("Window could not be created! SDL_Error: %s", SDL_GetError());
             SDL_Quit();
@@ -57,67 +220,156 @@ int main(int argc, char* argv[]) {
             return -1;
         }
 
-        // Set up the OpenGL viewport
-        glViewport(0, 0, WIDTH, HEIGHT);
-        printf("OpenGL viewport set up successfully.\n");
-
         // Create shapes (your current objects)
-        std::shared_ptr<Scene> scene = std::make_shared<Scene>();
+        std::shared_ptr<Scene> scene = std::make_shared<Scene>(loadScene ? loadScene : "");
+        if (ingestName) scene->set_ingest(ingestName);
+        if (pointCloud) scene->set_point_cloud(pointCloud, cloudCacheMb << 20);
+        if (stressParticles > 0) {
+            EmitterDesc cloud;
+            cloud.origin[1] = 60.0f;
+            cloud.extent[0] = cloud.extent[2] = 20.0f;
+            cloud.extent[1] = 5.0f;
+            cloud.velocity[2] = 4.0f;
+            cloud.velocity_jitter[0] = cloud.velocity_jitter[1] = cloud.velocity_jitter[2] = 6.0f;
+            cloud.lifetime = 4.0f;
+            cloud.rate = stressParticles / cloud.lifetime;
+            cloud.max_particles = stressParticles;
+            const uint8_t a[3] = {255, 120, 20}, b[3] = {40, 160, 255};
+            std::copy(a, a + 3, cloud.color_a);
+            std::copy(b, b + 3, cloud.color_b);
+            scene->get_particles().add_emitter(cloud);
+        }
+        // Recorded and replayed runs start from the same, completely loaded scene
+        if (recordInput || replay) scene->finish_loads();
         std::cout << "Camera initialized" << std::endl;
         // Initialize your renderer (ensure it is adapted to use OpenGL if needed)
         std::shared_ptr<SimpleRenderer> renderer = std::make_shared<SimpleRenderer>(window, WIDTH, HEIGHT, scene);
         std::cout << "Renderer initialized" << std::endl;
+        renderer->get_stats().set_overlay(statsOverlay);
+        if (statsCsv) renderer->get_stats().open_csv(statsCsv);
+        if (dynamicResolution) renderer->enable_dynamic_resolution(resolutionSettings);
+        if (occlusionCulling) renderer->enable_occlusion_culling(occlusionVerify);
 
         bool running = true;
         SDL_Event event;
-        uint32_t lastTime = SDL_GetTicks();
-        uint32_t lastMoveTime = SDL_GetTicks();
+        uint64_t lastTime = SDL_GetTicksNS();
         float frameCount = 0;
-        PhysicsEngine physicsEngine( renderer, scene);
+        std::unique_ptr<PhysicsEngine> physicsEngine(new PhysicsEngine(renderer, scene));
         //SDL_SetRelativeMouseMode(true);
         std::cout << "Physics Engine initialized" << std::endl; 
+        std::unique_ptr<FramePipeline> pipeline(new FramePipeline(renderer, scene, *physicsEngine, pipelineDepth));
+        FramePacer pacer(pacingMode, targetFps);
+        if (recordInput) pipeline->set_recorder(std::make_shared<InputRecorder>(recordInput, WIDTH, HEIGHT));
+        if (replay) pipeline->set_replay(replay);
+        uint64_t replayedFrames = 0;
+        uint64_t lastPresentNs = 0;
+
+        // On-change mode starts with the animation paused (P resumes it), so an untouched
+        // scene is drawn once and the loop then sleeps until input arrives.
+        if (!continuousRedraw) physicsEngine->set_animating(false);
+        uint64_t lastSceneVersion = scene->get_version();
+        int pendingFrames = pipeline->get_depth(); // frames to draw before going idle
 
         while (running) {
-            while (SDL_PollEvent(&event)) {
-                
-                auto data=physicsEngine.handleEvent(event);
-                switch (std::get<0>(data))
+            // Idle: block until input arrives. The timeout notices changes made off the main
+            // thread (e.g. asset loads) without busy looping.
+            bool idle = !continuousRedraw && pendingFrames == 0 && !physicsEngine->is_animating();
+            bool gotEvent = idle ? SDL_WaitEventTimeout(&event, IDLE_WAIT_MS) : SDL_PollEvent(&event);
+            bool hadEvents = gotEvent;
+            // Events are polled here (SDL wants the main thread) and simulated by the pipeline;
+            // only what needs the GL context or ends the loop is handled directly.
+            while (gotEvent) {
+                // A replay only listens for the window being closed
+                if (replay && event.type != SDL_EVENT_QUIT) {
+                    gotEvent = SDL_PollEvent(&event);
+                    continue;
+                }
+                switch (event.type)
                 {
-                    case terminate:
+                    case SDL_EVENT_QUIT:
                         running=false;
                         break;
-                    case window_resize:
-                        WIDTH=std::get<1>(data).at(0);
-                        HEIGHT=std::get<1>(data).at(1);
+                    case SDL_EVENT_WINDOW_RESIZED:
+                        WIDTH=event.window.data1;
+                        HEIGHT=event.window.data2;
+                        renderer->resize(WIDTH, HEIGHT);
+                        pipeline->set_viewport(WIDTH, HEIGHT);
+                        break;
+                    case SDL_EVENT_KEY_DOWN:
+                        if (event.key.scancode == SDL_SCANCODE_F3 && !event.key.repeat) {
+                            renderer->get_stats().set_overlay(!renderer->get_stats().overlay_enabled());
+                        }
                         break;
                     default:
                         break;
                 }
+                pipeline->push_event(event);
+                gotEvent = SDL_PollEvent(&event);
+            }
+
+            // Input has to reach the simulation and a changed scene has to come out of every
+            // pipeline stage, both take depth frames
+            uint64_t sceneVersion = scene->get_version();
+            if (hadEvents || sceneVersion != lastSceneVersion) {
+                pendingFrames = pipeline->get_depth();
+                lastSceneVersion = sceneVersion;
+            }
+
+            if (continuousRedraw || physicsEngine->is_animating() || pendingFrames > 0) {
+                if (pixelTest.width > 0 && pixelTest.height > 0) renderer->set_pixel_frame(step_pixel_test(pixelTest));
+                // Simulate, render and swap (or collect the frame the worker stages prepared)
+                if (lastPresentNs == 0) lastPresentNs = SDL_GetTicksNS();
+                pipeline->run_frame(window);
+                pacer.end_frame();
+                if (replay) {
+                    uint64_t now = SDL_GetTicksNS();
+                    replayReport->add_frame(replayedFrames, (now - lastPresentNs) / 1.0e6, renderer->get_stats().latest());
+                    lastPresentNs = now;
+                    if (++replayedFrames >= replay->get_frame_count()) running = false;
+                }
+                if (pendingFrames > 0) pendingFrames--;
+                frameCount++;
+            } else {
+                pacer.idle();
             }
-            
-
-            // Clear the screen using OpenGL (black background)
-            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
-
-            uint32_t currentTime = SDL_GetTicks();
-            lastMoveTime = currentTime;
-            physicsEngine.update();
-            // Render your objects using your renderer which should now be utilizing OpenGL calls
-            renderer->render();
-            // Swap the OpenGL buffers
-            SDL_GL_SwapWindow(window);
-
-            frameCount++;
-            if (currentTime - lastTime >= 1000) {
-                float fps = frameCount / ((currentTime - lastTime) / 1000.0f);
-                SDL_Log("FPS: %.2f", fps);
+
+            uint64_t currentTime = SDL_GetTicksNS();
+            if (currentTime - lastTime >= 1000000000ull) {
+                if (frameCount > 0) {
+                    float fps = frameCount / ((currentTime - lastTime) / 1.0e9f);
+                    const FrameStats& stats = renderer->get_stats().latest();
+                    FrameTimeMetrics frames = pacer.get_metrics();
+                    SDL_Log("FPS: %.2f, frame time %.2f ms (stddev %.3f, p99 %.2f), pipeline latency: %.2f ms (depth %d), build %.2f ms, submit %.2f ms, GPU %.2f ms, %zu draws, GL state calls %zu (%zu elided), scale %.2f",
+                            fps, frames.mean_ms, frames.stddev_ms, frames.p99_ms,
+                            pipeline->get_average_latency_ms(), pipeline->get_depth(),
+                            stats.build_ms, stats.submit_ms, stats.gpu_total_ms(), stats.draw_calls,
+                            stats.gl_calls, stats.gl_calls_elided, stats.render_scale);
+                    if (occlusionCulling) {
+                        const OcclusionStats& o = stats.occlusion;
+                        SDL_Log("Occlusion: %zu occluders cover %.0f%%, %zu of %zu boxes hidden, %zu off screen, %zu items culled, "
+                                "raster %.2f ms, test %.2f ms", o.occluder_triangles, o.coverage * 100.0f, o.boxes_culled,
+                                o.boxes_tested, o.boxes_outside, o.items_culled, o.raster_ms, o.test_ms);
+                        if (occlusionVerify) {
+                            SDL_Log("Occlusion accuracy: %zu sampled vertices, %zu hidden but drawn, %zu visible but culled",
+                                    o.verified_points, o.hidden_but_drawn, o.visible_but_culled);
+                        }
+                    }
+                }
                 frameCount = 0;
                 lastTime = currentTime;
             }
         }
 
         // Cleanup OpenGL context and SDL resources
+        pipeline->stop();
+        if (replayReport) replayReport->print_summary();
+        // The pipeline is stopped, nothing mutates the scene anymore
+        if (saveScene) scene->save(saveScene);
+        // Everything holding GL objects goes while the context is still current
+        pipeline.reset();
+        physicsEngine.reset();
+        renderer.reset();
+        SDL_GL_DestroyContext(glContext);
         SDL_DestroyWindow(window);
         SDL_Quit();
         printf("Program terminated successfully.\n");
@@ -0,0 +1,39 @@
+#include "transform.h"
+#include <cmath>
+
+Transform Transform::identity()
+{
+    return Transform{{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}}};
+}
+
+Transform Transform::from_trs(const std::vector<float>& pos, const std::vector<float>& orientation,
+                              const std::vector<float>& scale)
+{
+    float cx = std::cos(orientation[0]), sx = std::sin(orientation[0]);
+    float cy = std::cos(orientation[1]), sy = std::sin(orientation[1]);
+    float cz = std::cos(orientation[2]), sz = std::sin(orientation[2]);
+    // rz * ry * rx written out
+    const float rot[3][3] = {
+        {cz * cy, cz * sy * sx - sz * cx, cz * sy * cx + sz * sx},
+        {sz * cy, sz * sy * sx + cz * cx, sz * sy * cx - cz * sx},
+        {-sy,     cy * sx,                cy * cx},
+    };
+    Transform t;
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) t.m[r][c] = rot[r][c] * scale[c];
+        t.m[r][3] = pos[r];
+    }
+    return t;
+}
+
+Transform Transform::operator*(const Transform& other) const
+{
+    Transform t;
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            t.m[r][c] = m[r][0] * other.m[0][c] + m[r][1] * other.m[1][c] + m[r][2] * other.m[2][c];
+        }
+        t.m[r][3] += m[r][3];
+    }
+    return t;
+}
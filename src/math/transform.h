@@ -0,0 +1,21 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <vector>
+
+// Affine 3x4 transform, the last row is implicitly 0 0 0 1. Points are column vectors:
+// world = parent_world * local, where local = translate(pos) * rotate(orientation) * scale.
+struct Transform {
+    float m[3][4];
+
+    static Transform identity();
+    // Euler angles in radians, applied like create_rot_matrix: x, then y, then z.
+    static Transform from_trs(const std::vector<float>& pos, const std::vector<float>& orientation,
+                              const std::vector<float>& scale);
+    Transform operator*(const Transform& other) const;
+    void apply(const float in[3], float out[3]) const {
+        for (int r = 0; r < 3; ++r) out[r] = m[r][0] * in[0] + m[r][1] * in[1] + m[r][2] * in[2] + m[r][3];
+    }
+};
+
+#endif // TRANSFORM_H
@@ -8,7 +8,9 @@
 #include <cmath>
 #include <stdexcept>
 #include <limits>
+#include <algorithm>
 #include "math/own_math.h"
+#include "jobs/job_system.h"
 
 namespace objmini {
 
@@ -80,6 +82,72 @@ inline static std::vector<Material> ParseMTL(const std::string& mtlText){
     return mats;
 }
 
+// ----------------- Chunked OBJ parsing -----------------
+struct FaceCorner { int v=0, t=0, n=0; bool hasV=false, hasT=false, hasN=false; };
+// One face or usemtl switch in file order; counts are the chunk local v/vt/vn seen before the face.
+// Faces use the material of the last usemtl, which may sit in an earlier chunk.
+struct FaceRecord { bool isUseMtl=false; int material=-1; uint32_t first=0, count=0; int vcount=0, tcount=0, ncount=0; };
+struct ParsedChunk {
+    std::vector<Vector3> pos, nrm;
+    std::vector<Vector2> uv;
+    std::vector<FaceCorner> corners;
+    std::vector<FaceRecord> records;
+};
+
+// parse a token like v, v/t, v//n, v/t/n (v,t,n can be negative)
+inline static FaceCorner ParseFaceToken(const std::string& vert){
+    FaceCorner fc; int sign=1, val=0;
+    const char* s = vert.c_str(); auto flush=[&](){ if(!fc.hasV){ fc.v = sign*val; fc.hasV=true;} else if(!fc.hasT){ fc.t = sign*val; fc.hasT=true;} else { fc.n = sign*val; fc.hasN=true;} sign=1; val=0; };
+    for (size_t k=0;k<vert.size();++k){ char c=s[k];
+        if (c=='-'){ sign = -1; }
+        else if (c=='/'){
+            if (k==0 || s[k-1]=='/'){ // empty part
+                if(!fc.hasV){ fc.hasV=true; }
+                else if(!fc.hasT){ fc.hasT=true; }
+            } else flush();
+        } else if (std::isdigit((unsigned char)c)){
+            val = val*10 + (c - '0');
+        } else { /* ignore */ }
+    }
+    if (val!=0 || sign==-1){ flush(); }
+    return fc;
+}
+
+// Parses [text, text+size), which must start at a line start. Thread safe, matIndex is only read.
+inline static void ParseOBJChunk(const char* text, size_t size, const std::unordered_map<std::string,int>& matIndex, ParsedChunk& out){
+    std::istringstream ss(std::string(text, size)); std::string line;
+    while (std::getline(ss, line)){
+        // trim leading spaces
+        size_t i=0; while (i<line.size() && std::isspace((unsigned char)line[i])) ++i;
+        if (i>=line.size() || line[i]=='#') continue;
+        std::istringstream ls(line.substr(i));
+        std::string tag; ls >> tag; if(tag.empty()) continue;
+
+        if (tag == "v"){
+            Vector3 p; ls >> p.x >> p.y >> p.z; out.pos.push_back(p);
+        } else if (tag == "vt"){
+            Vector2 t; ls >> t.x >> t.y; out.uv.push_back(t);
+        } else if (tag == "vn"){
+            Vector3 n; ls >> n.x >> n.y >> n.z; out.nrm.push_back(n);
+        } else if (tag == "usemtl"){
+            std::string name; ls >> name; auto it = matIndex.find(name);
+            FaceRecord rec; rec.isUseMtl = true; rec.material = (it==matIndex.end()? -1 : it->second);
+            out.records.push_back(rec);
+        } else if (tag == "mtllib"){
+            // Ignored here; pass your MTL text via the function argument.
+        } else if (tag == "f"){
+            FaceRecord rec; rec.first = (uint32_t)out.corners.size();
+            rec.vcount = (int)out.pos.size(); rec.tcount = (int)out.uv.size(); rec.ncount = (int)out.nrm.size();
+            std::string vert;
+            while (ls >> vert){ out.corners.push_back(ParseFaceToken(vert)); }
+            rec.count = (uint32_t)out.corners.size() - rec.first;
+            out.records.push_back(rec);
+        } else {
+            // ignore: g, o, s, etc.
+        }
+    }
+}
+
 // ----------------- OBJ Loader -----------------
 // Load from strings; if you only have one .mtl file referenced by obj, pass it in mtlText.
 // Returns Mesh with welded vertices and per-material submeshes.
@@ -119,55 +187,43 @@ inline static Mesh LoadOBJFromStrings(const std::string& objText, const std::str
         Submesh sm; sm.material = mat; sm.indexOffset = (uint32_t)out.indices.size(); sm.indexCount = 0; out.submeshes.push_back(sm);
     };
 
-    // 4) Parse OBJ
-    std::istringstream ss(objText); std::string line; int currentMat = -1;
-    while (std::getline(ss, line)){
-        // trim leading spaces
-        size_t i=0; while (i<line.size() && std::isspace((unsigned char)line[i])) ++i;
-        if (i>=line.size() || line[i]=='#') continue;
-        std::istringstream ls(line.substr(i));
-        std::string tag; ls >> tag; if(tag.empty()) continue;
+    // 4) Parse OBJ in parallel: the text is cut into line-aligned chunks, every chunk collects its
+    //    own v/vt/vn lists and face records. Faces remember the local element counts so relative
+    //    (negative) indices can be resolved once the chunk base offsets are known.
+    JobSystem& jobs = JobSystem::global();
+    std::vector<std::pair<size_t,size_t>> ranges;
+    const size_t minChunk = 1 << 16;
+    size_t wanted = std::max<size_t>(1, std::min<size_t>(objText.size() / minChunk, (size_t)(jobs.get_worker_count() + 1) * 4));
+    size_t approx = objText.size() / wanted + 1;
+    for (size_t begin = 0; begin < objText.size();){
+        size_t end = std::min(objText.size(), begin + approx);
+        while (end < objText.size() && objText[end-1] != '\n') ++end;
+        ranges.push_back({begin, end}); begin = end;
+    }
+    std::vector<ParsedChunk> chunks(ranges.size());
+    jobs.parallel_for("obj_parse", 0, ranges.size(), [&](size_t b, size_t e){
+        for (size_t c=b;c<e;++c) ParseOBJChunk(objText.data()+ranges[c].first, ranges[c].second-ranges[c].first, matIndex, chunks[c]);
+    });
 
-        if (tag == "v"){
-            Vector3 p; ls >> p.x >> p.y >> p.z; srcPos.push_back(p);
-        } else if (tag == "vt"){
-            Vector2 t; ls >> t.x >> t.y; srcUv.push_back(t);
-        } else if (tag == "vn"){
-            Vector3 n; ls >> n.x >> n.y >> n.z; srcNrm.push_back(n);
-        } else if (tag == "usemtl"){
-            std::string name; ls >> name; auto it = matIndex.find(name);
-            currentMat = (it==matIndex.end()? -1 : it->second);
-            beginSubmesh(currentMat);
-        } else if (tag == "mtllib"){
-            // Ignored here; pass your MTL text via the function argument.
-        } else if (tag == "f"){
-            // Collect polygon vertices
-            std::vector<Key> poly; poly.reserve(8);
-            std::string vert;
-            while (ls >> vert){
-                // parse a token like v, v/t, v//n, v/t/n (v,t,n can be negative)
-                int vi=0, ti=0, ni=0; int field=0; bool hasV=false, hasT=false, hasN=false;
-                const char* s = vert.c_str(); int sign=1, val=0; auto flush=[&](){ if(!hasV){ vi = sign*val; hasV=true;} else if(!hasT){ ti = sign*val; hasT=true;} else { ni = sign*val; hasN=true;} sign=1; val=0; };
-                for (size_t k=0;k<vert.size();++k){ char c=s[k];
-                    if (c=='-'){ sign = -1; }
-                    else if (c=='/'){
-                        if (k==0 || s[k-1]=='/'){ // empty part
-                            if(!hasV){ hasV=true; }
-                            else if(!hasT){ hasT=true; }
-                        } else flush();
-                        ++field;
-                    } else if (std::isdigit((unsigned char)c)){
-                        val = val*10 + (c - '0');
-                    } else { /* ignore */ }
-                }
-                if (val!=0 || sign==-1){ flush(); }
-                int vcount = (int)srcPos.size();
-                int tcount = (int)srcUv.size();
-                int ncount = (int)srcNrm.size();
+    // Merge in file order. All geometry first, so faces can reference any vertex.
+    std::vector<int> baseV(chunks.size()), baseT(chunks.size()), baseN(chunks.size());
+    for (size_t c=0;c<chunks.size();++c){
+        baseV[c]=(int)srcPos.size(); baseT[c]=(int)srcUv.size(); baseN[c]=(int)srcNrm.size();
+        srcPos.insert(srcPos.end(), chunks[c].pos.begin(), chunks[c].pos.end());
+        srcUv.insert(srcUv.end(), chunks[c].uv.begin(), chunks[c].uv.end());
+        srcNrm.insert(srcNrm.end(), chunks[c].nrm.begin(), chunks[c].nrm.end());
+    }
+    std::vector<Key> poly; poly.reserve(8); int currentMat = -1;
+    for (size_t c=0;c<chunks.size();++c){
+        for (const FaceRecord& rec : chunks[c].records){
+            if (rec.isUseMtl){ currentMat = rec.material; beginSubmesh(currentMat); continue; }
+            poly.clear();
+            for (uint32_t k=rec.first;k<rec.first+rec.count;++k){
+                const FaceCorner& fc = chunks[c].corners[k];
                 Key kkey;
-                if(hasV) kkey.v = fixIndex(vi, vcount);
-                if(hasT) kkey.t = fixIndex(ti, tcount);
-                if(hasN) kkey.n = fixIndex(ni, ncount);
+                if(fc.hasV) kkey.v = fixIndex(fc.v, baseV[c] + rec.vcount);
+                if(fc.hasT) kkey.t = fixIndex(fc.t, baseT[c] + rec.tcount);
+                if(fc.hasN) kkey.n = fixIndex(fc.n, baseN[c] + rec.ncount);
                 poly.push_back(kkey);
             }
             if (poly.size() < 3) continue;
@@ -176,30 +232,35 @@ inline static Mesh LoadOBJFromStrings(const std::string& objText, const std::str
             for (size_t i1=1;i1+1<poly.size();++i1){
                 uint32_t a = emitVertex(poly[0]);
                 uint32_t b = emitVertex(poly[i1]);
-                uint32_t c = emitVertex(poly[i1+1]);
+                uint32_t c2 = emitVertex(poly[i1+1]);
                 out.indices.push_back(a);
                 out.indices.push_back(b);
-                out.indices.push_back(c);
+                out.indices.push_back(c2);
                 out.submeshes.back().indexCount += 3;
             }
-        } else {
-            // ignore: g, o, s, etc.
         }
     }
 
     // 5) If some vertices don't have normals, compute smooth normals
+    //    (face normals in parallel, scatter sequentially, normalize in parallel)
     bool needNormals=false; for (auto& v : out.vertices){ if (std::fabs(v.norm.x)+std::fabs(v.norm.y)+std::fabs(v.norm.z) < 1e-7f){ needNormals=true; break; } }
     if (needNormals){
+        size_t triCount = out.indices.size()/3;
+        std::vector<Vector3> faceN(triCount);
+        jobs.parallel_for("obj_face_normals", 0, triCount, [&](size_t b, size_t e){
+            for (size_t t=b;t<e;++t){
+                Vector3 p0=out.vertices[out.indices[3*t]].pos, p1=out.vertices[out.indices[3*t+1]].pos, p2=out.vertices[out.indices[3*t+2]].pos;
+                faceN[t] = objmini::cross(Vector3{p1.x-p0.x,p1.y-p0.y,p1.z-p0.z}, Vector3{p2.x-p0.x,p2.y-p0.y,p2.z-p0.z});
+            }
+        }, 1024);
         std::vector<Vector3> acc(out.vertices.size(), {0,0,0});
-        for (size_t i3=0;i3<out.indices.size(); i3+=3){
-            uint32_t i0=out.indices[i3+0], i1=out.indices[i3+1], i2=out.indices[i3+2];
-            Vector3 p0=out.vertices[i0].pos, p1=out.vertices[i1].pos, p2=out.vertices[i2].pos;
-            Vector3 n = objmini::cross(Vector3{p1.x-p0.x,p1.y-p0.y,p1.z-p0.z}, Vector3{p2.x-p0.x,p2.y-p0.y,p2.z-p0.z});
-            acc[i0].x+=n.x; acc[i0].y+=n.y; acc[i0].z+=n.z;
-            acc[i1].x+=n.x; acc[i1].y+=n.y; acc[i1].z+=n.z;
-            acc[i2].x+=n.x; acc[i2].y+=n.y; acc[i2].z+=n.z;
+        for (size_t t=0;t<triCount;++t){
+            const Vector3& n = faceN[t];
+            for (int k=0;k<3;++k){ Vector3& a = acc[out.indices[3*t+k]]; a.x+=n.x; a.y+=n.y; a.z+=n.z; }
         }
-        for (size_t i=0;i<out.vertices.size();++i) out.vertices[i].norm = objmini::normalize(acc[i]);
+        jobs.parallel_for("obj_normalize", 0, out.vertices.size(), [&](size_t b, size_t e){
+            for (size_t i=b;i<e;++i) out.vertices[i].norm = objmini::normalize(acc[i]);
+        }, 1024);
     }
 
     return out;
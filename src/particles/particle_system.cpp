@@ -0,0 +1,174 @@
+#include "particle_system.h"
+#include "jobs/job_system.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+// 8 floats per step, the compiler splits it where the target has narrower registers.
+// The helpers are inlined, vector arguments never cross a real call boundary.
+#pragma GCC diagnostic ignored "-Wpsabi"
+typedef float v8f __attribute__((vector_size(32)));
+typedef int v8i __attribute__((vector_size(32)));
+static constexpr size_t LANES = 8;
+static constexpr size_t BLOCKS_PER_JOB = 2048;   // 16k particles
+
+static inline v8f load8(const float* p) {
+    v8f v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void store8(float* p, const v8f& v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+
+// xorshift32, [0, 1)
+static inline float next_unit(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+size_t ParticleSystem::add_emitter(const EmitterDesc& desc) {
+    if (desc.max_particles == 0 || desc.lifetime <= 0.0f)
+        throw std::runtime_error("Particle emitter needs a pool and a positive lifetime");
+    auto em = std::make_unique<Emitter>();
+    em->desc = desc;
+    em->capacity = (desc.max_particles + LANES - 1) / LANES * LANES;
+    em->vx.resize(em->capacity);
+    em->vy.resize(em->capacity);
+    em->vz.resize(em->capacity);
+    em->remaining.resize(em->capacity);
+    em->rng = desc.seed ? desc.seed : 1;
+    em->current = acquire_frame(*em);
+    emitters.push_back(std::move(em));
+    return emitters.size() - 1;
+}
+
+void ParticleSystem::remove_emitter(size_t index) {
+    if (index < emitters.size()) emitters[index].reset();
+}
+
+void ParticleSystem::clear() {
+    emitters.clear();
+}
+
+std::shared_ptr<ParticleFrame> ParticleSystem::acquire_frame(Emitter& em) {
+    // Only the ring holds it: no snapshot reads it anymore and it is not the current frame
+    for (const auto& frame : em.frames) {
+        if (frame.use_count() == 1) return frame;
+    }
+    auto frame = std::make_shared<ParticleFrame>();
+    frame->x.resize(em.capacity);
+    frame->y.resize(em.capacity);
+    frame->z.resize(em.capacity);
+    frame->color.resize(em.capacity);
+    em.frames.push_back(frame);
+    return frame;
+}
+
+void ParticleSystem::update(float dt) {
+    for (const auto& em : emitters) {
+        if (em) update_emitter(*em, dt);
+    }
+}
+
+void ParticleSystem::update_emitter(Emitter& em, float dt) {
+    std::shared_ptr<ParticleFrame> prev = em.current;
+    std::shared_ptr<ParticleFrame> out = acquire_frame(em);
+    size_t n = prev->count;
+
+    // Move and count down, reading the previous frame and writing the new one. The last block runs
+    // over the pool past n, those lanes are garbage nobody reads.
+    em.dead.clear();
+    std::mutex dead_mutex;
+    const v8f step = v8f{} + dt;
+    JobSystem::global().parallel_for("particles_update", 0, (n + LANES - 1) / LANES, [&](size_t b, size_t e) {
+        std::vector<uint32_t> dead;
+        for (size_t k = b; k < e; ++k) {
+            size_t i = k * LANES;
+            store8(&out->x[i], load8(&prev->x[i]) + load8(&em.vx[i]) * step);
+            store8(&out->y[i], load8(&prev->y[i]) + load8(&em.vy[i]) * step);
+            store8(&out->z[i], load8(&prev->z[i]) + load8(&em.vz[i]) * step);
+            std::memcpy(&out->color[i], &prev->color[i], LANES * sizeof(uint32_t));
+            v8f remaining = load8(&em.remaining[i]) - step;
+            store8(&em.remaining[i], remaining);
+            v8i expired = remaining <= 0.0f;
+            // Rare, so the lanes are only looked at when one expired
+            v8i none = {};
+            if (std::memcmp(&expired, &none, sizeof(expired)) != 0) {
+                for (size_t l = 0; l < LANES && i + l < n; ++l) {
+                    if (expired[l]) dead.push_back((uint32_t)(i + l));
+                }
+            }
+        }
+        if (!dead.empty()) {
+            std::lock_guard<std::mutex> lock(dead_mutex);
+            em.dead.insert(em.dead.end(), dead.begin(), dead.end());
+        }
+    }, BLOCKS_PER_JOB);
+
+    // Recycle: highest index first, so the last particle moved into a hole is always alive
+    std::sort(em.dead.begin(), em.dead.end());
+    for (size_t d = em.dead.size(); d-- > 0;) {
+        size_t i = em.dead[d], last = --n;
+        if (i == last) continue;
+        out->x[i] = out->x[last];
+        out->y[i] = out->y[last];
+        out->z[i] = out->z[last];
+        out->color[i] = out->color[last];
+        em.vx[i] = em.vx[last];
+        em.vy[i] = em.vy[last];
+        em.vz[i] = em.vz[last];
+        em.remaining[i] = em.remaining[last];
+    }
+    out->count = n;
+
+    em.spawn_debt += em.desc.rate * dt;
+    size_t wanted = (size_t)em.spawn_debt;
+    em.spawn_debt -= (float)wanted;
+    size_t room = em.desc.max_particles - out->count;
+    if (wanted > room) {
+        wanted = room;
+        em.spawn_debt = 0.0f;   // a full pool does not build up a burst for later
+    }
+    spawn(em, *out, wanted);
+    em.current = out;
+}
+
+void ParticleSystem::spawn(Emitter& em, ParticleFrame& frame, size_t count) {
+    const EmitterDesc& d = em.desc;
+    for (size_t k = 0; k < count; ++k) {
+        size_t i = frame.count++;
+        frame.x[i] = d.origin[0] + d.extent[0] * (2.0f * next_unit(em.rng) - 1.0f);
+        frame.y[i] = d.origin[1] + d.extent[1] * (2.0f * next_unit(em.rng) - 1.0f);
+        frame.z[i] = d.origin[2] + d.extent[2] * (2.0f * next_unit(em.rng) - 1.0f);
+        em.vx[i] = d.velocity[0] + d.velocity_jitter[0] * (2.0f * next_unit(em.rng) - 1.0f);
+        em.vy[i] = d.velocity[1] + d.velocity_jitter[1] * (2.0f * next_unit(em.rng) - 1.0f);
+        em.vz[i] = d.velocity[2] + d.velocity_jitter[2] * (2.0f * next_unit(em.rng) - 1.0f);
+        em.remaining[i] = d.lifetime;
+        float t = next_unit(em.rng);
+        uint32_t color = 0;
+        for (int c = 0; c < 3; ++c) {
+            uint32_t v = (uint32_t)(d.color_a[c] + (d.color_b[c] - d.color_a[c]) * t + 0.5f);
+            color |= v << (8 * c);
+        }
+        frame.color[i] = color;
+    }
+}
+
+void ParticleSystem::capture(std::vector<std::shared_ptr<const ParticleFrame>>& out) const {
+    for (const auto& em : emitters) {
+        if (em && em->current->count > 0) out.push_back(em->current);
+    }
+}
+
+size_t ParticleSystem::get_live_count() const {
+    size_t live = 0;
+    for (const auto& em : emitters) {
+        if (em) live += em->current->count;
+    }
+    return live;
+}
@@ -0,0 +1,72 @@
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// What an emitter spawns. Particles start uniformly in origin +- extent with velocity +-
+// velocity_jitter, fly in a straight line and die after lifetime seconds.
+struct EmitterDesc {
+    float origin[3] = {0, 0, 0};
+    float extent[3] = {0, 0, 0};
+    float velocity[3] = {0, 0, 0};
+    float velocity_jitter[3] = {0, 0, 0};
+    float rate = 100.0f;                // particles per second
+    float lifetime = 1.0f;              // seconds
+    uint8_t color_a[3] = {255, 255, 255};
+    uint8_t color_b[3] = {255, 255, 255};   // every particle gets a random mix of a and b
+    size_t max_particles = 65536;       // pool size, spawning waits while it is full
+    uint32_t seed = 1;
+};
+
+// Positions and colors of the live particles of one emitter after an update, read by the
+// render stages through the snapshot. Never changed while anyone but the emitter holds it.
+struct ParticleFrame {
+    std::vector<float> x, y, z;         // sized to the pool, the first count are live
+    std::vector<uint32_t> color;        // 0x00bbggrr
+    size_t count = 0;
+};
+
+// Particle effects, simulated on the scene thread. Every emitter owns a fixed pool in SoA
+// layout and never allocates after the first frames: dead particles are swapped out with the
+// last live one, new ones are appended. The update is a GCC vector extension kernel over the
+// pool, split over the job system; positions are written to a frame buffer the snapshot can
+// keep (a small ring per emitter, reused once no snapshot holds it), so publishing costs no
+// copy. The renderer projects the frames into the point block, all particles of all emitters
+// go out in the one GL_POINTS draw of the frame.
+class ParticleSystem {
+public:
+    // Index for remove_emitter.
+    size_t add_emitter(const EmitterDesc& desc);
+    void remove_emitter(size_t index);
+    void clear();
+
+    // Advances every emitter by dt seconds: moves, ages and recycles, then spawns.
+    void update(float dt);
+    // Appends the newest frame of every emitter.
+    void capture(std::vector<std::shared_ptr<const ParticleFrame>>& out) const;
+    size_t get_live_count() const;
+    size_t get_emitter_count() const { return emitters.size(); }
+
+private:
+    struct Emitter {
+        EmitterDesc desc;
+        size_t capacity = 0;                // desc.max_particles rounded up to the SIMD width
+        std::vector<float> vx, vy, vz, remaining;   // remaining lifetime in seconds
+        std::vector<std::shared_ptr<ParticleFrame>> frames;   // ring of published buffers
+        std::shared_ptr<ParticleFrame> current;
+        float spawn_debt = 0.0f;            // fractional particles carried to the next update
+        uint32_t rng = 1;
+        std::vector<uint32_t> dead;         // indices collected by the kernel
+    };
+
+    static void update_emitter(Emitter& em, float dt);
+    static std::shared_ptr<ParticleFrame> acquire_frame(Emitter& em);
+    static void spawn(Emitter& em, ParticleFrame& frame, size_t count);
+
+    std::vector<std::unique_ptr<Emitter>> emitters;   // null once removed
+};
+
+#endif // PARTICLE_SYSTEM_H
@@ -0,0 +1,97 @@
+#include "body_simulation.h"
+#include "jobs/job_system.h"
+#include "scene/object_list.h"
+#include "shapes/circle.h"
+#include "shapes/rectangle.h"
+#include "shapes/triangle.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+float BodySimulation::contact_radius(Object* obj) {
+    float r = 0.0f;
+    switch (obj->get_shape_type()) {
+        case CIRCLE: r = static_cast<Circle*>(obj)->get_radius(); break;
+        case RECTANGLE: {
+            auto rect = static_cast<Rect*>(obj);
+            r = 0.5f * std::hypot(rect->get_width(), rect->get_height());
+            break;
+        }
+        case TRIANGLE: r = static_cast<Triangle*>(obj)->get_size(); break;
+        default: break;
+    }
+    return std::max(r, MIN_CONTACT_RADIUS);
+}
+
+void BodySimulation::step(ObjectList& list, float seconds) {
+    const std::vector<Object*>& active = list.get_active();
+    last_active = active.size();
+    if (active.empty() || seconds <= 0.0f) return;
+    const float damping = std::exp(-LINEAR_DAMPING * seconds);
+    const bool anyone_asleep = sleepers.size() > 0;
+
+    // Bodies move independently, the set changes only afterwards
+    struct Contact {
+        Object* mover;
+        SleepGrid::Hit hit;
+    };
+    std::mutex found_mutex;
+    std::vector<Object*> resting;
+    std::vector<Contact> touched;
+    JobSystem::global().parallel_for("physics_update", 0, active.size(), [&](size_t b, size_t e) {
+        std::vector<Object*> rest;
+        std::vector<Contact> contacts;
+        std::vector<SleepGrid::Hit> hits;
+        for (size_t i = b; i < e; ++i) {
+            Object* obj = active[i];
+            float* v = obj->velocity;
+            if (obj->body_type == BODY_DYNAMIC) {
+                v[0] *= damping; v[1] *= damping; v[2] *= damping;
+            }
+            float speed2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+            if (speed2 > 0.0f) obj->move(v[0] * seconds, v[1] * seconds, v[2] * seconds);
+            if (obj->body_type == BODY_DYNAMIC) {
+                if (speed2 >= SLEEP_SPEED * SLEEP_SPEED) obj->rest_seconds = 0.0f;
+                else if ((obj->rest_seconds += seconds) >= SLEEP_SECONDS) rest.push_back(obj);
+            }
+            if (anyone_asleep && speed2 > 0.0f) {
+                const std::vector<float>& pos = obj->get_coords();
+                const float p[3] = {pos[0], pos[1], pos[2]};
+                hits.clear();
+                sleepers.query(obj->parent ? obj->parent->id : -1, p, contact_radius(obj), hits);
+                for (const auto& hit : hits) contacts.push_back({obj, hit});
+            }
+        }
+        if (rest.empty() && contacts.empty()) return;
+        std::lock_guard<std::mutex> lock(found_mutex);
+        resting.insert(resting.end(), rest.begin(), rest.end());
+        touched.insert(touched.end(), contacts.begin(), contacts.end());
+    }, 256);
+
+    for (const auto& contact : touched) {
+        Object* obj = list.find(contact.hit.id);
+        sleepers.remove(contact.hit);
+        if (!obj || !obj->sleeping || obj->sleep_stamp != contact.hit.stamp) continue;
+        obj->wake();
+        Object* mover = contact.mover;
+        for (int k = 0; k < 3; ++k) {
+            float push = CONTACT_PUSH * mover->velocity[k];
+            obj->velocity[k] = push;
+            if (mover->body_type == BODY_DYNAMIC) mover->velocity[k] -= push;
+        }
+    }
+    for (Object* obj : resting) {
+        obj->velocity[0] = obj->velocity[1] = obj->velocity[2] = 0.0f;
+        obj->sleeping = true;
+        obj->sleep_stamp++;
+        list.body_changed(obj);
+        const std::vector<float>& pos = obj->get_coords();
+        const float p[3] = {pos[0], pos[1], pos[2]};
+        sleepers.insert(obj->parent ? obj->parent->id : -1, obj->id, obj->sleep_stamp, p, contact_radius(obj));
+    }
+    // Bodies woken through the API or removed since left entries behind
+    sleepers.purge([&](int id, uint32_t stamp) {
+        Object* obj = list.find(id);
+        return obj && obj->sleeping && obj->sleep_stamp == stamp;
+    });
+}
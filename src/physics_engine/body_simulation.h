@@ -0,0 +1,36 @@
+#ifndef BODY_SIMULATION_H
+#define BODY_SIMULATION_H
+
+#include <cstddef>
+#include "physics_engine/sleep_grid.h"
+
+class Object;
+class ObjectList;
+
+// Bodies (see BodyType in shapes/object.h). A dynamic body slower than SLEEP_SPEED for
+// SLEEP_SECONDS falls asleep: it leaves the active set and goes into the sleep grid, where
+// moving bodies that touch it wake it again. A woken body is pushed along with CONTACT_PUSH of
+// the mover's velocity; a dynamic mover gives that up, a kinematic one keeps going. Contact
+// radii come from the shape sizes. Needs nothing but the object list, so tools can drive it.
+class BodySimulation {
+public:
+    static constexpr float LINEAR_DAMPING = 0.5f;   // per second
+    static constexpr float SLEEP_SPEED = 0.05f;     // units per second
+    static constexpr float SLEEP_SECONDS = 0.5f;
+    static constexpr float MIN_CONTACT_RADIUS = 0.05f;
+    static constexpr float CONTACT_PUSH = 0.5f;
+
+    // Moves the active bodies, puts the ones at rest to sleep and wakes what they touch.
+    void step(ObjectList& list, float seconds);
+    // Bodies the last step visited, i.e. awake and not static.
+    size_t get_active_count() const { return last_active; }
+    // Sleep grid entries, stale ones included until the next purge.
+    size_t get_sleeper_count() const { return sleepers.size(); }
+    static float contact_radius(Object* obj);
+
+private:
+    SleepGrid sleepers;
+    size_t last_active = 0;
+};
+
+#endif // BODY_SIMULATION_H
@@ -1,6 +1,7 @@
 #include "physics_engine.h"
 #include <iostream>
 #include <math/own_math.h>
+#include <cmath>
 constexpr double pi = 3.14159265358979323846;
 
 
@@ -63,36 +64,25 @@ Matrix3 create_rot_matrix(float pitch, float yaw, float roll) {
 
 
 
+void PhysicsEngine::set_clock_ms(Uint64 ms) {
+    if (!external_clock) lastMoveTime = ms;
+    external_clock = true;
+    clock_ms = ms;
+}
+
 void PhysicsEngine::update() {
     try{   
-        auto time= SDL_GetTicks();
-        float deltaTime = (time - lastMoveTime) / 1000.0f*20.0f; // Time in seconds
+        auto time= now_ms();
+        float seconds = (time - lastMoveTime) / 1000.0f;
         lastMoveTime = time;
+        if (!animating) return; // paused, objects keep their positions
+        scene->update_particles(seconds);
         //float scene->camera_decceleration=0.5f;
         //printf("scene->camera pos: %f %f %f \n",scene->camera->pos.at(0),scene->camera->pos.at(1),scene->camera->pos.at(2));
         //scene->camera->pos={scene->camera->pos.at(0)+deltaTime*scene->camera->velocity.at(0),scene->camera->pos.at(1),scene->camera->pos.at(2)};
         //float scene->camera_decceleration_resulting=(1-1/pow((deltaTime*scene->camera_decceleration+1.0f),2.0f));
         //scene->camera->velocity={scene->camera->velocity.at(0)*scene->camera_decceleration_resulting,scene->camera->velocity.at(1)*scene->camera_decceleration_resulting,scene->camera->velocity.at(2)*scene->camera_decceleration_resulting};
-        for (auto shape : *scene->get_objects()) {
-            // If shape is a vertex, update the position until its behind origin, then reset it to 100
-            if(shape->get_shape_type()==VERTEX){
-              //use strcmp  if(shape->get_name()=="moving_over"){
-              if(shape->get_name().find("moving_over") != std::string::npos) {
-             
-                shape->move(0, -deltaTime,0);
-                if(shape->get_coords().at(1)<0){
-                    shape->move_to(shape->get_coords().at(0), 100.0f,shape->get_coords().at(2));
-                }}
-            }else{
-                shape->move(5*deltaTime, 5*deltaTime,0);
-            };
-            auto pos = shape->get_coords();
-            // check if pos is behind the scene->camera
-            // If the point is behind the scene->camera, make it invisible
-            
-            // Update the renderer with the new position of the shape
-            
-        }
+        bodies.step(scene->object_list, seconds);
         
     }
     catch(const std::exception& e)
@@ -112,13 +102,15 @@ void PhysicsEngine::update() {
                 break;
             case SDL_EVENT_WINDOW_RESIZED:
                 printf("window resize detected\n");
-                renderer->resize(event.window.data1, event.window.data2);
-                glViewport(0, 0, event.window.data1, event.window.data2); // Update the OpenGL viewport on resize
+                // The GL side (renderer->resize) is done by the caller on the GL thread,
+                // this may run on the simulation thread.
+                display_width = event.window.data1;
+                display_height = event.window.data2;
                 return {window_resize,{event.window.data1,event.window.data2}};
                 break;
             case SDL_EVENT_KEY_DOWN: {
                     // Example: WASD movement
-                    float time_passed=SDL_GetTicks()-lastMoveTime;
+                    float time_passed=now_ms()-lastMoveTime;
                     float speed=5.0f;
                     float moving_dist=time_passed/1000.0f*speed; // Time in seconds
 
@@ -127,26 +119,30 @@ void PhysicsEngine::update() {
                         printf("w detected\n");
                         auto new_position= calculate_new_position(scene->camera->pos,scene->camera->orientation,{0,1,0},moving_dist);
                     
-                        scene->camera->pos =new_position;
+                        scene->camera->set_pos(new_position);
                         break;
                     } else if (event.key.scancode == SDL_SCANCODE_A) {
                         // Move left
                         printf("a detected\n");
                         auto new_position= calculate_new_position(scene->camera->pos,scene->camera->orientation,{-1,0,0},moving_dist);
 
-                        scene->camera->pos =new_position;
+                        scene->camera->set_pos(new_position);
                     } else if (event.key.scancode == SDL_SCANCODE_S) {
                         // Move backward
                         printf("s detected\n");
                         auto new_position= calculate_new_position(scene->camera->pos,scene->camera->orientation,{0,-1,0},moving_dist);
                     
-                        scene->camera->pos =new_position;
+                        scene->camera->set_pos(new_position);
+                    } else if (event.key.scancode == SDL_SCANCODE_P && !event.key.repeat) {
+                        // Pause/resume the animation
+                        animating = !animating;
+                        printf("animation %s\n", animating ? "resumed" : "paused");
                     } else if (event.key.scancode == SDL_SCANCODE_D) {
                         // Move right
                         printf("d detected\n");
                         auto new_position= calculate_new_position(scene->camera->pos,scene->camera->orientation,{1,0,0},moving_dist);
 
-                        scene->camera->pos =new_position;
+                        scene->camera->set_pos(new_position);
                     }
                 }
                 break;
@@ -156,6 +152,7 @@ void PhysicsEngine::update() {
                         printf("left mouseclick down detected\n");
                         printf("first coords: %f %f \n",event.motion.x,event.motion.y);
                         mouse_movement={event.motion.x,event.motion.y};
+                        click_start={event.button.x,event.button.y};
                         mouse_clicked=true;
                     }
                 break;
@@ -166,6 +163,12 @@ void PhysicsEngine::update() {
                     printf("final coords: %f %f \n",event.motion.x,event.motion.y);
                     mouse_clicked=false;
                     mouse_movement={0.0,0.0};
+                    // Released where it was pressed: a click, not a camera drag, so select
+                    if (std::fabs(event.button.x - std::get<0>(click_start)) < CLICK_SLOP_PX &&
+                        std::fabs(event.button.y - std::get<1>(click_start)) < CLICK_SLOP_PX) {
+                        scene->request_pick(event.button.x / display_width * 2.0f - 1.0f,
+                                            1.0f - event.button.y / display_height * 2.0f);
+                    }
                 }
                 break;
             case SDL_EVENT_MOUSE_MOTION:
@@ -179,9 +182,6 @@ void PhysicsEngine::update() {
                     float diff_y=event.motion.y-std::get<1>(mouse_movement);
                     printf("difference= %f %f \n",diff_x,diff_y);
                     printf("orientation_before: %f %f %f \n",scene->camera->orientation[0],scene->camera->orientation[1],scene->camera->orientation[2]);
-                    int display_width,display_height;
-                    display_width=renderer->width;
-                    display_height=renderer->height;
                     printf("window size: %d %d \n",display_width,display_height);
                     diff_x=diff_x/display_width*sensityfity/2.0f*pi;
                     diff_y=-diff_y/display_height*sensityfity/2.0f*pi;
@@ -205,7 +205,7 @@ void PhysicsEngine::update() {
                     new_orientation = normalize(new_orientation);
 
 
-                    scene->camera->orientation={new_orientation.x,new_orientation.y,new_orientation.z};
+                    scene->camera->set_orientation({new_orientation.x,new_orientation.y,new_orientation.z});
                     printf("orientation_after: %f %f %f \n",scene->camera->orientation[0],scene->camera->orientation[1],scene->camera->orientation[2]);
                     mouse_movement={event.motion.x,event.motion.y};
                             
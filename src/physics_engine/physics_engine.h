@@ -2,8 +2,10 @@
 #define PHYSICS_ENGINE_H
 #include <vector>
 #include <memory>
+#include <atomic>
 #include "shapes/object.h"
 #include "renderer/renderer.h"
+#include "physics_engine/body_simulation.h"
 
 enum detected_actions{
     terminate,
@@ -19,15 +21,33 @@ private:
     std::shared_ptr<SimpleRenderer> renderer;
     std::shared_ptr<Scene> scene;
     std::tuple<float,float> mouse_movement={0.0,0.0};
+    std::tuple<float,float> click_start={0.0,0.0}; // where the left button went down
+    static constexpr float CLICK_SLOP_PX = 4.0f;    // moved less than this until release: a click
+    int display_width, display_height; // last known window size, for mouse sensitivity
+    std::atomic<bool> animating{true};  // time driven motion in update(), toggled with P
+    bool external_clock = false;        // set_clock_ms was called, SDL_GetTicks is not used anymore
+    Uint64 clock_ms = 0;
+    Uint64 now_ms() const { return external_clock ? clock_ms : SDL_GetTicks(); }
+    BodySimulation bodies;
     std::vector<float> calculate_new_position(std::vector<float> pos, std::vector<float> orientation, std::vector<float> direction, float speed) ;
 public:
     PhysicsEngine( std::shared_ptr<SimpleRenderer> renderer_passed, std::shared_ptr<Scene> scene_passed) : renderer(renderer_passed), scene(scene_passed) {
+        display_width = renderer->width;
+        display_height = renderer->height;
         // Initialize the physics engine
     }
     ~PhysicsEngine() {
         // Clean up the physics engine
     }
     void update();
+    // While false, update() only applies input; the main loop may then stop redrawing.
+    void set_animating(bool enabled) { animating = enabled; }
+    bool is_animating() const { return animating; }
+    // Drives the simulation clock from outside (recording and replay) instead of SDL_GetTicks.
+    // The first call also restarts the motion timer, so runs do not depend on startup time.
+    void set_clock_ms(Uint64 ms);
+    // Bodies the last update visited, i.e. awake and not static.
+    size_t get_active_count() const { return bodies.get_active_count(); }
     std::tuple<detected_actions,std::vector<int>> handleEvent(SDL_Event event);
 };
 
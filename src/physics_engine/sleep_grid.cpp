@@ -0,0 +1,108 @@
+#include "sleep_grid.h"
+#include <cmath>
+#include <iterator>
+
+int SleepGrid::level_of(float radius) {
+    int level = 0;
+    while (level + 1 < LEVELS && cell_size(level) < 2.0f * radius) level++;
+    return level;
+}
+
+float SleepGrid::cell_size(int level) {
+    return std::ldexp(BASE_CELL, level);
+}
+
+void SleepGrid::insert(int parent, int id, uint32_t stamp, const float pos[3], float radius) {
+    int level = level_of(radius);
+    float s = cell_size(level);
+    Key key{parent, (int32_t)std::floor(pos[0] / s), (int32_t)std::floor(pos[1] / s), (int32_t)std::floor(pos[2] / s)};
+    levels[level][key].push_back({id, stamp, {pos[0], pos[1], pos[2]}, radius});
+    used_levels |= 1u << level;
+    entries++;
+    inserts_since_purge++;
+}
+
+void SleepGrid::append_hits(const std::vector<Entry>& cell, int level, const Key& key, const float pos[3],
+                            float radius, std::vector<Hit>& hits) {
+    for (const Entry& e : cell) {
+        float dx = e.pos[0] - pos[0], dy = e.pos[1] - pos[1], dz = e.pos[2] - pos[2];
+        float reach = e.radius + radius;
+        if (dx * dx + dy * dy + dz * dz <= reach * reach) hits.push_back({e.id, e.stamp, level, key});
+    }
+}
+
+void SleepGrid::query(int parent, const float pos[3], float radius, std::vector<Hit>& hits) const {
+    for (int level = 0; level < LEVELS; ++level) {
+        if (!(used_levels >> level & 1)) continue;
+        const Level& cells = levels[level];
+        // Sleepers of this level reach at most half a cell out of their own
+        float s = cell_size(level), reach = radius + 0.5f * s;
+        int32_t lo[3], hi[3];
+        double volume = 1.0;
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = (int32_t)std::floor((pos[k] - reach) / s);
+            hi[k] = (int32_t)std::floor((pos[k] + reach) / s);
+            volume *= (double)hi[k] - lo[k] + 1;
+        }
+        if (volume > (double)cells.size()) {
+            for (const auto& cell : cells) {
+                if (cell.first.parent == parent) append_hits(cell.second, level, cell.first, pos, radius, hits);
+            }
+            continue;
+        }
+        for (int32_t x = lo[0]; x <= hi[0]; ++x) {
+            for (int32_t y = lo[1]; y <= hi[1]; ++y) {
+                for (int32_t z = lo[2]; z <= hi[2]; ++z) {
+                    Key key{parent, x, y, z};
+                    auto it = cells.find(key);
+                    if (it != cells.end()) append_hits(it->second, level, key, pos, radius, hits);
+                }
+            }
+        }
+    }
+}
+
+void SleepGrid::remove(const Hit& hit) {
+    Level& cells = levels[hit.level];
+    auto it = cells.find(hit.key);
+    if (it == cells.end()) return;
+    std::vector<Entry>& cell = it->second;
+    for (size_t i = 0; i < cell.size(); ++i) {
+        if (cell[i].id != hit.id || cell[i].stamp != hit.stamp) continue;
+        cell[i] = cell.back();
+        cell.pop_back();
+        entries--;
+        break;
+    }
+    if (cell.empty()) cells.erase(it);
+    if (cells.empty()) used_levels &= ~(1u << hit.level);
+}
+
+void SleepGrid::purge(const std::function<bool(int, uint32_t)>& valid) {
+    if (inserts_since_purge < entries / 2 + 64) return;
+    inserts_since_purge = 0;
+    for (int level = 0; level < LEVELS; ++level) {
+        Level& cells = levels[level];
+        for (auto it = cells.begin(); it != cells.end();) {
+            std::vector<Entry>& cell = it->second;
+            for (size_t i = 0; i < cell.size();) {
+                if (valid(cell[i].id, cell[i].stamp)) {
+                    ++i;
+                } else {
+                    cell[i] = cell.back();
+                    cell.pop_back();
+                    entries--;
+                }
+            }
+            it = cell.empty() ? cells.erase(it) : std::next(it);
+        }
+        if (cells.empty()) used_levels &= ~(1u << level);
+    }
+}
+
+void SleepGrid::clear() {
+    for (Level& cells : levels) cells.clear();
+    used_levels = 0;
+    entries = 0;
+    inserts_since_purge = 0;
+}
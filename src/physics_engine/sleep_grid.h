@@ -0,0 +1,73 @@
+#ifndef SLEEP_GRID_H
+#define SLEEP_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Sleeping bodies by position, so a moving body finds the ones it touches without visiting
+// every sleeper. Hierarchical hash grid: a body goes into one cell of the level whose cells
+// are at least its diameter, so a query looks at the cells around it on every level in use,
+// or at all cells of a level when that is fewer. Positions are local to the parent (id, -1
+// for top level objects); bodies under different parents never touch.
+// Entries are not removed when a body wakes up elsewhere (the sleep stamp tells), purge()
+// drops those in a pass whose cost is covered by the inserts since the last one.
+class SleepGrid {
+public:
+    struct Key {
+        int32_t parent;
+        int32_t x, y, z;
+        bool operator==(const Key& o) const { return parent == o.parent && x == o.x && y == o.y && z == o.z; }
+    };
+    struct Hit {
+        int id;
+        uint32_t stamp;
+        int level;
+        Key key;
+    };
+
+    void insert(int parent, int id, uint32_t stamp, const float pos[3], float radius);
+    // Appends the entries whose sphere overlaps the given one, stale entries included.
+    // Queries may run concurrently, not with the changes.
+    void query(int parent, const float pos[3], float radius, std::vector<Hit>& hits) const;
+    void remove(const Hit& hit);
+    // Drops the entries valid(id, stamp) rejects, once enough were inserted since the last purge.
+    void purge(const std::function<bool(int, uint32_t)>& valid);
+    void clear();
+    size_t size() const { return entries; }
+
+private:
+    static constexpr int LEVELS = 24;
+    static constexpr float BASE_CELL = 0.25f;   // level 0, cells double per level
+
+    struct Entry {
+        int id;
+        uint32_t stamp;
+        float pos[3];
+        float radius;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            uint64_t h = (uint32_t)k.parent * 0x9E3779B97F4A7C15ull;
+            h ^= (uint32_t)k.x * 0xC2B2AE3D27D4EB4Full + (h << 6);
+            h ^= (uint32_t)k.y * 0x165667B19E3779F9ull + (h << 6);
+            h ^= (uint32_t)k.z * 0x27D4EB2F165667C5ull + (h << 6);
+            return (size_t)(h ^ (h >> 29));
+        }
+    };
+    typedef std::unordered_map<Key, std::vector<Entry>, KeyHash> Level;
+
+    static int level_of(float radius);
+    static float cell_size(int level);
+    static void append_hits(const std::vector<Entry>& cell, int level, const Key& key, const float pos[3],
+                            float radius, std::vector<Hit>& hits);
+
+    Level levels[LEVELS];
+    uint32_t used_levels = 0;      // bit per level with cells
+    size_t entries = 0;
+    size_t inserts_since_purge = 0;
+};
+
+#endif // SLEEP_GRID_H
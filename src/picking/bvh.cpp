@@ -0,0 +1,331 @@
+#include "bvh.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include "jobs/job_system.h"
+
+namespace {
+const int BINS = 16;
+const uint32_t MAX_LEAF = 4;     // leaves are split below this whenever SAH allows
+const uint32_t MAX_SAH_LEAF = 16; // SAH may keep up to this many in one leaf
+
+struct Box {
+    float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+    void grow(const float p[3]) {
+        for (int k = 0; k < 3; ++k) {
+            min[k] = std::min(min[k], p[k]);
+            max[k] = std::max(max[k], p[k]);
+        }
+    }
+    void grow(const Box& b) {
+        for (int k = 0; k < 3; ++k) {
+            min[k] = std::min(min[k], b.min[k]);
+            max[k] = std::max(max[k], b.max[k]);
+        }
+    }
+    float area() const {
+        float d[3] = {max[0] - min[0], max[1] - min[1], max[2] - min[2]};
+        if (d[0] < 0.0f) return 0.0f;
+        return 2.0f * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+    }
+};
+
+struct Bin {
+    Box bounds, centroids;
+    uint32_t count = 0;
+};
+
+struct BuildTask {
+    uint32_t node, begin, end;
+    Box bounds, centroids;
+};
+
+int bin_of(float c, float min, float scale) {
+    return std::min(BINS - 1, (int)((c - min) * scale));
+}
+
+inline void sub(const float a[3], const float b[3], float out[3]) {
+    out[0] = a[0] - b[0]; out[1] = a[1] - b[1]; out[2] = a[2] - b[2];
+}
+inline float dot3(const float a[3], const float b[3]) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+inline void cross3(const float a[3], const float b[3], float out[3]) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+}
+
+void Bvh::build(Kind kind, std::vector<Prim> input, const float* positions)
+{
+    this->kind = kind;
+    prims = std::move(input);
+    nodes.clear();
+    const uint32_t n = (uint32_t)prims.size();
+    if (n == 0) return;
+    const int corners = kind == TRIANGLES ? 3 : 1;
+
+    std::vector<Box> boxes(n);
+    std::vector<float> centroids(3 * (size_t)n);
+    JobSystem::global().parallel_for("bvh_bounds", 0, n, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            for (int k = 0; k < corners; ++k) boxes[i].grow(positions + 3 * (size_t)prims[i].v[k]);
+            for (int k = 0; k < 3; ++k) centroids[3 * i + k] = 0.5f * (boxes[i].min[k] + boxes[i].max[k]);
+        }
+    }, 16384);
+    std::vector<uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0u);
+
+    BuildTask root{0, 0, n, Box(), Box()};
+    for (uint32_t i = 0; i < n; ++i) {
+        root.bounds.grow(boxes[i]);
+        root.centroids.grow(&centroids[3 * (size_t)i]);
+    }
+    nodes.reserve(2 * (size_t)n / MAX_LEAF + 1);
+    nodes.push_back(Node());
+    std::vector<BuildTask> stack{root};
+    while (!stack.empty()) {
+        BuildTask task = stack.back();
+        stack.pop_back();
+        Node& node = nodes[task.node];
+        for (int k = 0; k < 3; ++k) {
+            node.min[k] = task.bounds.min[k];
+            node.max[k] = task.bounds.max[k];
+        }
+        uint32_t count = task.end - task.begin;
+        node.first = task.begin;
+        node.count = count;
+        if (count <= MAX_LEAF) continue;
+
+        // Bin the centroids on all three axes and sweep each for the cheapest split
+        Bin bins[3][BINS];
+        float best_cost = FLT_MAX;
+        int best_axis = -1, best_split = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            float extent = task.centroids.max[axis] - task.centroids.min[axis];
+            if (extent <= 0.0f) continue;
+            float scale = BINS / extent;
+            for (uint32_t i = task.begin; i < task.end; ++i) {
+                const float* c = &centroids[3 * (size_t)order[i]];
+                Bin& bin = bins[axis][bin_of(c[axis], task.centroids.min[axis], scale)];
+                bin.count++;
+                bin.bounds.grow(boxes[order[i]]);
+                bin.centroids.grow(c);
+            }
+            float left_area[BINS - 1];
+            uint32_t left_count[BINS - 1];
+            Box acc;
+            uint32_t acc_count = 0;
+            for (int b = 0; b < BINS - 1; ++b) {
+                acc.grow(bins[axis][b].bounds);
+                acc_count += bins[axis][b].count;
+                left_area[b] = acc.area();
+                left_count[b] = acc_count;
+            }
+            acc = Box();
+            acc_count = 0;
+            for (int b = BINS - 1; b > 0; --b) {
+                acc.grow(bins[axis][b].bounds);
+                acc_count += bins[axis][b].count;
+                if (left_count[b - 1] == 0 || acc_count == 0) continue;
+                float cost = left_area[b - 1] * left_count[b - 1] + acc.area() * acc_count;
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = b;
+                }
+            }
+        }
+
+        BuildTask left{0, task.begin, 0, Box(), Box()}, right{0, 0, task.end, Box(), Box()};
+        if (best_axis < 0) {
+            // All centroids coincide, no split separates them; halve by position in the list
+            if (count <= MAX_SAH_LEAF) continue;
+            uint32_t mid = task.begin + count / 2;
+            left.end = right.begin = mid;
+            for (uint32_t i = task.begin; i < task.end; ++i) {
+                BuildTask& side = i < mid ? left : right;
+                side.bounds.grow(boxes[order[i]]);
+                side.centroids.grow(&centroids[3 * (size_t)order[i]]);
+            }
+        } else {
+            if (best_cost >= task.bounds.area() * count && count <= MAX_SAH_LEAF) continue;
+            float scale = BINS / (task.centroids.max[best_axis] - task.centroids.min[best_axis]);
+            float cmin = task.centroids.min[best_axis];
+            uint32_t* mid = std::partition(order.data() + task.begin, order.data() + task.end, [&](uint32_t p) {
+                return bin_of(centroids[3 * (size_t)p + best_axis], cmin, scale) < best_split;
+            });
+            left.end = right.begin = (uint32_t)(mid - order.data());
+            for (int b = 0; b < BINS; ++b) {
+                BuildTask& side = b < best_split ? left : right;
+                side.bounds.grow(bins[best_axis][b].bounds);
+                side.centroids.grow(bins[best_axis][b].centroids);
+            }
+        }
+
+        uint32_t first = (uint32_t)nodes.size();
+        nodes[task.node].first = first;   // node may move with the push_back below
+        nodes[task.node].count = 0;
+        nodes.push_back(Node());
+        nodes.push_back(Node());
+        left.node = first;
+        right.node = first + 1;
+        stack.push_back(right);
+        stack.push_back(left);
+    }
+
+    std::vector<Prim> ordered(n);
+    for (uint32_t i = 0; i < n; ++i) ordered[i] = prims[order[i]];
+    prims.swap(ordered);
+}
+
+void Bvh::fit_leaf(Node& node, const float* positions) const
+{
+    Box box;
+    const int corners = kind == TRIANGLES ? 3 : 1;
+    for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+        for (int k = 0; k < corners; ++k) box.grow(positions + 3 * (size_t)prims[i].v[k]);
+    }
+    for (int k = 0; k < 3; ++k) {
+        node.min[k] = box.min[k];
+        node.max[k] = box.max[k];
+    }
+}
+
+void Bvh::refit(const float* positions)
+{
+    // Leaves in parallel, then the interior nodes children first
+    JobSystem::global().parallel_for("bvh_refit", 0, nodes.size(), [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            if (nodes[i].count) fit_leaf(nodes[i], positions);
+        }
+    }, 16384);
+    for (size_t i = nodes.size(); i-- > 0;) {
+        Node& node = nodes[i];
+        if (node.count) continue;
+        const Node& a = nodes[node.first];
+        const Node& b = nodes[node.first + 1];
+        for (int k = 0; k < 3; ++k) {
+            node.min[k] = std::min(a.min[k], b.min[k]);
+            node.max[k] = std::max(a.max[k], b.max[k]);
+        }
+    }
+}
+
+float Bvh::get_surface_area() const
+{
+    if (nodes.empty()) return 0.0f;
+    Box box;
+    for (int k = 0; k < 3; ++k) {
+        box.min[k] = nodes[0].min[k];
+        box.max[k] = nodes[0].max[k];
+    }
+    return box.area();
+}
+
+bool Bvh::intersect(const float* positions, const float origin[3], const float dir[3], float tan_tolerance, Hit& hit) const
+{
+    if (nodes.empty()) return false;
+    float inv[3];
+    for (int k = 0; k < 3; ++k) inv[k] = 1.0f / dir[k];
+    float best = FLT_MAX;
+    uint32_t best_prim = NONE;
+
+    // Entry distance of the ray into the node, false if it misses or starts behind best.
+    // For points the box grows by the widest the cone can get inside it.
+    auto enter = [&](const Node& node, float& t_near) -> bool {
+        float margin = 0.0f;
+        if (kind == POINTS) {
+            float far2 = 0.0f;
+            for (int k = 0; k < 3; ++k) {
+                float d = std::max(std::fabs(node.min[k] - origin[k]), std::fabs(node.max[k] - origin[k]));
+                far2 += d * d;
+            }
+            margin = std::sqrt(far2) * tan_tolerance;
+        }
+        float t0 = 0.0f, t1 = best;
+        for (int k = 0; k < 3; ++k) {
+            float a = (node.min[k] - margin - origin[k]) * inv[k];
+            float b = (node.max[k] + margin - origin[k]) * inv[k];
+            if (a > b) std::swap(a, b);
+            t0 = a > t0 ? a : t0;   // NaN (ray in the slab plane) leaves the bound alone
+            t1 = b < t1 ? b : t1;
+        }
+        t_near = t0;
+        return t0 <= t1;
+    };
+
+    struct Entry { uint32_t node; float t; };
+    std::vector<Entry> stack;
+    stack.reserve(64);
+    float t_root;
+    if (enter(nodes[0], t_root)) stack.push_back({0, t_root});
+    while (!stack.empty()) {
+        Entry entry = stack.back();
+        stack.pop_back();
+        if (entry.t > best) continue;
+        const Node& node = nodes[entry.node];
+        if (node.count == 0) {
+            float ta, tb;
+            bool ha = enter(nodes[node.first], ta), hb = enter(nodes[node.first + 1], tb);
+            // Nearer child on top
+            if (ha && hb) {
+                if (ta <= tb) {
+                    stack.push_back({node.first + 1, tb});
+                    stack.push_back({node.first, ta});
+                } else {
+                    stack.push_back({node.first, ta});
+                    stack.push_back({node.first + 1, tb});
+                }
+            } else if (ha) {
+                stack.push_back({node.first, ta});
+            } else if (hb) {
+                stack.push_back({node.first + 1, tb});
+            }
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            const Prim& prim = prims[i];
+            const float* a = positions + 3 * (size_t)prim.v[0];
+            if (kind == POINTS) {
+                float w[3];
+                sub(a, origin, w);
+                float t = dot3(w, dir);
+                if (t <= 0.0f || t >= best) continue;
+                float r = t * tan_tolerance;
+                if (dot3(w, w) - t * t <= r * r) {
+                    best = t;
+                    best_prim = i;
+                }
+                continue;
+            }
+            // Moller-Trumbore, both faces
+            const float* b = positions + 3 * (size_t)prim.v[1];
+            const float* c = positions + 3 * (size_t)prim.v[2];
+            float e1[3], e2[3], pv[3], tv[3], qv[3];
+            sub(b, a, e1);
+            sub(c, a, e2);
+            cross3(dir, e2, pv);
+            float det = dot3(e1, pv);
+            if (std::fabs(det) < 1e-12f) continue;
+            float inv_det = 1.0f / det;
+            sub(origin, a, tv);
+            float u = dot3(tv, pv) * inv_det;
+            if (u < 0.0f || u > 1.0f) continue;
+            cross3(tv, e1, qv);
+            float v = dot3(dir, qv) * inv_det;
+            if (v < 0.0f || u + v > 1.0f) continue;
+            float t = dot3(e2, qv) * inv_det;
+            if (t > 0.0f && t < best) {
+                best = t;
+                best_prim = i;
+            }
+        }
+    }
+    if (best_prim == NONE) return false;
+    hit.prim = best_prim;
+    hit.t = best;
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Bounding volume hierarchy over triangles or points that index a shared position array
+// (x, y, z per vertex). Built top down with the binned surface area heuristic. refit()
+// keeps the tree correct after the positions moved without changing which vertices a
+// primitive uses, in one bottom-up pass; the boxes only get looser, compare
+// get_surface_area() with the value after build() to decide when a rebuild pays off.
+class Bvh {
+public:
+    enum Kind { TRIANGLES, POINTS };
+    static constexpr uint32_t NONE = 0xffffffffu;
+
+    struct Prim {
+        uint32_t v[3];   // vertex numbers, points only use v[0]
+        int32_t object;  // passed through to the hit, see Picker
+    };
+    struct Hit {
+        uint32_t prim = NONE;   // into get_prims()
+        float t = 0.0f;         // distance along the (unit length) ray
+    };
+
+    // Takes prims and reorders them into tree order.
+    void build(Kind kind, std::vector<Prim> prims, const float* positions);
+    void refit(const float* positions);
+    // Nearest primitive along origin + t * dir, t > 0, dir of unit length. Points count as hit
+    // within a cone of half angle atan(tan_tolerance) around the ray, triangles from both sides.
+    bool intersect(const float* positions, const float origin[3], const float dir[3], float tan_tolerance, Hit& hit) const;
+
+    const std::vector<Prim>& get_prims() const { return prims; }
+    size_t get_node_count() const { return nodes.size(); }
+    bool empty() const { return nodes.empty(); }
+    float get_surface_area() const;   // of the root box
+
+private:
+    // Interior nodes have count 0 and their children at first and first + 1, always after
+    // the parent, so walking the array backwards visits children first.
+    struct Node {
+        float min[3];
+        uint32_t first;
+        float max[3];
+        uint32_t count;
+    };
+
+    void fit_leaf(Node& node, const float* positions) const;
+
+    Kind kind = TRIANGLES;
+    std::vector<Node> nodes;
+    std::vector<Prim> prims;
+};
+
+#endif // BVH_H
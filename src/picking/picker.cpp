@@ -0,0 +1,142 @@
+#include "picker.h"
+#include <cmath>
+#include <iostream>
+#include "renderer/projection.h"
+#include "scene/scene.h"
+
+// Refit loosened the boxes this much (root area against the build): rebuild
+static const float REBUILD_AREA_RATIO = 2.0f;
+
+Picker::~Picker()
+{
+    if (build_job) JobSystem::global().wait(build_job);
+}
+
+void Picker::request(float ndc_x, float ndc_y)
+{
+    pending = true;
+    pending_ndc[0] = ndc_x;
+    pending_ndc[1] = ndc_y;
+}
+
+void Picker::set_point_tolerance_deg(float deg)
+{
+    tan_tolerance = std::tan(deg * (float)M_PI / 180.0f);
+}
+
+void Picker::copy_positions(const SceneSnapshot& snap, std::vector<float>& positions)
+{
+    positions.resize(3 * snap.items.size());
+    JobSystem::global().parallel_for("pick_positions", 0, snap.items.size(), [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            for (int k = 0; k < 3; ++k) positions[3 * i + k] = snap.items[i].pos[k];
+        }
+    }, 16384);
+}
+
+// Gathers the primitives on the scene thread (the snapshot is reused once the frame is done),
+// the trees are built by a job.
+void Picker::start_build(const SceneSnapshot& snap)
+{
+    auto next = std::make_shared<Trees>();
+    next->structure_version = snap.structure_version;
+    next->motion_version = snap.motion_version;
+    copy_positions(snap, next->positions);
+    next->ids.resize(snap.items.size());
+    for (size_t i = 0; i < snap.items.size(); ++i) next->ids[i] = snap.items[i].id;
+
+    auto triangles = std::make_shared<std::vector<Bvh::Prim>>();
+    auto points = std::make_shared<std::vector<Bvh::Prim>>();
+    triangles->reserve(snap.indexed.size());
+    for (const auto& idx : snap.indexed) triangles->push_back({{idx[0], idx[1], idx[2]}, -1});
+    size_t first_mesh_item = snap.items.size();
+    for (const auto& range : snap.mesh_ranges) {
+        first_mesh_item = std::min(first_mesh_item, range.first_item);
+        const SceneMesh& mesh = (*snap.meshes)[range.mesh_index];
+        const auto& indices = *mesh.indices;
+        int root = mesh.root->id;
+        // Only the submesh ranges, a mesh that is still loading has indices past its vertices
+        for (const auto& sm : mesh.submeshes) {
+            for (size_t t = sm.indexOffset; t + 2 < sm.indexOffset + sm.indexCount; t += 3) {
+                triangles->push_back({{(uint32_t)(range.first_item + indices[t]), (uint32_t)(range.first_item + indices[t + 1]),
+                                       (uint32_t)(range.first_item + indices[t + 2])}, root});
+            }
+        }
+    }
+    for (size_t i = 0; i < first_mesh_item; ++i) {
+        if (snap.items[i].type == VERTEX) points->push_back({{(uint32_t)i, 0, 0}, snap.items[i].id});
+    }
+
+    build_job = JobSystem::global().run("pick_bvh_build", [this, next, triangles, points] {
+        next->triangles.build(Bvh::TRIANGLES, std::move(*triangles), next->positions.data());
+        next->points.build(Bvh::POINTS, std::move(*points), next->positions.data());
+        next->triangle_area = next->triangles.get_surface_area();
+        next->point_area = next->points.get_surface_area();
+        std::lock_guard<std::mutex> lock(build_mutex);
+        built = next;
+    });
+}
+
+bool Picker::update(const SceneSnapshot& snap, PickResult& result)
+{
+    {
+        std::lock_guard<std::mutex> lock(build_mutex);
+        if (built) trees = std::move(built);
+    }
+    if (build_job && build_job->done.load()) build_job.reset();
+
+    bool stale = !trees || trees->structure_version != snap.structure_version;
+    // One build at a time; a newer structure is built once the running one is in
+    if (stale && !build_job) start_build(snap);
+    if (!pending || stale) return false;
+
+    if (trees->motion_version != snap.motion_version) {
+        copy_positions(snap, trees->positions);
+        trees->triangles.refit(trees->positions.data());
+        trees->points.refit(trees->positions.data());
+        trees->motion_version = snap.motion_version;
+        bool loose = trees->triangles.get_surface_area() > REBUILD_AREA_RATIO * trees->triangle_area ||
+                     trees->points.get_surface_area() > REBUILD_AREA_RATIO * trees->point_area;
+        if (loose && !build_job) start_build(snap);
+    }
+    result = query(snap.camera, pending_ndc[0], pending_ndc[1]);
+    pending = false;
+    return true;
+}
+
+PickResult Picker::query(const CameraState& camera, float ndc_x, float ndc_y) const
+{
+    PickResult result;
+    const ProjectionParams params = make_projection_params(camera);
+    float dir[3];
+    unproject_ndc(params, ndc_x, ndc_y, dir);
+    const float* positions = trees->positions.data();
+
+    Bvh::Hit triangle, point;
+    bool hit_triangle = trees->triangles.intersect(positions, params.cam_pos, dir, 0.0f, triangle);
+    bool hit_point = trees->points.intersect(positions, params.cam_pos, dir, tan_tolerance, point);
+    if (!hit_triangle && !hit_point) return result;
+
+    result.hit = true;
+    if (hit_point && (!hit_triangle || point.t <= triangle.t)) {
+        uint32_t v = trees->points.get_prims()[point.prim].v[0];
+        result.object_id = result.vertex_id = trees->ids[v];
+        result.distance = point.t;
+        for (int k = 0; k < 3; ++k) result.pos[k] = positions[3 * v + k];
+        return result;
+    }
+    const Bvh::Prim& prim = trees->triangles.get_prims()[triangle.prim];
+    result.distance = triangle.t;
+    for (int k = 0; k < 3; ++k) result.pos[k] = params.cam_pos[k] + triangle.t * dir[k];
+    float nearest = INFINITY;
+    for (uint32_t v : prim.v) {
+        float d2 = 0.0f;
+        for (int k = 0; k < 3; ++k) d2 += (positions[3 * v + k] - result.pos[k]) * (positions[3 * v + k] - result.pos[k]);
+        if (d2 < nearest) {
+            nearest = d2;
+            result.vertex_id = trees->ids[v];
+        }
+    }
+    result.object_id = prim.object >= 0 ? prim.object : result.vertex_id;
+    return result;
+}
@@ -0,0 +1,60 @@
+#ifndef PICKER_H
+#define PICKER_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "picking/bvh.h"
+#include "scene/scene_snapshot.h"
+#include "jobs/job_system.h"
+
+struct PickResult {
+    bool hit = false;
+    int object_id = -1;     // mesh root for mesh triangles, otherwise the object hit
+    int vertex_id = -1;     // the point hit, or the triangle corner nearest to the hit
+    float distance = 0.0f;  // from the camera
+    float pos[3] = {0, 0, 0};
+};
+
+// Ray-cast picking against the snapshots the scene hands to the renderer. Keeps one BVH over
+// the triangles (index buffer and mesh triangles) and one over the points (VERTEX items
+// outside meshes), both indexing the item positions.
+//   structure changed (structure_version): both trees are rebuilt by a job, picks wait for it
+//   objects moved (motion_version): the trees are refit, but only when a pick needs them, and
+//   rebuilt by a job once refitting made the boxes much looser
+// An idle update() costs two compares. Scene thread only.
+class Picker {
+public:
+    ~Picker();
+
+    // Asks for the object under (ndc_x, ndc_y), answered by a later update().
+    void request(float ndc_x, float ndc_y);
+    // After every capture. Returns true when it answered the request, result is then set.
+    bool update(const SceneSnapshot& snap, PickResult& result);
+    // Points are hit within this angle around the ray, about half a point sprite.
+    void set_point_tolerance_deg(float deg);
+
+private:
+    struct Trees {
+        Bvh triangles, points;
+        std::vector<float> positions;   // item positions the trees were built on
+        std::vector<int> ids;           // object id per item
+        uint64_t structure_version = 0, motion_version = 0;
+        float triangle_area = 0.0f, point_area = 0.0f;   // root box areas after the build
+    };
+
+    void start_build(const SceneSnapshot& snap);
+    static void copy_positions(const SceneSnapshot& snap, std::vector<float>& positions);
+    PickResult query(const CameraState& camera, float ndc_x, float ndc_y) const;
+
+    std::shared_ptr<Trees> trees;       // current, null before the first build
+    bool pending = false;
+    float pending_ndc[2] = {0, 0};
+    float tan_tolerance = 0.0035f;      // ~0.2 degrees
+
+    std::mutex build_mutex;
+    std::shared_ptr<Trees> built;       // finished by the job, swapped in by update()
+    JobSystem::JobHandle build_job;
+};
+
+#endif // PICKER_H
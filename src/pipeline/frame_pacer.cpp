@@ -0,0 +1,137 @@
+#include "frame_pacer.h"
+#include "SDL3/SDL.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+constexpr int ADAPT_FRAMES = 30;        // consecutive frames before the rate changes
+constexpr double HEADROOM = 0.75;       // work must fit this share of the faster period to go back up
+constexpr uint64_t MIN_SLEEP_NS = 200000;
+constexpr double MIN_MARGIN_NS = 50000.0;
+constexpr double MAX_MARGIN_NS = 4000000.0;
+}
+
+FramePacer::FramePacer(Mode mode, double target_fps)
+    : mode(mode), target_fps(target_fps > 0.0 ? target_fps : 60.0)
+{
+    period_ns = 1.0e9 / this->target_fps;
+    frame_ms.reserve(WINDOW);
+    if (mode == VSYNC) {
+        // Adaptive vsync tears instead of dropping to half rate when a frame is late
+        if (!SDL_GL_SetSwapInterval(-1) && !SDL_GL_SetSwapInterval(1)) {
+            std::cerr << "Could not enable vsync: " << SDL_GetError() << std::endl;
+        }
+    } else {
+        SDL_GL_SetSwapInterval(0);
+    }
+    if (mode == TARGET_FPS) calibrate();
+    const char* names[] = {"uncapped", "vsync", "target"};
+    std::cout << "Frame pacer: " << names[mode];
+    if (mode == TARGET_FPS) std::cout << " " << this->target_fps << " fps, spin margin " << get_spin_margin_ms() << " ms";
+    std::cout << std::endl;
+}
+
+// How late does a 1 ms sleep wake up on this machine? The worst of a few samples plus a bit
+// is where spinning takes over.
+void FramePacer::calibrate()
+{
+    uint64_t worst = 0;
+    for (int i = 0; i < 16; ++i) {
+        uint64_t start = SDL_GetTicksNS();
+        SDL_DelayNS(1000000);
+        uint64_t overshoot = SDL_GetTicksNS() - start;
+        overshoot = overshoot > 1000000 ? overshoot - 1000000 : 0;
+        worst = std::max(worst, overshoot);
+    }
+    spin_margin_ns = std::clamp(worst * 1.25 + MIN_MARGIN_NS, MIN_MARGIN_NS, MAX_MARGIN_NS);
+}
+
+void FramePacer::wait_until(uint64_t deadline)
+{
+    uint64_t now = SDL_GetTicksNS();
+    if (now >= deadline) return;
+    uint64_t remaining = deadline - now;
+    if (remaining > spin_margin_ns + MIN_SLEEP_NS) {
+        uint64_t wake = deadline - (uint64_t)spin_margin_ns;
+        SDL_DelayNS(wake - now);
+        now = SDL_GetTicksNS();
+        // Follow the observed overshoot: grow fast, shrink slowly. Growth per frame is limited
+        // so a single preemption does not turn the whole wait into spinning.
+        double wanted = (now > wake ? (double)(now - wake) : 0.0) * 1.25;
+        if (wanted > spin_margin_ns) spin_margin_ns = std::min(wanted, spin_margin_ns * 1.5);
+        else spin_margin_ns = spin_margin_ns * 0.995 + wanted * 0.005;
+        spin_margin_ns = std::clamp(spin_margin_ns, MIN_MARGIN_NS, MAX_MARGIN_NS);
+    }
+    while (SDL_GetTicksNS() < deadline) {
+        // spin, the last fraction of a millisecond is below the sleep granularity
+    }
+}
+
+void FramePacer::adapt(uint64_t work_ns)
+{
+    if (work_ns > period_ns) {
+        headroom_frames = 0;
+        if (++overrun_frames >= ADAPT_FRAMES) {
+            divisor++;
+            overrun_frames = 0;
+            std::cout << "Frame pacer: frames overrun, dropping to " << target_fps / divisor << " fps" << std::endl;
+        }
+        return;
+    }
+    overrun_frames = 0;
+    if (divisor > 1 && work_ns < HEADROOM * 1.0e9 / (target_fps / (divisor - 1))) {
+        if (++headroom_frames >= ADAPT_FRAMES * 4) {
+            divisor--;
+            headroom_frames = 0;
+            std::cout << "Frame pacer: back to " << target_fps / divisor << " fps" << std::endl;
+        }
+    } else {
+        headroom_frames = 0;
+    }
+}
+
+void FramePacer::end_frame()
+{
+    uint64_t now = SDL_GetTicksNS();
+    if (mode == TARGET_FPS) {
+        // last_present is taken after the previous wait, so this is the frame's own work
+        if (last_present != 0) adapt(now - last_present);
+        period_ns = 1.0e9 / (target_fps / divisor);
+        if (next_deadline == 0 || now > next_deadline + (uint64_t)period_ns) {
+            // First frame or far behind: restart the schedule instead of rushing to catch up
+            next_deadline = now + (uint64_t)period_ns;
+        } else {
+            next_deadline += (uint64_t)period_ns;
+        }
+        wait_until(next_deadline);
+        now = SDL_GetTicksNS();
+    }
+
+    if (last_present != 0) {
+        double ms = (now - last_present) / 1.0e6;
+        if (frame_ms.size() < WINDOW) frame_ms.push_back(ms);
+        else frame_ms[frame_head] = ms;
+        frame_head = (frame_head + 1) % WINDOW;
+    }
+    last_present = now;
+}
+
+FrameTimeMetrics FramePacer::get_metrics() const
+{
+    FrameTimeMetrics m;
+    m.samples = frame_ms.size();
+    if (frame_ms.empty()) return m;
+    double sum = 0.0;
+    for (double v : frame_ms) sum += v;
+    m.mean_ms = sum / frame_ms.size();
+    double sq = 0.0;
+    for (double v : frame_ms) sq += (v - m.mean_ms) * (v - m.mean_ms);
+    m.variance_ms2 = sq / frame_ms.size();
+    m.stddev_ms = std::sqrt(m.variance_ms2);
+    std::vector<double> sorted = frame_ms;
+    std::sort(sorted.begin(), sorted.end());
+    m.p99_ms = sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * 0.99))];
+    m.max_ms = sorted.back();
+    return m;
+}
@@ -0,0 +1,65 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Frame time statistics over the last FramePacer::WINDOW presented frames.
+struct FrameTimeMetrics {
+    double mean_ms = 0.0;
+    double stddev_ms = 0.0;
+    double variance_ms2 = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+    size_t samples = 0;
+};
+
+// Paces presented frames.
+//   uncapped: frames are only measured
+//   vsync:    the swap interval does the pacing (adaptive vsync when the driver offers it)
+//   target:   end_frame() waits for the next deadline of the target rate; it sleeps until
+//             shortly before the deadline and spins the rest. The spin margin starts from a
+//             calibration of the OS sleep overshoot and follows the overshoot seen later.
+// If frames keep overrunning the target, the rate drops to the next divisor of the
+// requested rate (60 -> 30 -> 20 ...) and returns once there is enough headroom again,
+// a steady lower rate is smoother than a rate that misses every other deadline.
+// All timing is in nanoseconds (SDL_GetTicksNS).
+class FramePacer {
+public:
+    enum Mode { UNCAPPED, VSYNC, TARGET_FPS };
+    static constexpr size_t WINDOW = 240;
+
+    FramePacer(Mode mode, double target_fps = 60.0);
+
+    // Call once per presented frame, right after the buffer swap. Waits in TARGET_FPS mode.
+    void end_frame();
+    // Call for loop iterations that presented nothing (idle redraw), the next frame starts a
+    // new schedule and the gap is not counted as a frame time.
+    void idle() { last_present = 0; next_deadline = 0; }
+
+    Mode get_mode() const { return mode; }
+    double get_effective_fps() const { return 1.0e9 / period_ns; }
+    double get_spin_margin_ms() const { return spin_margin_ns / 1.0e6; }
+    FrameTimeMetrics get_metrics() const;
+
+private:
+    void calibrate();
+    void wait_until(uint64_t deadline_ns);
+    void adapt(uint64_t frame_ns);
+
+    Mode mode;
+    double target_fps;
+    int divisor = 1;            // effective rate = target_fps / divisor
+    double period_ns;
+    uint64_t next_deadline = 0;
+    uint64_t last_present = 0;
+    double spin_margin_ns = 1.0e6;
+    int overrun_frames = 0;     // consecutive frames that missed the deadline
+    int headroom_frames = 0;    // consecutive frames that would have fit the faster rate
+
+    std::vector<double> frame_ms;   // ring of presented frame intervals
+    size_t frame_head = 0;
+};
+
+#endif // FRAME_PACER_H
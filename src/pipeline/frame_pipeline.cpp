@@ -0,0 +1,176 @@
+#include "frame_pipeline.h"
+#include "pipeline/input_recording.h"
+#include "renderer/renderer.h"
+#include "scene/scene.h"
+#include "physics_engine/physics_engine.h"
+#include <chrono>
+#include <iostream>
+
+FramePipeline::FramePipeline(std::shared_ptr<SimpleRenderer> renderer, std::shared_ptr<Scene> scene,
+                             PhysicsEngine& physics, int depth)
+    : renderer(renderer), scene(scene), physics(physics)
+{
+    this->depth = depth < 1 ? 1 : (depth > 3 ? 3 : depth);
+    viewport_width = renderer->width;
+    viewport_height = renderer->height;
+    for (int i = 0; i < SLOTS; ++i) {
+        free_snapshots.push(i);
+        free_lists.push(i);
+    }
+    if (this->depth == 2) {
+        workers.emplace_back(&FramePipeline::combined_loop, this);
+    } else if (this->depth == 3) {
+        workers.emplace_back(&FramePipeline::simulation_loop, this);
+        workers.emplace_back(&FramePipeline::build_loop, this);
+    }
+    std::cout << "Frame pipeline depth " << this->depth << std::endl;
+}
+
+FramePipeline::~FramePipeline()
+{
+    stop();
+}
+
+void FramePipeline::stop()
+{
+    stopping = true;
+    for (auto& t : workers) t.join();
+    workers.clear();
+}
+
+void FramePipeline::push_event(const SDL_Event& event)
+{
+    if (!events.push(event)) {
+        std::cerr << "Input queue full, dropping event " << event.type << std::endl;
+    }
+}
+
+void FramePipeline::set_viewport(int width, int height)
+{
+    viewport_width = width;
+    viewport_height = height;
+}
+
+// Spins briefly, then sleeps in 100us steps. Returns false when the pipeline shuts down.
+template <typename Pred>
+bool FramePipeline::wait_until(Pred ready)
+{
+    int spins = 0;
+    while (!ready()) {
+        if (stopping) return false;
+        if (++spins < 64) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+// The simulation may start frame f only while fewer than depth frames are unsubmitted.
+bool FramePipeline::wait_for_credit()
+{
+    return wait_until([&] { return simulated_frames - submitted_frames.load(std::memory_order_acquire) < (uint64_t)depth; });
+}
+
+void FramePipeline::fail(std::exception_ptr error)
+{
+    worker_error = error;
+    has_error = true;
+    stopping = true;
+}
+
+void FramePipeline::simulate(SceneSnapshot& snap)
+{
+    SDL_Event event;
+    if (replay) {
+        uint64_t time_ms;
+        replay_events.clear();
+        if (replay->next_frame(simulated_frames, time_ms, replay_events)) physics.set_clock_ms(time_ms);
+        for (const SDL_Event& e : replay_events) physics.handleEvent(e);
+        while (events.pop(event)) {} // live input does not take part in a replay
+    } else {
+        if (recorder) {
+            Uint64 now = SDL_GetTicks();
+            physics.set_clock_ms(now);
+            recorder->frame(simulated_frames, now);
+        }
+        while (events.pop(event)) {
+            if (recorder) recorder->event(simulated_frames, event);
+            physics.handleEvent(event);
+        }
+    }
+    physics.update();
+    scene->capture(snap, viewport_width.load(), viewport_height.load());
+    snap.frame = simulated_frames++;
+    snap.simulated_ns = SDL_GetTicksNS();
+}
+
+void FramePipeline::simulation_loop()
+{
+    try {
+        while (!stopping) {
+            int slot;
+            if (!wait_for_credit()) return;
+            if (!wait_until([&] { return free_snapshots.pop(slot); })) return;
+            simulate(snapshots[slot]);
+            ready_snapshots.push(slot);
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+}
+
+void FramePipeline::build_loop()
+{
+    try {
+        while (!stopping) {
+            int snap_slot, list_slot;
+            if (!wait_until([&] { return ready_snapshots.pop(snap_slot); })) return;
+            if (!wait_until([&] { return free_lists.pop(list_slot); })) return;
+            renderer->build_render_list(snapshots[snap_slot], lists[list_slot], false);
+            free_snapshots.push(snap_slot);
+            ready_lists.push(list_slot);
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+}
+
+void FramePipeline::combined_loop()
+{
+    try {
+        while (!stopping) {
+            int list_slot;
+            if (!wait_for_credit()) return;
+            if (!wait_until([&] { return free_lists.pop(list_slot); })) return;
+            simulate(snapshots[0]);
+            renderer->build_render_list(snapshots[0], lists[list_slot], false);
+            ready_lists.push(list_slot);
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+}
+
+void FramePipeline::run_frame(SDL_Window* window)
+{
+    if (has_error) std::rethrow_exception(worker_error);
+
+    int slot = 0;
+    if (depth == 1) {
+        simulate(snapshots[0]);
+        renderer->build_render_list(snapshots[0], lists[0], true);
+    } else if (!wait_until([&] { return ready_lists.pop(slot); })) {
+        if (has_error) std::rethrow_exception(worker_error);
+        return;
+    }
+
+    RenderList& list = lists[slot];
+    renderer->submit(list);
+    SDL_GL_SwapWindow(window);
+    // Lets an ingest producer measure write -> screen latency
+    if (list.external_ring && list.external_valid) list.external_ring->report_presented(list.external);
+
+    last_latency_ms = (SDL_GetTicksNS() - list.simulated_ns) / 1.0e6;
+    average_latency_ms = average_latency_ms == 0.0 ? last_latency_ms : average_latency_ms * 0.95 + last_latency_ms * 0.05;
+    if (depth > 1) free_lists.push(slot);
+    submitted_frames.fetch_add(1, std::memory_order_release);
+}
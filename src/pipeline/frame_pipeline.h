@@ -0,0 +1,91 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <exception>
+#include "SDL3/SDL.h"
+#include "pipeline/spsc_queue.h"
+#include "scene/scene_snapshot.h"
+#include "renderer/render_list.h"
+
+class SimpleRenderer;
+class Scene;
+class PhysicsEngine;
+class InputRecorder;
+class InputReplay;
+
+// Staged frame execution: simulation -> render-list build -> GL submission.
+//   depth 1: all stages run in sequence on the GL thread (no added latency)
+//   depth 2: simulation + build on one worker, submission of frame N overlaps frame N+1
+//   depth 3: simulation and build on separate workers, N is submitted while N+1 is built
+//            and N+2 is simulated
+// The scene is only touched by the simulation stage, the GL context only by the thread that
+// calls run_frame(). Stages hand off slot indices of triple-buffered snapshots and render
+// lists through SPSC queues; at most depth frames are in flight at any time.
+class FramePipeline {
+public:
+    FramePipeline(std::shared_ptr<SimpleRenderer> renderer, std::shared_ptr<Scene> scene,
+                  PhysicsEngine& physics, int depth);
+    ~FramePipeline();
+
+    // GL thread: forwards an input event to the simulation stage.
+    void push_event(const SDL_Event& event);
+    // GL thread: window size used for the next simulated frame.
+    void set_viewport(int width, int height);
+    // Before the first frame. Recording: the simulation stage writes its events and clock
+    // to recorder. Replay: it takes them from replay and ignores push_event.
+    void set_recorder(std::shared_ptr<InputRecorder> recorder) { this->recorder = std::move(recorder); }
+    void set_replay(std::shared_ptr<InputReplay> replay) { this->replay = std::move(replay); }
+    // GL thread: obtains the next frame (runs all stages at depth 1), submits and swaps it.
+    // Rethrows exceptions raised by the worker stages.
+    void run_frame(SDL_Window* window);
+
+    // Joins the worker stages, called by the destructor.
+    void stop();
+
+    int get_depth() const { return depth; }
+    // Time from the end of a frame's simulation step (input sampled) to its buffer swap.
+    double get_last_latency_ms() const { return last_latency_ms; }
+    double get_average_latency_ms() const { return average_latency_ms; }
+
+private:
+    static constexpr int SLOTS = 3;
+
+    void simulate(SceneSnapshot& snap);
+    void simulation_loop();
+    void build_loop();
+    void combined_loop();
+    bool wait_for_credit();
+    template <typename Pred> bool wait_until(Pred ready);
+    void fail(std::exception_ptr error);
+
+    std::shared_ptr<SimpleRenderer> renderer;
+    std::shared_ptr<Scene> scene;
+    PhysicsEngine& physics;
+    int depth;
+
+    SceneSnapshot snapshots[SLOTS];
+    RenderList lists[SLOTS];
+    SpscQueue<int> free_snapshots{SLOTS}, ready_snapshots{SLOTS};
+    SpscQueue<int> free_lists{SLOTS}, ready_lists{SLOTS};
+    SpscQueue<SDL_Event> events{1024};
+    std::shared_ptr<InputRecorder> recorder;
+    std::shared_ptr<InputReplay> replay;
+    std::vector<SDL_Event> replay_events;   // simulation stage only
+
+    std::atomic<bool> stopping{false};
+    std::atomic<int> viewport_width{0}, viewport_height{0};
+    std::atomic<uint64_t> submitted_frames{0};
+    uint64_t simulated_frames = 0;   // simulation stage only
+    std::exception_ptr worker_error;
+    std::atomic<bool> has_error{false};
+    std::vector<std::thread> workers;
+
+    double last_latency_ms = 0.0;
+    double average_latency_ms = 0.0;
+};
+
+#endif // FRAME_PIPELINE_H
@@ -0,0 +1,136 @@
+#include "input_recording.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include "renderer/render_stats.h"
+
+using namespace inputrec;
+
+InputRecorder::InputRecorder(const std::string& path, int width, int height)
+    : path(path), file(std::fopen(path.c_str(), "wb"))
+{
+    if (!file) throw std::runtime_error("Cannot create " + path);
+    FileHeader header{MAGIC, VERSION, width, height, (uint32_t)sizeof(SDL_Event), 0};
+    std::fwrite(&header, sizeof(header), 1, file);
+}
+
+InputRecorder::~InputRecorder()
+{
+    bool ok = !std::ferror(file);
+    std::fclose(file);
+    if (!ok) std::cerr << "Writing " << path << " failed, the recording is incomplete" << std::endl;
+    else std::cout << "Recorded " << frames << " frames, " << events << " events to " << path << std::endl;
+}
+
+void InputRecorder::write(const Record& record)
+{
+    std::fwrite(&record, sizeof(record), 1, file);
+}
+
+void InputRecorder::frame(uint64_t frame, uint64_t time_ms)
+{
+    Record record{};
+    record.frame = frame;
+    record.time_ms = time_ms;
+    record.kind = FRAME;
+    write(record);
+    frames++;
+}
+
+void InputRecorder::event(uint64_t frame, const SDL_Event& event)
+{
+    Record record{};
+    record.frame = frame;
+    record.kind = EVENT;
+    record.event = event;
+    write(record);
+    events++;
+}
+
+InputReplay::InputReplay(const std::string& path)
+{
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) throw std::runtime_error("Cannot open " + path);
+    bool ok = std::fread(&header, sizeof(header), 1, f) == 1 && header.magic == MAGIC && header.version == VERSION;
+    if (ok && header.event_bytes != sizeof(SDL_Event)) {
+        std::fclose(f);
+        throw std::runtime_error(path + " was recorded by a build with a different SDL_Event");
+    }
+    Record record;
+    while (ok && std::fread(&record, sizeof(record), 1, f) == 1) {
+        records.push_back(record);
+        if (record.kind == FRAME) frame_count = std::max(frame_count, record.frame + 1);
+    }
+    std::fclose(f);
+    if (!ok) throw std::runtime_error(path + " is not an input recording");
+    std::cout << "Replaying " << path << ": " << frame_count << " frames, " << records.size() - frame_count
+              << " events, " << header.width << "x" << header.height << std::endl;
+}
+
+bool InputReplay::next_frame(uint64_t frame, uint64_t& time_ms, std::vector<SDL_Event>& events)
+{
+    if (frame >= frame_count) return false;
+    time_ms = fixed_step_ms > 0.0 ? (uint64_t)(frame * fixed_step_ms) : 0;
+    while (next < records.size() && records[next].frame <= frame) {
+        const Record& record = records[next++];
+        if (record.frame < frame) continue; // of a frame that was skipped
+        if (record.kind == FRAME) {
+            if (fixed_step_ms <= 0.0) time_ms = record.time_ms;
+        } else {
+            events.push_back(record.event);
+        }
+    }
+    return true;
+}
+
+ReplayReport::ReplayReport(const std::string& csv_path)
+{
+    if (csv_path.empty()) return;
+    csv = std::fopen(csv_path.c_str(), "w");
+    if (!csv) throw std::runtime_error("Cannot create " + csv_path);
+    std::fprintf(csv, "frame,frame_ms,build_ms,submit_ms,gpu_ms,draw_calls,vertices\n");
+}
+
+ReplayReport::~ReplayReport()
+{
+    if (csv) std::fclose(csv);
+}
+
+void ReplayReport::add_frame(uint64_t frame, double ms, const FrameStats& stats)
+{
+    uint64_t now = SDL_GetTicksNS();
+    if (frame_ms.empty()) start_ns = now - (uint64_t)(ms * 1.0e6);
+    end_ns = now;
+    frame_ms.push_back(ms);
+    build_ms += stats.build_ms;
+    submit_ms += stats.submit_ms;
+    if (stats.gpu_valid) {
+        gpu_ms += stats.gpu_total_ms();
+        gpu_frames++;
+    }
+    if (csv) {
+        std::fprintf(csv, "%llu,%.3f,%.3f,%.3f,%.3f,%zu,%zu\n", (unsigned long long)frame, ms, stats.build_ms, stats.submit_ms,
+                     stats.gpu_valid ? stats.gpu_total_ms() : -1.0, stats.draw_calls, stats.vertices_emitted);
+    }
+}
+
+void ReplayReport::print_summary() const
+{
+    if (frame_ms.empty()) {
+        std::printf("Replay: no frames\n");
+        return;
+    }
+    std::vector<double> sorted = frame_ms;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](double p) { return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))]; };
+    double total = 0.0;
+    for (double ms : frame_ms) total += ms;
+    size_t n = frame_ms.size();
+    double seconds = (end_ns - start_ns) / 1.0e9;
+    std::printf("Replay: %zu frames in %.2f s, %.1f fps\n", n, seconds, n / seconds);
+    std::printf("  frame time: mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n", total / n,
+                percentile(0.50), percentile(0.95), percentile(0.99), sorted.back());
+    std::printf("  mean build %.3f ms, submit %.3f ms", build_ms / n, submit_ms / n);
+    if (gpu_frames) std::printf(", GPU %.3f ms (%zu frames with results)", gpu_ms / gpu_frames, gpu_frames);
+    std::printf("\n");
+}
@@ -0,0 +1,105 @@
+#ifndef INPUT_RECORDING_H
+#define INPUT_RECORDING_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "SDL3/SDL.h"
+
+struct FrameStats;
+
+// Input recordings for repeatable performance runs. The simulation stage writes every event it
+// handles with the number of the frame that handled it, and the simulation clock of every
+// frame. A replay hands the same events to the same frames and sets the same clock, so camera
+// flights and animation come out identical however fast the replay runs and whatever the
+// pipeline depth. The file is a FileHeader followed by Records, the SDL_Event stored raw, so a
+// recording is only valid for builds with the same SDL_Event layout (checked by size).
+namespace inputrec {
+
+constexpr uint32_t MAGIC = 0x52494256;   // "VBIR"
+constexpr uint32_t VERSION = 1;
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t width, height;     // window size when recording started, the replay uses it
+    uint32_t event_bytes;      // sizeof(SDL_Event)
+    uint32_t reserved;
+};
+
+enum RecordKind : uint32_t { FRAME = 0, EVENT = 1 };
+
+struct Record {
+    uint64_t frame;
+    uint64_t time_ms;          // FRAME: simulation clock of the frame
+    uint32_t kind;
+    uint32_t reserved;
+    SDL_Event event;           // EVENT only
+};
+
+} // namespace inputrec
+
+class InputRecorder {
+public:
+    // Throws std::runtime_error if path cannot be created.
+    InputRecorder(const std::string& path, int width, int height);
+    ~InputRecorder();
+
+    // Simulation stage: frame starts with clock time_ms, then its events.
+    void frame(uint64_t frame, uint64_t time_ms);
+    void event(uint64_t frame, const SDL_Event& event);
+
+private:
+    void write(const inputrec::Record& record);
+
+    std::string path;
+    std::FILE* file;
+    uint64_t frames = 0, events = 0;
+};
+
+class InputReplay {
+public:
+    // Throws std::runtime_error if path is not a recording of this build.
+    explicit InputReplay(const std::string& path);
+
+    int get_width() const { return header.width; }
+    int get_height() const { return header.height; }
+    uint64_t get_frame_count() const { return frame_count; }
+    // Replaces the recorded clock with frame * step_ms.
+    void set_fixed_step_ms(double step_ms) { fixed_step_ms = step_ms; }
+
+    // Simulation stage, frames in order: the clock of frame and its events. False once frame
+    // is past the recording.
+    bool next_frame(uint64_t frame, uint64_t& time_ms, std::vector<SDL_Event>& events);
+
+private:
+    inputrec::FileHeader header;
+    std::vector<inputrec::Record> records;
+    size_t next = 0;
+    uint64_t frame_count = 0;
+    double fixed_step_ms = 0.0;
+};
+
+// Frame times of a replay: one CSV line per frame and a summary at the end.
+class ReplayReport {
+public:
+    // Empty csv_path: summary only. Throws std::runtime_error if the file cannot be created.
+    explicit ReplayReport(const std::string& csv_path);
+    ~ReplayReport();
+
+    // GL thread, after every presented frame. stats is RenderStats::latest(), its GPU times
+    // trail the frame by RenderStats::QUERY_FRAMES.
+    void add_frame(uint64_t frame, double frame_ms, const FrameStats& stats);
+    // Prints the summary to stdout.
+    void print_summary() const;
+
+private:
+    std::FILE* csv = nullptr;
+    std::vector<double> frame_ms;
+    double build_ms = 0.0, submit_ms = 0.0, gpu_ms = 0.0;
+    size_t gpu_frames = 0;
+    uint64_t start_ns = 0, end_ns = 0;
+};
+
+#endif // INPUT_RECORDING_H
@@ -0,0 +1,48 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity is rounded up to a power of two; push fails when full, pop fails when empty.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        slots.resize(cap);
+        mask = cap - 1;
+    }
+
+    bool push(const T& value) {
+        size_t tail = write_pos.load(std::memory_order_relaxed);
+        if (tail - read_pos.load(std::memory_order_acquire) > mask) return false;
+        slots[tail & mask] = value;
+        write_pos.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& out) {
+        size_t head = read_pos.load(std::memory_order_relaxed);
+        if (head == write_pos.load(std::memory_order_acquire)) return false;
+        out = slots[head & mask];
+        read_pos.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return write_pos.load(std::memory_order_acquire) - read_pos.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask = 0;
+    // Separate cache lines so producer and consumer do not false-share their counters.
+    alignas(64) std::atomic<size_t> write_pos{0};
+    alignas(64) std::atomic<size_t> read_pos{0};
+};
+
+#endif // SPSC_QUEUE_H
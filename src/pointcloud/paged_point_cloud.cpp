@@ -0,0 +1,189 @@
+#include "paged_point_cloud.h"
+#include "renderer/clipper.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+using pointcloud::PageInfo;
+
+namespace {
+// Page reads in flight; more only queue up behind each other in the job system
+const int MAX_LOADING = 8;
+
+bool seek(std::FILE* f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, (long long)offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// Squared distance from p to the box, 0 inside
+float distance2(const PageInfo& page, const float p[3]) {
+    float d2 = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        float d = std::max(std::max(page.min[k] - p[k], 0.0f), p[k] - page.max[k]);
+        d2 += d * d;
+    }
+    return d2;
+}
+
+// The box is invisible if all eight corners are outside the same clip plane
+bool in_view(const ClipVolume& volume, const PageInfo& page) {
+    uint8_t all = 0xff;
+    for (int c = 0; c < 8 && all; ++c) {
+        float corner[3] = {(c & 1) ? page.max[0] : page.min[0], (c & 2) ? page.max[1] : page.min[1], (c & 4) ? page.max[2] : page.min[2]};
+        all &= clip_outcode(volume, corner);
+    }
+    return all == 0;
+}
+}
+
+PagedPointCloud::PagedPointCloud(const std::string& path, size_t cache_bytes)
+    : path(path), cache_bytes(cache_bytes)
+{
+    std::error_code ec;
+    const uint64_t file_size = std::filesystem::file_size(path, ec);
+    std::FILE* f = ec ? nullptr : std::fopen(path.c_str(), "rb");
+    if (!f) throw std::runtime_error("Cannot open " + path);
+    bool ok = std::fread(&header, sizeof(header), 1, f) == 1 && header.magic == pointcloud::PAGE_FILE_MAGIC &&
+              header.version == pointcloud::PAGE_FILE_VERSION;
+    // The table and the records must lie inside the file, before allocating anything for them
+    const uint64_t table_end = sizeof(header) + (uint64_t)header.page_count * sizeof(PageInfo);
+    ok = ok && table_end <= file_size && header.points_offset >= table_end && header.points_offset <= file_size &&
+         header.point_count <= (file_size - header.points_offset) / sizeof(shm::PointRecord);
+    if (ok) {
+        pages.resize(header.page_count);
+        ok = pages.empty() || std::fread(pages.data(), sizeof(PageInfo), pages.size(), f) == pages.size();
+    }
+    std::fclose(f);
+    if (!ok) throw std::runtime_error(path + " is not a point cloud page file");
+    // Loads read count records at first_point without further checks
+    for (size_t i = 0; i < pages.size(); ++i) {
+        const PageInfo& page = pages[i];
+        if (page.count > pointcloud::MAX_PAGE_POINTS || page.first_point > header.point_count ||
+            page.count > header.point_count - page.first_point) {
+            throw std::runtime_error(path + ": page " + std::to_string(i) + " is out of range");
+        }
+    }
+    slots.resize(pages.size());
+    std::cout << "Point cloud " << path << ": " << header.point_count << " points in " << pages.size()
+              << " pages, cache " << (cache_bytes >> 20) << " MB" << std::endl;
+}
+
+PagedPointCloud::~PagedPointCloud()
+{
+    std::vector<JobSystem::JobHandle> pending;
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        pending.swap(jobs);
+    }
+    for (const auto& job : pending) JobSystem::global().wait(job);
+}
+
+void PagedPointCloud::start_load(uint32_t page)
+{
+    slots[page].loading = true;
+    loading_bytes += page_bytes(pages[page]);
+    loading++;
+    PageInfo info = pages[page];
+    uint64_t offset = header.points_offset + info.first_point * sizeof(shm::PointRecord);
+    std::lock_guard<std::mutex> lock(done_mutex);
+    jobs.push_back(JobSystem::global().run("point_page", [this, page, info, offset] {
+        // Every page started ends up in done, or its slot and the loading count stay taken
+        std::shared_ptr<std::vector<shm::PointRecord>> points;
+        bool ok = false;
+        try {
+            points = std::make_shared<std::vector<shm::PointRecord>>(info.count);
+            std::FILE* f = std::fopen(path.c_str(), "rb");
+            ok = f && seek(f, offset) && std::fread(points->data(), sizeof(shm::PointRecord), info.count, f) == info.count;
+            if (f) std::fclose(f);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+        if (!ok) {
+            std::cerr << "Reading page " << page << " of " << path << " failed" << std::endl;
+            points = std::make_shared<std::vector<shm::PointRecord>>(); // resident but empty, not retried every frame
+        }
+        std::lock_guard<std::mutex> lock(done_mutex);
+        done.emplace_back(page, std::move(points));
+        loaded_count++;
+    }));
+}
+
+// Drops the least recently used page that is not wanted this frame.
+bool PagedPointCloud::evict_one(uint64_t frame)
+{
+    size_t victim = resident.size();
+    for (size_t i = 0; i < resident.size(); ++i) {
+        const Slot& s = slots[resident[i]];
+        if (s.last_used == frame) continue;
+        if (victim == resident.size() || s.last_used < slots[resident[victim]].last_used) victim = i;
+    }
+    if (victim == resident.size()) return false;
+    Slot& s = slots[resident[victim]];
+    resident_bytes -= s.points->size() * sizeof(shm::PointRecord);
+    s.points.reset();
+    resident[victim] = resident.back();
+    resident.pop_back();
+    return true;
+}
+
+void PagedPointCloud::update(const CameraState& camera, std::vector<Page>& out, std::vector<WorldBounds>& out_bounds)
+{
+    frame++;
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        for (auto& d : done) {
+            Slot& s = slots[d.first];
+            s.loading = false;
+            s.points = std::move(d.second);
+            loading_bytes -= page_bytes(pages[d.first]);
+            loading--;
+            resident_bytes += s.points->size() * sizeof(shm::PointRecord);
+            resident.push_back(d.first);
+        }
+        done.clear();
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [](const JobSystem::JobHandle& j) { return j->done.load(); }), jobs.end());
+    }
+
+    // Pages in view, nearest first, as many as fit the cache
+    ClipVolume volume = make_clip_volume(camera);
+    const float eye[3] = {camera.pos[0], camera.pos[1], camera.pos[2]};
+    std::vector<std::pair<float, uint32_t>> ranked;
+    for (uint32_t i = 0; i < pages.size(); ++i) {
+        if (in_view(volume, pages[i])) ranked.push_back({distance2(pages[i], eye), i});
+    }
+    std::sort(ranked.begin(), ranked.end());
+    size_t wanted_bytes = 0, wanted = 0;
+    while (wanted < ranked.size() && wanted_bytes + page_bytes(pages[ranked[wanted].second]) <= cache_bytes) {
+        wanted_bytes += page_bytes(pages[ranked[wanted].second]);
+        slots[ranked[wanted].second].last_used = frame;
+        wanted++;
+    }
+
+    for (size_t i = 0; i < wanted; ++i) {
+        uint32_t page = ranked[i].second;
+        Slot& s = slots[page];
+        if (s.points) {
+            if (!s.points->empty()) {
+                out.push_back(s.points);
+                WorldBounds bounds;
+                for (int k = 0; k < 3; ++k) {
+                    bounds.min[k] = pages[page].min[k];
+                    bounds.max[k] = pages[page].max[k];
+                }
+                out_bounds.push_back(bounds);
+            }
+            continue;
+        }
+        if (s.loading || loading >= MAX_LOADING) continue;
+        // Make room from pages that fell out of view, never from wanted ones
+        size_t need = page_bytes(pages[page]);
+        while (resident_bytes + loading_bytes + need > cache_bytes && evict_one(frame)) {}
+        if (resident_bytes + loading_bytes + need > cache_bytes) break;
+        start_load(page);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef PAGED_POINT_CLOUD_H
+#define PAGED_POINT_CLOUD_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "pointcloud/point_cloud_import.h"
+#include "scene/scene_snapshot.h"
+#include "jobs/job_system.h"
+
+// A page file (see point_cloud_import.h) shown through a fixed size page cache. Every
+// update() ranks the pages in view by distance to the camera, loads the nearest ones that
+// fit the cache on the job system and evicts the least recently used pages nobody wants, so
+// resident plus in flight pages stay below cache_bytes whatever the size of the file. Only
+// the page table is kept in memory for the whole file (40 bytes per page).
+// Frames still in the pipeline keep their pages alive after eviction, so with a pipeline
+// depth of d the pages of up to d older frames may exist on top of the cap.
+class PagedPointCloud {
+public:
+    using Page = std::shared_ptr<const std::vector<shm::PointRecord>>;
+
+    // Throws std::runtime_error if path is not a readable page file.
+    PagedPointCloud(const std::string& path, size_t cache_bytes);
+    ~PagedPointCloud();
+
+    // Scene thread: picks the pages for camera and appends the resident ones to out, their
+    // bounds to out_bounds.
+    void update(const CameraState& camera, std::vector<Page>& out, std::vector<WorldBounds>& out_bounds);
+
+    uint64_t get_point_count() const { return header.point_count; }
+    size_t get_page_count() const { return pages.size(); }
+    size_t get_resident_bytes() const { return resident_bytes; }
+    // Changes whenever a page finished loading, thread safe.
+    uint64_t get_loaded_count() const { return loaded_count.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        Page points;
+        bool loading = false;
+        uint64_t last_used = 0;    // frame the page was last wanted
+    };
+
+    static size_t page_bytes(const pointcloud::PageInfo& page) { return (size_t)page.count * sizeof(shm::PointRecord); }
+    void start_load(uint32_t page);
+    bool evict_one(uint64_t frame);
+
+    std::string path;
+    size_t cache_bytes;
+    pointcloud::PageFileHeader header;
+    std::vector<pointcloud::PageInfo> pages;
+
+    // Scene thread only
+    std::vector<Slot> slots;
+    std::vector<uint32_t> resident;    // pages with points
+    size_t resident_bytes = 0, loading_bytes = 0;
+    int loading = 0;
+    uint64_t frame = 0;
+
+    // Filled by the load jobs
+    std::mutex done_mutex;
+    std::vector<std::pair<uint32_t, Page>> done;
+    std::vector<JobSystem::JobHandle> jobs;
+    std::atomic<uint64_t> loaded_count{0};
+};
+
+#endif // PAGED_POINT_CLOUD_H
@@ -0,0 +1,473 @@
+#include "point_cloud_import.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using shm::PointRecord;
+
+namespace pointcloud {
+namespace {
+
+bool seek(std::FILE* f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, (long long)offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+enum PlyType { PLY_INVALID, PLY_I8, PLY_U8, PLY_I16, PLY_U16, PLY_I32, PLY_U32, PLY_F32, PLY_F64 };
+
+PlyType parse_ply_type(const std::string& name) {
+    if (name == "char" || name == "int8") return PLY_I8;
+    if (name == "uchar" || name == "uint8") return PLY_U8;
+    if (name == "short" || name == "int16") return PLY_I16;
+    if (name == "ushort" || name == "uint16") return PLY_U16;
+    if (name == "int" || name == "int32") return PLY_I32;
+    if (name == "uint" || name == "uint32") return PLY_U32;
+    if (name == "float" || name == "float32") return PLY_F32;
+    if (name == "double" || name == "float64") return PLY_F64;
+    return PLY_INVALID;
+}
+
+size_t ply_type_size(PlyType t) {
+    switch (t) {
+        case PLY_I8: case PLY_U8: return 1;
+        case PLY_I16: case PLY_U16: return 2;
+        case PLY_I32: case PLY_U32: case PLY_F32: return 4;
+        case PLY_F64: return 8;
+        default: return 0;
+    }
+}
+
+double read_ply_value(const uint8_t* p, PlyType t, bool swap) {
+    uint8_t b[8];
+    size_t n = ply_type_size(t);
+    for (size_t i = 0; i < n; ++i) b[i] = swap ? p[n - 1 - i] : p[i];
+    switch (t) {
+        case PLY_I8: return (int8_t)b[0];
+        case PLY_U8: return b[0];
+        case PLY_I16: { int16_t v; std::memcpy(&v, b, 2); return v; }
+        case PLY_U16: { uint16_t v; std::memcpy(&v, b, 2); return v; }
+        case PLY_I32: { int32_t v; std::memcpy(&v, b, 4); return v; }
+        case PLY_U32: { uint32_t v; std::memcpy(&v, b, 4); return v; }
+        case PLY_F32: { float v; std::memcpy(&v, b, 4); return v; }
+        case PLY_F64: { double v; std::memcpy(&v, b, 8); return v; }
+        default: return 0.0;
+    }
+}
+
+// Colors are stored as bytes; float channels are 0..1, 16 bit ones 0..65535
+uint8_t to_color(double v, PlyType t) {
+    if (t == PLY_F32 || t == PLY_F64) v *= 255.0;
+    else if (t == PLY_U16 || t == PLY_I16) v /= 257.0;
+    return (uint8_t)std::min(255.0, std::max(0.0, v));
+}
+
+// Reads the points of one input file front to back through a fixed block buffer.
+class PointSource {
+public:
+    explicit PointSource(const std::string& path) : path(path) {
+        file = std::fopen(path.c_str(), "rb");
+        if (!file) throw std::runtime_error("Cannot open " + path);
+        block.resize(BLOCK_BYTES);
+        std::string ext = std::filesystem::path(path).extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        try {
+            if (ext == ".ply") parse_ply_header();
+            else detect_xyz();
+        } catch (...) {
+            std::fclose(file);
+            throw;
+        }
+        rewind();
+    }
+    ~PointSource() { std::fclose(file); }
+
+    void rewind() {
+        seek(file, data_offset);
+        pos = len = 0;
+        eof = false;
+        records_read = 0;
+    }
+
+    // Appends up to max points to out, returns how many (0 at the end of the input).
+    size_t read(std::vector<PointRecord>& out, size_t max) {
+        size_t n = 0;
+        while (n < max) {
+            PointRecord r;
+            bool ok = false;
+            switch (format) {
+                case PLY_BINARY: ok = next_ply_binary(r); break;
+                case PLY_ASCII: ok = next_ascii(r, true); break;
+                case XYZ_ASCII: ok = next_ascii(r, false); break;
+                case XYZ_FLOAT: ok = next_xyz_float(r); break;
+            }
+            if (!ok) break;
+            out.push_back(r);
+            n++;
+        }
+        return n;
+    }
+
+private:
+    enum Format { PLY_BINARY, PLY_ASCII, XYZ_ASCII, XYZ_FLOAT };
+    static constexpr size_t BLOCK_BYTES = 4u << 20;
+    struct Property {
+        std::string name;
+        PlyType type;
+        size_t offset;
+    };
+
+    // Makes n bytes available at block[pos], false at the end of the file.
+    bool ensure(size_t n) {
+        if (len - pos >= n) return true;
+        if (eof) return false;
+        std::memmove(block.data(), block.data() + pos, len - pos);
+        len -= pos;
+        pos = 0;
+        while (len < n && !eof) {
+            size_t got = std::fread(block.data() + len, 1, block.size() - len, file);
+            if (got == 0) eof = true;
+            len += got;
+        }
+        return len - pos >= n;
+    }
+
+    // Next line without the newline; false at the end of the file.
+    bool next_line(const char*& line, size_t& size) {
+        for (;;) {
+            const uint8_t* begin = block.data() + pos;
+            const void* nl = std::memchr(begin, '\n', len - pos);
+            if (nl) {
+                line = (const char*)begin;
+                size = (const uint8_t*)nl - begin;
+                pos += size + 1;
+                return true;
+            }
+            // Last line without a newline, or one longer than the block
+            if (eof || (pos == 0 && len == block.size())) {
+                if (pos == len) return false;
+                line = (const char*)begin;
+                size = len - pos;
+                pos = len;
+                return true;
+            }
+            ensure(len - pos + 1);
+        }
+    }
+
+    void parse_ply_header() {
+        const char* line;
+        size_t size;
+        bool in_vertex = false, seen_vertex = false;
+        size_t header_bytes = 0;
+        std::string fmt;
+        while (next_line(line, size)) {
+            header_bytes += size + 1;
+            std::istringstream ls(std::string(line, size));
+            std::string tag;
+            ls >> tag;
+            if (tag == "format") {
+                ls >> fmt;
+            } else if (tag == "element") {
+                std::string name;
+                uint64_t count = 0;
+                ls >> name >> count;
+                if (name == "vertex") {
+                    if (seen_vertex) throw std::runtime_error(path + ": two vertex elements");
+                    in_vertex = seen_vertex = true;
+                    vertex_count = count;
+                } else {
+                    if (!seen_vertex && count > 0) throw std::runtime_error(path + ": vertex must be the first element");
+                    in_vertex = false;
+                }
+            } else if (tag == "property" && in_vertex) {
+                std::string type, name;
+                ls >> type >> name;
+                if (type == "list") throw std::runtime_error(path + ": list properties on vertices are not supported");
+                PlyType t = parse_ply_type(type);
+                if (t == PLY_INVALID) throw std::runtime_error(path + ": unknown property type " + type);
+                properties.push_back({name, t, stride});
+                stride += ply_type_size(t);
+            } else if (tag == "end_header") {
+                break;
+            }
+        }
+        if (fmt == "ascii") format = PLY_ASCII;
+        else if (fmt == "binary_little_endian" || fmt == "binary_big_endian") format = PLY_BINARY;
+        else throw std::runtime_error(path + ": unsupported PLY format '" + fmt + "'");
+        swap = fmt == "binary_big_endian";
+        auto find = [&](std::initializer_list<const char*> names) -> int {
+            for (size_t i = 0; i < properties.size(); ++i)
+                for (const char* n : names) if (properties[i].name == n) return (int)i;
+            return -1;
+        };
+        xyz[0] = find({"x"}); xyz[1] = find({"y"}); xyz[2] = find({"z"});
+        rgb[0] = find({"red", "r"}); rgb[1] = find({"green", "g"}); rgb[2] = find({"blue", "b"});
+        if (xyz[0] < 0 || xyz[1] < 0 || xyz[2] < 0) throw std::runtime_error(path + ": vertex has no x/y/z");
+        data_offset = header_bytes;
+    }
+
+    // Text if the start of the file is printable, otherwise raw float32 triplets
+    void detect_xyz() {
+        ensure(4096);
+        size_t n = std::min<size_t>(len, 4096);
+        bool text = n > 0;
+        for (size_t i = 0; i < n && text; ++i) {
+            uint8_t c = block[i];
+            text = c == '\n' || c == '\r' || c == '\t' || (c >= 32 && c < 127);
+        }
+        format = text ? XYZ_ASCII : XYZ_FLOAT;
+        data_offset = 0;
+    }
+
+    bool next_ply_binary(PointRecord& r) {
+        if (records_read >= vertex_count || !ensure(stride)) return false;
+        const uint8_t* rec = block.data() + pos;
+        for (int k = 0; k < 3; ++k) r.pos[k] = (float)read_ply_value(rec + properties[xyz[k]].offset, properties[xyz[k]].type, swap);
+        fill_color(r, [&](int k) { return read_ply_value(rec + properties[rgb[k]].offset, properties[rgb[k]].type, swap); });
+        pos += stride;
+        records_read++;
+        return true;
+    }
+
+    bool next_ascii(PointRecord& r, bool ply) {
+        const char* line;
+        size_t size;
+        while ((!ply || records_read < vertex_count) && next_line(line, size)) {
+            // Numbers up to the line end, strtod stops at the newline we cut off
+            std::string text(line, size);
+            double v[16];
+            int n = 0;
+            const char* s = text.c_str();
+            char* end;
+            while (n < 16) {
+                double d = std::strtod(s, &end);
+                if (end == s) break;
+                v[n++] = d;
+                s = end;
+            }
+            if (ply) records_read++;
+            if (n < 3) continue; // blank line, comment or header of an .xyz
+            if (ply) {
+                for (int k = 0; k < 3; ++k) r.pos[k] = xyz[k] < n ? (float)v[xyz[k]] : 0.0f;
+                fill_color(r, [&](int k) { return rgb[k] < n ? v[rgb[k]] : 0.0; });
+            } else {
+                for (int k = 0; k < 3; ++k) r.pos[k] = (float)v[k];
+                for (int k = 0; k < 3; ++k) r.color[k] = n >= 6 ? (uint8_t)std::min(255.0, std::max(0.0, v[3 + k])) : DEFAULT_GRAY;
+                r.color[3] = 0;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    bool next_xyz_float(PointRecord& r) {
+        if (!ensure(12)) return false;
+        std::memcpy(r.pos, block.data() + pos, 12);
+        r.color[0] = r.color[1] = r.color[2] = DEFAULT_GRAY;
+        r.color[3] = 0;
+        pos += 12;
+        return true;
+    }
+
+    template <typename Get>
+    void fill_color(PointRecord& r, Get get) {
+        for (int k = 0; k < 3; ++k) r.color[k] = rgb[k] >= 0 ? to_color(get(k), properties[rgb[k]].type) : DEFAULT_GRAY;
+        r.color[3] = 0;
+    }
+
+    static constexpr uint8_t DEFAULT_GRAY = 200;
+
+    std::string path;
+    std::FILE* file = nullptr;
+    Format format = XYZ_ASCII;
+    uint64_t data_offset = 0;
+    uint64_t vertex_count = 0, records_read = 0;
+    std::vector<Property> properties;
+    size_t stride = 0;
+    int xyz[3] = {-1, -1, -1}, rgb[3] = {-1, -1, -1};
+    bool swap = false;
+    std::vector<uint8_t> block;
+    size_t pos = 0, len = 0;
+    bool eof = false;
+};
+
+// Uniform grid over the bounds with about one cell per page worth of points. Flat axes
+// (e.g. a single scan line or a terrain with no height) get a single cell.
+struct Grid {
+    float min[3], cell[3];
+    uint32_t dims[3];
+
+    Grid(const float lo[3], const float hi[3], uint64_t cells) {
+        float ext[3], largest = 0.0f;
+        for (int k = 0; k < 3; ++k) largest = std::max(largest, ext[k] = hi[k] - lo[k]);
+        int axes = 0;
+        double volume = 1.0;
+        for (int k = 0; k < 3; ++k) {
+            if (ext[k] > largest * 1e-4f) {
+                axes++;
+                volume *= ext[k];
+            }
+        }
+        double edge = axes ? std::pow(volume / std::max<uint64_t>(cells, 1), 1.0 / axes) : 1.0;
+        for (int k = 0; k < 3; ++k) {
+            min[k] = lo[k];
+            dims[k] = (ext[k] > largest * 1e-4f) ? (uint32_t)std::max(1.0, std::min(1024.0, std::round(ext[k] / edge))) : 1;
+            cell[k] = std::max(ext[k] / dims[k], 1e-20f);
+        }
+    }
+
+    uint64_t count() const { return (uint64_t)dims[0] * dims[1] * dims[2]; }
+
+    uint64_t index(const float p[3]) const {
+        uint64_t c[3];
+        for (int k = 0; k < 3; ++k) {
+            float f = (p[k] - min[k]) / cell[k];
+            c[k] = f <= 0.0f ? 0 : std::min<uint64_t>(dims[k] - 1, (uint64_t)f);
+        }
+        return (c[2] * dims[1] + c[1]) * dims[0] + c[0];
+    }
+
+    void bounds(uint64_t i, float lo[3], float hi[3]) const {
+        uint64_t c[3] = {i % dims[0], (i / dims[0]) % dims[1], i / ((uint64_t)dims[0] * dims[1])};
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = min[k] + c[k] * cell[k];
+            hi[k] = lo[k] + cell[k];
+        }
+    }
+};
+
+} // namespace
+
+void import_point_cloud(const std::string& input, const std::string& output, const ImportSettings& settings)
+{
+    auto start = std::chrono::steady_clock::now();
+    const size_t BATCH = 1 << 16;
+    PointSource source(input);
+    std::vector<PointRecord> batch;
+    batch.reserve(BATCH);
+
+    // Pass 1: bounds and count
+    float lo[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    float hi[3] = {-lo[0], -lo[1], -lo[2]};
+    uint64_t total = 0;
+    while (source.read(batch, BATCH)) {
+        for (const auto& r : batch) {
+            if (!std::isfinite(r.pos[0]) || !std::isfinite(r.pos[1]) || !std::isfinite(r.pos[2])) continue;
+            for (int k = 0; k < 3; ++k) {
+                lo[k] = std::min(lo[k], r.pos[k]);
+                hi[k] = std::max(hi[k], r.pos[k]);
+            }
+            total++;
+        }
+        batch.clear();
+    }
+    if (total == 0) throw std::runtime_error(input + ": no points");
+    std::cout << "Point cloud " << input << ": " << total << " points" << std::endl;
+
+    // Pass 2: points per cell
+    const size_t page_points = std::min<size_t>(std::max<size_t>(settings.page_points, 1024), MAX_PAGE_POINTS);
+    Grid grid(lo, hi, std::min<uint64_t>((total + page_points - 1) / page_points, 1u << 20));
+    std::vector<uint64_t> cell_count(grid.count(), 0);
+    source.rewind();
+    while (source.read(batch, BATCH)) {
+        for (const auto& r : batch) {
+            if (std::isfinite(r.pos[0]) && std::isfinite(r.pos[1]) && std::isfinite(r.pos[2])) cell_count[grid.index(r.pos)]++;
+        }
+        batch.clear();
+    }
+
+    // Pages: cells in grid order, split into page_points pieces
+    std::vector<PageInfo> pages;
+    std::vector<uint64_t> cell_cursor(grid.count(), 0);   // next point index of each cell
+    uint64_t first = 0;
+    for (uint64_t c = 0; c < grid.count(); ++c) {
+        cell_cursor[c] = first;
+        PageInfo page{};
+        grid.bounds(c, page.min, page.max);
+        for (uint64_t done = 0; done < cell_count[c]; done += page.count) {
+            page.first_point = first + done;
+            page.count = (uint32_t)std::min<uint64_t>(page_points, cell_count[c] - done);
+            pages.push_back(page);
+        }
+        first += cell_count[c];
+    }
+
+    PageFileHeader header{};
+    header.magic = PAGE_FILE_MAGIC;
+    header.version = PAGE_FILE_VERSION;
+    header.point_count = total;
+    header.page_count = (uint32_t)pages.size();
+    for (int k = 0; k < 3; ++k) {
+        header.min[k] = lo[k];
+        header.max[k] = hi[k];
+    }
+    header.points_offset = (sizeof(PageFileHeader) + pages.size() * sizeof(PageInfo) + 4095) & ~uint64_t(4095);
+
+    // Written to a temporary name, a crashed import never looks like a finished page file
+    std::string temp = output + ".tmp";
+    std::FILE* out = std::fopen(temp.c_str(), "wb");
+    if (!out) throw std::runtime_error("Cannot create " + temp);
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+              (pages.empty() || std::fwrite(pages.data(), sizeof(PageInfo), pages.size(), out) == pages.size());
+
+    // Pass 3: scatter. Every cell buffers a few points, the buffers share memory_bytes
+    size_t per_cell = std::max<size_t>(16, std::min<size_t>(4096, settings.memory_bytes / sizeof(PointRecord) / grid.count()));
+    std::vector<std::vector<PointRecord>> buffers(grid.count());
+    auto flush = [&](uint64_t c) {
+        std::vector<PointRecord>& buf = buffers[c];
+        if (buf.empty()) return;
+        ok = ok && seek(out, header.points_offset + cell_cursor[c] * sizeof(PointRecord)) &&
+             std::fwrite(buf.data(), sizeof(PointRecord), buf.size(), out) == buf.size();
+        cell_cursor[c] += buf.size();
+        buf.clear();
+    };
+    source.rewind();
+    while (ok && source.read(batch, BATCH)) {
+        for (const auto& r : batch) {
+            if (!std::isfinite(r.pos[0]) || !std::isfinite(r.pos[1]) || !std::isfinite(r.pos[2])) continue;
+            uint64_t c = grid.index(r.pos);
+            if (buffers[c].capacity() == 0) buffers[c].reserve(per_cell);
+            buffers[c].push_back(r);
+            if (buffers[c].size() == per_cell) flush(c);
+        }
+        batch.clear();
+    }
+    for (uint64_t c = 0; c < grid.count(); ++c) flush(c);
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        std::remove(temp.c_str());
+        throw std::runtime_error("Writing " + output + " failed");
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, output, ec);
+    if (ec) throw std::runtime_error("Cannot rename " + temp + ": " + ec.message());
+
+    std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+    std::cout << "Page file " << output << ": " << pages.size() << " pages, grid " << grid.dims[0] << "x" << grid.dims[1]
+              << "x" << grid.dims[2] << ", " << took.count() << " s" << std::endl;
+}
+
+bool is_page_file(const std::string& path)
+{
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    PageFileHeader header{};
+    bool ok = std::fread(&header, sizeof(header), 1, f) == 1 && header.magic == PAGE_FILE_MAGIC && header.version == PAGE_FILE_VERSION;
+    std::fclose(f);
+    return ok;
+}
+
+} // namespace pointcloud
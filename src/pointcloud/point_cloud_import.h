@@ -0,0 +1,54 @@
+#ifndef POINT_CLOUD_IMPORT_H
+#define POINT_CLOUD_IMPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "ingest/shm_ring.h"
+
+// Page file: a point cloud reordered into spatial pages that can be loaded one at a time.
+//   PageFileHeader | PageInfo[page_count] | shm::PointRecord[point_count]
+// The points of a page are contiguous. Records are the ingest ring's PointRecord, so the
+// renderer projects paged and ingested points the same way. Little endian.
+namespace pointcloud {
+
+constexpr uint32_t PAGE_FILE_MAGIC = 0x43504256; // "VBPC"
+constexpr uint32_t PAGE_FILE_VERSION = 1;
+constexpr uint32_t MAX_PAGE_POINTS = 1u << 22;   // 64 MB of records, readers reject larger pages
+
+struct PageFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t point_count;
+    uint32_t page_count;
+    uint32_t reserved;
+    float min[3], max[3];
+    uint64_t points_offset;   // byte offset of the first PointRecord
+};
+
+struct PageInfo {
+    float min[3], max[3];     // bounds of the grid cell the page belongs to
+    uint64_t first_point;     // index into the point records
+    uint32_t count;
+    uint32_t reserved;
+};
+static_assert(sizeof(PageInfo) == 40, "PageInfo is part of the file format");
+
+struct ImportSettings {
+    size_t page_points = 65536;          // upper bound of points per page (1 MB), at most MAX_PAGE_POINTS
+    size_t memory_bytes = 256u << 20;    // write buffers of the import, the grid comes on top
+};
+
+// Converts a point cloud into a page file with three streaming passes over the input (bounds,
+// cell histogram, scatter), so memory use does not depend on the input size. Inputs:
+//   .ply  binary little/big endian or ascii; vertex x y z (float/double), optional red green blue
+//   .xyz  ascii lines "x y z [r g b]", or raw little endian float32 x y z triplets
+// Throws std::runtime_error on unreadable or unsupported input.
+void import_point_cloud(const std::string& input, const std::string& output, const ImportSettings& settings = ImportSettings());
+
+// True for files import_point_cloud writes (checks the magic).
+bool is_page_file(const std::string& path);
+
+} // namespace pointcloud
+
+#endif // POINT_CLOUD_IMPORT_H
@@ -0,0 +1,89 @@
+#include "clipper.h"
+#include <cmath>
+#include "math/own_math.h"
+
+namespace {
+constexpr float NEAR_DISTANCE = 0.01f;
+constexpr float GUARD_BAND = 1.25f;     // side planes sit this factor outside the FOV edges
+constexpr float MAX_HALF_ANGLE = 85.0f; // the two side planes only form a wedge below 90 degrees
+
+float plane_distance(const ClipVolume& v, int plane, const float pos[3]) {
+    return v.normal[plane][0] * (pos[0] - v.cam_pos[0])
+         + v.normal[plane][1] * (pos[1] - v.cam_pos[1])
+         + v.normal[plane][2] * (pos[2] - v.cam_pos[2]) - v.offset[plane];
+}
+
+void set_plane(ClipVolume& v, float x, float y, float z, float offset) {
+    int i = v.plane_count++;
+    v.normal[i][0] = x;
+    v.normal[i][1] = y;
+    v.normal[i][2] = z;
+    v.offset[i] = offset;
+}
+}
+
+ClipVolume make_clip_volume(const CameraState& camera) {
+    ClipVolume v;
+    for (int k = 0; k < 3; ++k) v.cam_pos[k] = camera.pos[k];
+    const std::vector<float>& o = camera.orientation;
+
+    // The angular model puts a point at the screen center when it lies along (-o.x, o.y, o.z)
+    // (see make_projection_params), that is the view direction.
+    Vector3 forward = normalize({-o[0], o[1], o[2]});
+    set_plane(v, forward.x, forward.y, forward.z, NEAR_DISTANCE);
+
+    // Screen x is the horizontal angle to the view direction, so the FOV edges are vertical
+    // planes through the camera. Skipped when looking straight up or down.
+    float hx = -o[0], hy = o[1];
+    float hlen = std::sqrt(hx * hx + hy * hy);
+    if (hlen < 1e-6f) return v;
+    hx /= hlen;
+    hy /= hlen;
+    float half_angle = std::fmin(camera.fov_width_deg * 500.0f * GUARD_BAND, MAX_HALF_ANGLE) * (float)M_PI / 180.0f;
+    // Inward normals: the horizontal view direction rotated by +-(90 - half_angle)
+    float c = std::sin(half_angle), s = std::cos(half_angle);
+    set_plane(v, hx * c - hy * s, hx * s + hy * c, 0.0f, 0.0f);
+    set_plane(v, hx * c + hy * s, -hx * s + hy * c, 0.0f, 0.0f);
+    return v;
+}
+
+uint8_t clip_outcode(const ClipVolume& volume, const float pos[3]) {
+    uint8_t code = 0;
+    for (int i = 0; i < volume.plane_count; ++i) {
+        if (plane_distance(volume, i, pos) < 0.0f) code |= (uint8_t)(1u << i);
+    }
+    return code;
+}
+
+int clip_triangle(const ClipVolume& volume, const ClipVertex in[3], ClipVertex out[MAX_CLIPPED_VERTICES]) {
+    ClipVertex buffers[2][MAX_CLIPPED_VERTICES];
+    const ClipVertex* src = in;
+    int count = 3;
+    for (int p = 0; p < volume.plane_count && count > 0; ++p) {
+        // Last plane writes straight into out
+        ClipVertex* dst = (p == volume.plane_count - 1) ? out : buffers[p & 1];
+        int n = 0;
+        for (int i = 0; i < count; ++i) {
+            const ClipVertex& a = src[i];
+            const ClipVertex& b = src[(i + 1) % count];
+            float da = plane_distance(volume, p, a.pos);
+            float db = plane_distance(volume, p, b.pos);
+            if (da >= 0.0f) dst[n++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                // Edge crosses the plane, add the intersection
+                float t = da / (da - db);
+                ClipVertex& x = dst[n++];
+                for (int k = 0; k < 3; ++k) {
+                    x.pos[k] = a.pos[k] + (b.pos[k] - a.pos[k]) * t;
+                    x.color[k] = a.color[k] + (b.color[k] - a.color[k]) * t;
+                }
+            }
+        }
+        src = dst;
+        count = n;
+    }
+    if (src != out) {
+        for (int i = 0; i < count; ++i) out[i] = src[i];
+    }
+    return count;
+}
@@ -0,0 +1,36 @@
+#ifndef CLIPPER_H
+#define CLIPPER_H
+
+#include <cstdint>
+#include "scene/scene_snapshot.h"
+
+// Triangle clipping in camera space (world axes, origin at the camera) before the angular
+// projection. A triangle that reaches behind the camera would otherwise get one corner
+// wrapped by +-360 degrees of azimuth and cover the whole screen as a sliver.
+// Clip planes: the near plane and the left/right edges of the horizontal FOV (widened by a
+// guard band, the GPU clips the rest). Vertical edges need no clipping, elevation never wraps.
+struct ClipVolume {
+    static constexpr int MAX_PLANES = 3;
+    float normal[MAX_PLANES][3];
+    float offset[MAX_PLANES];     // inside: dot(normal, p - cam_pos) >= offset
+    int plane_count = 0;
+    float cam_pos[3];
+};
+
+struct ClipVertex {
+    float pos[3];
+    float color[3];
+};
+
+// One triangle clipped against MAX_PLANES planes has at most 3 + MAX_PLANES corners.
+constexpr int MAX_CLIPPED_VERTICES = 3 + ClipVolume::MAX_PLANES;
+
+ClipVolume make_clip_volume(const CameraState& camera);
+// Bit i set: pos is outside plane i. A triangle whose outcodes AND to non-zero is invisible,
+// one whose outcodes OR to zero can be projected as is.
+uint8_t clip_outcode(const ClipVolume& volume, const float pos[3]);
+// Sutherland-Hodgman: clips the triangle against every plane, writes the resulting convex
+// polygon (colors interpolated) to out and returns its corner count, 0 if nothing is left.
+int clip_triangle(const ClipVolume& volume, const ClipVertex in[3], ClipVertex out[MAX_CLIPPED_VERTICES]);
+
+#endif // CLIPPER_H
@@ -0,0 +1,118 @@
+#include "draw_batcher.h"
+#include "scene/scene.h"
+#include "renderer/gl_state.h"
+#include <algorithm>
+#include <iostream>
+
+DrawBatcher::DrawBatcher()
+{
+    multi_draw_indirect = GLEW_ARB_multi_draw_indirect || GLEW_VERSION_4_3;
+    glGenBuffers(1, &element_buffer);
+    if (multi_draw_indirect) {
+        command_stream = std::make_unique<StreamBuffer>(GL_DRAW_INDIRECT_BUFFER, 64 * sizeof(DrawElementsIndirectCommand), 3);
+    }
+    std::cout << "Draw batcher: " << (multi_draw_indirect ? "glMultiDrawElementsIndirect" : "glDrawElementsBaseVertex loop") << std::endl;
+}
+
+DrawBatcher::~DrawBatcher()
+{
+    command_stream.reset();
+    GLState::global().delete_buffer(element_buffer);
+}
+
+void DrawBatcher::sync_meshes(const std::vector<SceneMesh>& meshes)
+{
+    // Same meshes in the same slots: nothing to do. A removed mesh or a loaded scene can
+    // leave a list of the same length with other meshes, so compare them one by one.
+    bool same = meshes.size() == synced_indices.size();
+    for (size_t i = 0; same && i < meshes.size(); ++i) same = meshes[i].indices == synced_indices[i];
+    if (same) return;
+    // Rebuilding everything keeps the buffer tightly packed.
+    synced_indices.clear();
+    mesh_first_index.clear();
+    mesh_first_material.clear();
+    material_tints.clear();
+    std::vector<uint32_t> all_indices;
+    for (const auto& mesh : meshes) {
+        mesh_first_index.push_back((GLuint)all_indices.size());
+        mesh_first_material.push_back((int)material_tints.size());
+        all_indices.insert(all_indices.end(), mesh.indices->begin(), mesh.indices->end());
+        synced_indices.push_back(mesh.indices);
+        for (const auto& mat : mesh.materials) material_tints.push_back(mat.Kd);
+    }
+    GLState::global().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, all_indices.size() * sizeof(uint32_t), all_indices.data(), GL_STATIC_DRAW);
+    pending_upload += all_indices.size() * sizeof(uint32_t);
+    index_count = all_indices.size();
+}
+
+void DrawBatcher::add_mesh(size_t mesh_index, const SceneMesh& mesh, GLuint program, GLint base_vertex)
+{
+    if (mesh_index >= synced_indices.size()) return; // not uploaded yet
+    for (const auto& sm : mesh.submeshes) {
+        if (sm.indexCount == 0) continue;
+        QueuedDraw d;
+        d.key.program = program;
+        d.key.material = sm.material < 0 ? -1 : mesh_first_material[mesh_index] + sm.material;
+        d.cmd.count = sm.indexCount;
+        d.cmd.instanceCount = 1;
+        d.cmd.firstIndex = mesh_first_index[mesh_index] + sm.indexOffset;
+        d.cmd.baseVertex = base_vertex;
+        d.cmd.baseInstance = 0;
+        queued.push_back(d);
+    }
+}
+
+void DrawBatcher::flush(GLint tint_location)
+{
+    draw_calls = 0;
+    uploaded_bytes = pending_upload;
+    pending_upload = 0;
+    if (queued.empty()) return;
+    std::stable_sort(queued.begin(), queued.end(),
+                     [](const QueuedDraw& a, const QueuedDraw& b) { return a.key < b.key; });
+
+    GLState& gl = GLState::global();
+    gl.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
+
+    DrawElementsIndirectCommand* commands = nullptr;
+    size_t command_offset = 0;
+    if (multi_draw_indirect) {
+        command_stream->begin_frame((queued.size() + 1) * sizeof(DrawElementsIndirectCommand));
+        commands = static_cast<DrawElementsIndirectCommand*>(
+            command_stream->allocate(queued.size() * sizeof(DrawElementsIndirectCommand), sizeof(DrawElementsIndirectCommand), command_offset));
+        for (size_t i = 0; i < queued.size(); ++i) commands[i] = queued[i].cmd;
+        uploaded_bytes += queued.size() * sizeof(DrawElementsIndirectCommand);
+        command_stream->flush();
+        gl.bind_buffer(GL_DRAW_INDIRECT_BUFFER, command_stream->get_buffer());
+    }
+
+    size_t i = 0;
+    while (i < queued.size()) {
+        // [i, end) share the same state
+        size_t end = i + 1;
+        while (end < queued.size() && queued[end].key == queued[i].key) ++end;
+        const BatchKey& key = queued[i].key;
+        gl.use_program(key.program);
+        Vector3 tint = key.material < 0 ? Vector3{1, 1, 1} : material_tints[key.material];
+        gl.uniform3f(tint_location, tint.x, tint.y, tint.z);
+
+        if (multi_draw_indirect) {
+            const void* indirect = (const void*)(command_offset + i * sizeof(DrawElementsIndirectCommand));
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, indirect, (GLsizei)(end - i), 0);
+            ++draw_calls;
+        } else {
+            for (size_t k = i; k < end; ++k) {
+                const auto& cmd = queued[k].cmd;
+                glDrawElementsBaseVertex(GL_TRIANGLES, cmd.count, GL_UNSIGNED_INT,
+                                         (const void*)(cmd.firstIndex * sizeof(uint32_t)), cmd.baseVertex);
+                ++draw_calls;
+            }
+        }
+        i = end;
+    }
+
+    if (multi_draw_indirect) command_stream->end_frame();
+    gl.uniform3f(tint_location, 1.0f, 1.0f, 1.0f);
+    queued.clear();
+}
@@ -0,0 +1,77 @@
+#ifndef DRAW_BATCHER_H
+#define DRAW_BATCHER_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <vector>
+#include <memory>
+#include "math/own_math.h"
+#include "renderer/stream_buffer.h"
+
+struct SceneMesh;
+
+// Layout mandated by GL for glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;
+};
+
+// Everything that forces a state change between two indexed draws.
+struct BatchKey {
+    GLuint program = 0;
+    int material = -1;   // index into the batcher's material table, -1 = untinted
+    bool operator<(const BatchKey& o) const {
+        return program != o.program ? program < o.program : material < o.material;
+    }
+    bool operator==(const BatchKey& o) const { return program == o.program && material == o.material; }
+};
+
+// Collects the submesh ranges of all scene meshes for one frame, sorts them by program and
+// material and issues one glMultiDrawElementsIndirect per state change. Mesh indices live in a
+// single static element buffer, vertices are referenced through baseVertex so every mesh vertex
+// is projected once per frame instead of once per triangle corner.
+class DrawBatcher {
+public:
+    DrawBatcher();
+    ~DrawBatcher();
+
+    // Uploads the index lists of newly added meshes. Cheap when nothing changed.
+    void sync_meshes(const std::vector<SceneMesh>& meshes);
+    // Queues every submesh of meshes[mesh_index]; its vertices start at base_vertex in the vertex buffer.
+    void add_mesh(size_t mesh_index, const SceneMesh& mesh, GLuint program, GLint base_vertex);
+    // Issues the queued draws from the bound vertex array and clears the queue. tint_location is
+    // the material color uniform. State changes go through GLState.
+    void flush(GLint tint_location);
+
+    size_t get_draw_calls() const { return draw_calls; }
+    size_t get_index_count() const { return index_count; }
+    // Bytes sent to GL by the last sync_meshes + flush (indices and indirect commands).
+    size_t get_uploaded_bytes() const { return uploaded_bytes; }
+    bool uses_multi_draw_indirect() const { return multi_draw_indirect; }
+
+private:
+    struct QueuedDraw {
+        BatchKey key;
+        DrawElementsIndirectCommand cmd;
+    };
+
+    GLuint element_buffer = 0;
+    // Index list of every uploaded mesh. Every loaded mesh has its own, and holding them keeps
+    // the addresses from being reused, so comparing them tells whether the list is the same.
+    std::vector<std::shared_ptr<const std::vector<uint32_t>>> synced_indices;
+    size_t index_count = 0;
+    std::vector<GLuint> mesh_first_index;     // offset of each mesh's indices in element_buffer
+    std::vector<int> mesh_first_material;     // offset of each mesh's materials in material_tints
+    std::vector<Vector3> material_tints;      // diffuse color per material
+    std::vector<QueuedDraw> queued;
+    std::unique_ptr<StreamBuffer> command_stream;
+    bool multi_draw_indirect = false;
+    size_t draw_calls = 0;
+    size_t pending_upload = 0;
+    size_t uploaded_bytes = 0;
+};
+
+#endif // DRAW_BATCHER_H
@@ -0,0 +1,218 @@
+#include "gl_state.h"
+#include <algorithm>
+
+GLState& GLState::global()
+{
+    static GLState state;
+    return state;
+}
+
+void GLState::begin_frame()
+{
+    issued = 0;
+    elided = 0;
+}
+
+GLState::BufferSlot GLState::slot_of(GLenum target)
+{
+    switch (target) {
+        case GL_ARRAY_BUFFER: return SLOT_ARRAY;
+        case GL_DRAW_INDIRECT_BUFFER: return SLOT_DRAW_INDIRECT;
+        case GL_PIXEL_UNPACK_BUFFER: return SLOT_PIXEL_UNPACK;
+        default: return SLOT_COUNT;
+    }
+}
+
+void GLState::use_program(GLuint p)
+{
+    if (!changed(p != program)) return;
+    glUseProgram(p);
+    program = p;
+}
+
+void GLState::bind_vertex_array(GLuint v)
+{
+    if (!changed(v != vao)) return;
+    glBindVertexArray(v);
+    vao = v;
+}
+
+void GLState::bind_buffer(GLenum target, GLuint buffer)
+{
+    if (target == GL_ELEMENT_ARRAY_BUFFER) {
+        auto it = vao == UNKNOWN ? element_buffers.end() : element_buffers.find(vao);
+        if (!changed(it == element_buffers.end() || it->second != buffer)) return;
+        glBindBuffer(target, buffer);
+        if (vao != UNKNOWN) element_buffers[vao] = buffer;
+        return;
+    }
+    BufferSlot slot = slot_of(target);
+    if (!changed(slot == SLOT_COUNT || buffers[slot] != buffer)) return;
+    glBindBuffer(target, buffer);
+    if (slot != SLOT_COUNT) buffers[slot] = buffer;
+}
+
+void GLState::bind_framebuffer(GLenum target, GLuint framebuffer)
+{
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    if (!changed((read && read_framebuffer != framebuffer) || (draw && draw_framebuffer != framebuffer))) return;
+    glBindFramebuffer(target, framebuffer);
+    if (read) read_framebuffer = framebuffer;
+    if (draw) draw_framebuffer = framebuffer;
+}
+
+void GLState::bind_texture_2d(GLuint t)
+{
+    if (!changed(t != texture)) return;
+    glBindTexture(GL_TEXTURE_2D, t);
+    texture = t;
+}
+
+void GLState::set_blend(bool enabled)
+{
+    if (!changed(blend != (int)enabled)) return;
+    if (enabled) glEnable(GL_BLEND);
+    else glDisable(GL_BLEND);
+    blend = enabled;
+}
+
+void GLState::blend_func(GLenum src, GLenum dst)
+{
+    if (!changed(src != blend_src || dst != blend_dst)) return;
+    glBlendFunc(src, dst);
+    blend_src = src;
+    blend_dst = dst;
+}
+
+void GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    std::array<GLint, 4> v = {x, y, width, height};
+    if (!changed(!view_known || v != view)) return;
+    glViewport(x, y, width, height);
+    view = v;
+    view_known = true;
+}
+
+void GLState::clear_color(float r, float g, float b, float a)
+{
+    std::array<float, 4> c = {r, g, b, a};
+    if (!changed(!clear_known || c != clear)) return;
+    glClearColor(r, g, b, a);
+    clear = c;
+    clear_known = true;
+}
+
+void GLState::uniform3f(GLint location, float x, float y, float z)
+{
+    std::array<float, 3> value = {x, y, z};
+    if (program == UNKNOWN || location < 0) {
+        changed(true);
+        glUniform3f(location, x, y, z);
+        return;
+    }
+    uint64_t key = (uint64_t)program << 32 | (uint32_t)location;
+    auto it = uniforms.find(key);
+    if (!changed(it == uniforms.end() || it->second != value)) return;
+    glUniform3f(location, x, y, z);
+    uniforms[key] = value;
+}
+
+void GLState::bind_vertex_format(VertexFormat format, GLuint buffer)
+{
+    for (const auto& fa : format_arrays) {
+        if (fa.format == format && fa.buffer == buffer) {
+            bind_vertex_array(fa.vao);
+            return;
+        }
+    }
+    FormatArray fa{format, buffer, 0};
+    glGenVertexArrays(1, &fa.vao);
+    bind_vertex_array(fa.vao);
+    bind_buffer(GL_ARRAY_BUFFER, buffer);
+    switch (format) {
+        case VERTEX_POS2_COLOR3:
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(2 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+            break;
+        default: break;
+    }
+    format_arrays.push_back(fa);
+}
+
+void GLState::delete_buffer(GLuint buffer)
+{
+    if (!buffer) return;
+    // Vertex arrays reading from it are useless, and the name comes back for a new buffer
+    for (auto it = format_arrays.begin(); it != format_arrays.end();) {
+        if (it->buffer == buffer) {
+            delete_vertex_array(it->vao);
+            it = format_arrays.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    glDeleteBuffers(1, &buffer);
+    for (GLuint& b : buffers) if (b == buffer) b = 0;
+    // GL only unbinds it from the current vertex array, the others are unknown now
+    for (auto it = element_buffers.begin(); it != element_buffers.end();) {
+        if (it->second != buffer) ++it;
+        else if (it->first == vao) (it++)->second = 0;
+        else it = element_buffers.erase(it);
+    }
+}
+
+void GLState::delete_vertex_array(GLuint v)
+{
+    if (!v) return;
+    glDeleteVertexArrays(1, &v);
+    element_buffers.erase(v);
+    if (vao == v) vao = 0;
+}
+
+void GLState::delete_program(GLuint p)
+{
+    if (!p) return;
+    // A program in use is only deleted once it is replaced, its binding stays valid
+    glDeleteProgram(p);
+    for (auto it = uniforms.begin(); it != uniforms.end();) {
+        if ((GLuint)(it->first >> 32) == p) it = uniforms.erase(it);
+        else ++it;
+    }
+}
+
+void GLState::delete_framebuffer(GLuint framebuffer)
+{
+    if (!framebuffer) return;
+    glDeleteFramebuffers(1, &framebuffer);
+    if (read_framebuffer == framebuffer) read_framebuffer = 0;
+    if (draw_framebuffer == framebuffer) draw_framebuffer = 0;
+}
+
+void GLState::delete_texture(GLuint t)
+{
+    if (!t) return;
+    glDeleteTextures(1, &t);
+    if (texture == t) texture = 0;
+}
+
+void GLState::invalidate()
+{
+    program = vao = read_framebuffer = draw_framebuffer = texture = UNKNOWN;
+    std::fill(std::begin(buffers), std::end(buffers), UNKNOWN);
+    element_buffers.clear();
+    blend = -1;
+    blend_src = blend_dst = UNKNOWN;
+    view_known = false;
+    clear_known = false;
+    uniforms.clear();
+}
+
+void GLState::release()
+{
+    for (const auto& fa : format_arrays) glDeleteVertexArrays(1, &fa.vao);
+    format_arrays.clear();
+    invalidate();
+}
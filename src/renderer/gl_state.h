@@ -0,0 +1,96 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Interleaved vertex layouts, each gets its attribute setup once per vertex buffer.
+enum VertexFormat {
+    VERTEX_POS2_COLOR3,   // x, y, r, g, b floats, attributes 0 and 1
+    VERTEX_FORMAT_COUNT
+};
+
+// Thin cache in front of the GL binding state: program, vertex array, buffers, framebuffers,
+// 2d texture (unit 0), blending, viewport, clear color and vec3 uniforms. A call that would
+// set what is already set is skipped. Only works when every renderer module goes through it,
+// including the deletes, since GL unbinds deleted objects and hands their names out again.
+// State it cannot know (first use, after invalidate()) is always set.
+// Counts the calls it issued and skipped since begin_frame(). GL thread only.
+class GLState {
+public:
+    // The state of the one GL context, created on first use.
+    static GLState& global();
+
+    // Starts the per frame counters.
+    void begin_frame();
+    size_t get_issued_calls() const { return issued; }
+    size_t get_elided_calls() const { return elided; }
+
+    void use_program(GLuint program);
+    void bind_vertex_array(GLuint vao);
+    // GL_ELEMENT_ARRAY_BUFFER is tracked per vertex array, like GL stores it.
+    void bind_buffer(GLenum target, GLuint buffer);
+    // GL_FRAMEBUFFER binds both read and draw.
+    void bind_framebuffer(GLenum target, GLuint framebuffer);
+    void bind_texture_2d(GLuint texture);
+    void set_blend(bool enabled);
+    void blend_func(GLenum src, GLenum dst);
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void clear_color(float r, float g, float b, float a);
+    // location of the program in use
+    void uniform3f(GLint location, float x, float y, float z);
+
+    // Binds the prebuilt vertex array reading format from buffer; the attribute pointers are
+    // specified when the pair is first seen, later binds are a single glBindVertexArray.
+    void bind_vertex_format(VertexFormat format, GLuint buffer);
+
+    void delete_buffer(GLuint buffer);
+    void delete_vertex_array(GLuint vao);
+    void delete_program(GLuint program);
+    void delete_framebuffer(GLuint framebuffer);
+    void delete_texture(GLuint texture);
+
+    // After GL calls that bypassed the cache: everything is set again on its next use.
+    void invalidate();
+    // Deletes the prebuilt vertex arrays and forgets the state, before the context goes away.
+    void release();
+
+private:
+    GLState() { invalidate(); }
+
+    static constexpr GLuint UNKNOWN = 0xffffffffu;
+    enum BufferSlot { SLOT_ARRAY, SLOT_DRAW_INDIRECT, SLOT_PIXEL_UNPACK, SLOT_COUNT };
+    static BufferSlot slot_of(GLenum target);   // SLOT_COUNT: not cached
+
+    // Counts one call, returns true if it has to be issued
+    bool changed(bool differs) {
+        if (differs) ++issued; else ++elided;
+        return differs;
+    }
+
+    struct FormatArray {
+        VertexFormat format;
+        GLuint buffer;
+        GLuint vao;
+    };
+
+    GLuint program, vao, read_framebuffer, draw_framebuffer, texture;
+    GLuint buffers[SLOT_COUNT];
+    std::unordered_map<GLuint, GLuint> element_buffers;   // per vertex array
+    int blend;                                            // -1 unknown
+    GLenum blend_src, blend_dst;
+    std::array<GLint, 4> view;
+    bool view_known;
+    std::array<float, 4> clear;
+    bool clear_known;
+    std::unordered_map<uint64_t, std::array<float, 3>> uniforms;   // program << 32 | location
+    std::vector<FormatArray> format_arrays;
+    size_t issued = 0, elided = 0;
+};
+
+#endif // GL_STATE_H
@@ -0,0 +1,585 @@
+#include "occlusion_culler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include "jobs/job_system.h"
+#include "scene/scene.h"
+
+#if defined(__GNUC__)
+#define OCCLUSION_SIMD 1
+#endif
+
+// Occluder candidates kept per source (index buffer, each mesh) and occluders per frame
+static const size_t CANDIDATES = 1024;
+static const size_t MAX_OCCLUDERS = 2048;
+// Smaller occluders cover about no pixel center
+static const float MIN_OCCLUDER_PIXELS = 1.0f;
+static const int VERIFY_SAMPLES = 32;
+// The projection is angular, so a projected edge is a curve. Occluders are cut into a grid of
+// 2^level segments per edge until the segments are straight to SPLIT_PIXELS; the outer edges of
+// the parts are then pulled inward by what is left, so the drawn shape stays inside the true one
+static const float SPLIT_PIXELS = 0.5f;
+static const int MAX_SPLIT_LEVEL = 4;
+static const size_t MAX_OCCLUDER_PARTS = 16384;
+static const float BEND_MARGIN = 1.25f;     // bend is sampled at three points per segment
+
+using Clock = std::chrono::steady_clock;
+typedef std::array<uint32_t,3> TriangleIndices;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static float world_area(const std::vector<SnapshotItem>& items, const TriangleIndices& t) {
+    const float* a = items[t[0]].pos;
+    const float* b = items[t[1]].pos;
+    const float* c = items[t[2]].pos;
+    float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]}, e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+    return 0.5f * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+}
+
+static void keep_largest(std::vector<std::pair<float, TriangleIndices>>& ranked, size_t count) {
+    if (ranked.size() <= count) return;
+    std::nth_element(ranked.begin(), ranked.begin() + count, ranked.end(),
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+    ranked.resize(count);
+}
+
+// The count largest triangles by world area of corners(0) .. corners(n - 1), in parallel.
+// item_offset is added to the corners for the area only (mesh triangles are stored relative).
+template <class Corners>
+static void largest_triangles(const std::vector<SnapshotItem>& items, size_t n, size_t item_offset, Corners corners,
+                              std::vector<std::pair<float, TriangleIndices>>& best) {
+    std::mutex mutex;
+    JobSystem::global().parallel_for("occluder_candidates", 0, n, [&](size_t b, size_t e) {
+        std::vector<std::pair<float, TriangleIndices>> local;
+        local.reserve(e - b);
+        for (size_t i = b; i < e; ++i) {
+            TriangleIndices t = corners(i);
+            TriangleIndices abs = {(uint32_t)(t[0] + item_offset), (uint32_t)(t[1] + item_offset), (uint32_t)(t[2] + item_offset)};
+            float area = world_area(items, abs);
+            if (area > 0.0f) local.push_back({area, t});
+        }
+        keep_largest(local, CANDIDATES);
+        std::lock_guard<std::mutex> lock(mutex);
+        best.insert(best.end(), local.begin(), local.end());
+        if (best.size() > 4 * CANDIDATES) keep_largest(best, CANDIDATES);
+    }, 16384);
+    keep_largest(best, CANDIDATES);
+}
+
+static size_t first_mesh_item(const SceneSnapshot& snap) {
+    return snap.mesh_ranges.empty() ? snap.items.size() : snap.mesh_ranges.front().first_item;
+}
+
+void OcclusionCuller::update_candidates(const SceneSnapshot& snap)
+{
+    const size_t flat = first_mesh_item(snap);
+    if (snap.structure_version != candidates_version) {
+        candidates_version = snap.structure_version;
+        std::vector<std::pair<float, TriangleIndices>> best;
+        largest_triangles(snap.items, snap.indexed.size(), 0, [&](size_t i) { return snap.indexed[i]; }, best);
+        indexed_candidates.clear();
+        for (const auto& b : best) indexed_candidates.push_back(b.second);
+
+        // Blocks of plain points only: 2d shapes are screen space, and vertices of index
+        // buffer triangles must be projected for the triangles
+        std::vector<uint8_t> referenced(flat, 0);
+        for (const auto& idx : snap.indexed) {
+            for (uint32_t v : idx) referenced[v] = 1;
+        }
+        block_cullable.assign((flat + BLOCK - 1) / BLOCK, 1);
+        for (size_t i = 0; i < flat; ++i) {
+            if (snap.items[i].type != VERTEX || referenced[i]) block_cullable[i / BLOCK] = 0;
+        }
+    }
+
+    // Meshes publish their triangles in chunks, reselect once a quarter more arrived
+    if (snap.meshes && mesh_candidates.size() < snap.meshes->size()) mesh_candidates.resize(snap.meshes->size());
+    for (const auto& range : snap.mesh_ranges) {
+        const SceneMesh& mesh = (*snap.meshes)[range.mesh_index];
+        size_t index_count = 0;
+        for (const auto& sm : mesh.submeshes) index_count += sm.indexCount;
+        MeshCandidates& mc = mesh_candidates[range.mesh_index];
+        if (index_count == mc.index_count) continue;
+        if (mc.index_count > 0 && index_count > mc.index_count && index_count < mc.index_count + mc.index_count / 4) continue;
+        mc.index_count = index_count;
+        const auto& indices = *mesh.indices;
+        std::vector<std::pair<float, TriangleIndices>> best;
+        for (const auto& sm : mesh.submeshes) {
+            largest_triangles(snap.items, sm.indexCount / 3, range.first_item, [&](size_t i) {
+                size_t t = sm.indexOffset + 3 * i;
+                return TriangleIndices{indices[t], indices[t + 1], indices[t + 2]};
+            }, best);
+        }
+        keep_largest(best, CANDIDATES);
+        mc.triangles.clear();
+        for (const auto& b : best) mc.triangles.push_back(b.second);
+    }
+}
+
+void OcclusionCuller::select_occluders(const SceneSnapshot& snap, const ClipVolume& volume)
+{
+    const float* eye = params.cam_pos;
+    std::vector<std::pair<float, TriangleIndices>> ranked;
+    // Solid angle estimate, orientation ignored: the rasterizer measures the real coverage
+    auto consider = [&](const TriangleIndices& t) {
+        const float* p[3] = {snap.items[t[0]].pos, snap.items[t[1]].pos, snap.items[t[2]].pos};
+        if (clip_outcode(volume, p[0]) | clip_outcode(volume, p[1]) | clip_outcode(volume, p[2])) return;
+        float d2 = 0.0f;
+        for (int k = 0; k < 3; ++k) {
+            float c = (p[0][k] + p[1][k] + p[2][k]) / 3.0f - eye[k];
+            d2 += c * c;
+        }
+        if (d2 <= 0.0f) return;
+        ranked.push_back({world_area(snap.items, t) / d2, t});
+    };
+    for (const auto& t : indexed_candidates) consider(t);
+    for (const auto& range : snap.mesh_ranges) {
+        if (range.mesh_index >= mesh_candidates.size()) continue;
+        for (const auto& rel : mesh_candidates[range.mesh_index].triangles) {
+            if (rel[0] >= range.count || rel[1] >= range.count || rel[2] >= range.count) continue;
+            consider({(uint32_t)(range.first_item + rel[0]), (uint32_t)(range.first_item + rel[1]),
+                      (uint32_t)(range.first_item + rel[2])});
+        }
+    }
+    keep_largest(ranked, MAX_OCCLUDERS);
+
+    // Edges two occluders share are inside the surface, only the outline needs pulling in.
+    // What the shared edge bends lies in one of the two, drawn by the other: both get the
+    // farther depth.
+    std::vector<float> far(ranked.size());
+    std::unordered_map<uint64_t, std::array<int,2>> edges;
+    auto edge_key = [](uint32_t u, uint32_t v) { return (uint64_t)std::min(u, v) << 32 | std::max(u, v); };
+    for (size_t t = 0; t < ranked.size(); ++t) {
+        const TriangleIndices& idx = ranked[t].second;
+        float far2 = 0.0f;
+        for (int k = 0; k < 3; ++k) {
+            const float* pos = snap.items[idx[k]].pos;
+            float d[3] = {pos[0] - eye[0], pos[1] - eye[1], pos[2] - eye[2]};
+            far2 = std::max(far2, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            auto it = edges.emplace(edge_key(idx[k], idx[(k + 1) % 3]), std::array<int,2>{(int)t, -1});
+            if (!it.second) it.first->second[1] = (int)t;
+        }
+        // Distance is convex, over the triangle (and every part of it) it is largest at a corner
+        far[t] = std::sqrt(far2);
+    }
+
+    occluders.clear();
+    occluder_world.clear();
+    for (size_t t = 0; t < ranked.size(); ++t) {
+        const TriangleIndices& idx = ranked[t].second;
+        const float* corner[3];
+        float px[3][2];
+        for (int k = 0; k < 3; ++k) {
+            corner[k] = snap.items[idx[k]].pos;
+            to_pixels(corner[k], px[k]);
+        }
+        // Tiny ones still cover what their shared edges bend into them
+        if (verify) {
+            std::array<float,9> w;
+            for (int k = 0; k < 3; ++k) std::copy(corner[k], corner[k] + 3, &w[3 * k]);
+            occluder_world.push_back(w);
+        }
+        float area2 = (px[1][0] - px[0][0]) * (px[2][1] - px[0][1]) - (px[1][1] - px[0][1]) * (px[2][0] - px[0][0]);
+        if (std::fabs(area2) < 2.0f * MIN_OCCLUDER_PIXELS) continue;
+        bool outline[3];
+        float depth = far[t];
+        for (int e = 0; e < 3; ++e) {
+            const std::array<int,2>& owners = edges[edge_key(idx[e], idx[(e + 1) % 3])];
+            int other = owners[0] == (int)t ? owners[1] : owners[0];
+            outline[e] = other < 0;
+            if (other >= 0) depth = std::max(depth, far[other]);
+        }
+        add_occluder(corner, px, outline, depth);
+    }
+    stats.occluder_triangles = occluders.size();
+}
+
+void OcclusionCuller::to_pixels(const float pos[3], float out[2]) const
+{
+    std::array<float,2> ndc = project_point(params, pos);
+    out[0] = (ndc[0] + 1.0f) * 0.5f * WIDTH;
+    out[1] = (1.0f - ndc[1]) * 0.5f * HEIGHT;
+}
+
+// How far the projected curve from world p to q strays from the chord pp -> pq toward the side
+// of inside, in pixels; 0 when it bends outward
+float OcclusionCuller::bend_inward(const float p[3], const float q[3], const float pp[2], const float pq[2],
+                                   const float inside[2]) const
+{
+    float n[2] = {pp[1] - pq[1], pq[0] - pp[0]};
+    float len = std::sqrt(n[0] * n[0] + n[1] * n[1]);
+    if (len <= 0.0f) return 0.0f;
+    n[0] /= len;
+    n[1] /= len;
+    if (n[0] * (inside[0] - pp[0]) + n[1] * (inside[1] - pp[1]) < 0.0f) {
+        n[0] = -n[0];
+        n[1] = -n[1];
+    }
+    float bend = 0.0f;
+    for (float t : {0.25f, 0.5f, 0.75f}) {
+        const float m[3] = {p[0] + t * (q[0] - p[0]), p[1] + t * (q[1] - p[1]), p[2] + t * (q[2] - p[2])};
+        float pm[2];
+        to_pixels(m, pm);
+        bend = std::max(bend, n[0] * (pm[0] - pp[0]) + n[1] * (pm[1] - pp[1]));
+    }
+    return bend;
+}
+
+void OcclusionCuller::add_occluder(const float* corner[3], const float px[3][2], const bool outline[3], float depth)
+{
+    // Edge e runs from corner e to corner e + 1. The bend shrinks by about 4 per level.
+    float pull[3] = {0.0f, 0.0f, 0.0f};
+    float bend = 0.0f;
+    for (int e = 0; e < 3; ++e) {
+        if (!outline[e]) continue;
+        int f = (e + 1) % 3, o = (e + 2) % 3;
+        pull[e] = bend_inward(corner[e], corner[f], px[e], px[f], px[o]);
+        bend = std::max(bend, pull[e]);
+    }
+    int level = 0;
+    while (level < MAX_SPLIT_LEVEL && bend > SPLIT_PIXELS) {
+        bend *= 0.25f;
+        level++;
+    }
+    while (level > 0 && occluders.size() + ((size_t)1 << (2 * level)) > MAX_OCCLUDER_PARTS) level--;
+    if (level == 0) {
+        // Most of them: far or small enough to be straight already
+        for (float& p : pull) p *= BEND_MARGIN;
+        const float* v[3] = {px[0], px[1], px[2]};
+        add_part(v, pull, depth);
+        return;
+    }
+
+    // Grid point (i, j) is (k A + i B + j C) / n with k = n - i - j: edge AB is j = 0,
+    // BC is k = 0 and CA is i = 0
+    const int n = 1 << level;
+    auto grid = [n](int i, int j) { return (size_t)j * (n + 1) - (size_t)j * (j - 1) / 2 + i; };
+    std::vector<std::array<float,3>> world((size_t)(n + 1) * (n + 2) / 2);
+    std::vector<std::array<float,2>> screen(world.size());
+    for (int j = 0; j <= n; ++j) {
+        for (int i = 0; i + j <= n; ++i) {
+            int k = n - i - j;
+            std::array<float,3>& w = world[grid(i, j)];
+            for (int c = 0; c < 3; ++c) w[c] = (k * corner[0][c] + i * corner[1][c] + j * corner[2][c]) / n;
+            to_pixels(w.data(), screen[grid(i, j)].data());
+        }
+    }
+    // What the segments of each outline edge still bend, at this level
+    pull[0] = pull[1] = pull[2] = 0.0f;
+    for (int s = 0; s < n; ++s) {
+        size_t ab[2] = {grid(s, 0), grid(s + 1, 0)};
+        size_t bc[2] = {grid(n - s, s), grid(n - s - 1, s + 1)};
+        size_t ca[2] = {grid(0, n - s), grid(0, n - s - 1)};
+        const size_t* edge[3] = {ab, bc, ca};
+        for (int e = 0; e < 3; ++e) {
+            if (!outline[e]) continue;
+            pull[e] = std::max(pull[e], bend_inward(world[edge[e][0]].data(), world[edge[e][1]].data(),
+                                                    screen[edge[e][0]].data(), screen[edge[e][1]].data(),
+                                                    px[(e + 2) % 3]));
+        }
+    }
+    for (float& p : pull) p *= BEND_MARGIN;
+
+    const float none[3] = {0.0f, 0.0f, 0.0f};
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i + j < n; ++i) {
+            // Upward part, its edges may lie on the outline
+            const float edge_pull[3] = {j == 0 ? pull[0] : 0.0f, i + j + 1 == n ? pull[1] : 0.0f, i == 0 ? pull[2] : 0.0f};
+            const float* up[3] = {screen[grid(i, j)].data(), screen[grid(i + 1, j)].data(), screen[grid(i, j + 1)].data()};
+            add_part(up, edge_pull, depth);
+            // Downward part, inside
+            if (i + j + 1 < n) {
+                const float* down[3] = {screen[grid(i + 1, j)].data(), screen[grid(i + 1, j + 1)].data(), screen[grid(i, j + 1)].data()};
+                add_part(down, none, depth);
+            }
+        }
+    }
+}
+
+// One straight edged triangle, each edge moved inward by pull pixels
+void OcclusionCuller::add_part(const float* v[3], const float pull[3], float depth)
+{
+    float px[3][2] = {{v[0][0], v[0][1]}, {v[1][0], v[1][1]}, {v[2][0], v[2][1]}};
+    float in[3] = {pull[0], pull[1], pull[2]};
+    float area2 = (px[1][0] - px[0][0]) * (px[2][1] - px[0][1]) - (px[1][1] - px[0][1]) * (px[2][0] - px[0][0]);
+    if (area2 == 0.0f) return;
+    if (area2 < 0.0f) {
+        // Reversed: edges 0 -> 2 -> 1 -> 0 are the old edges 2, 1 and 0
+        std::swap(px[1][0], px[2][0]);
+        std::swap(px[1][1], px[2][1]);
+        std::swap(in[0], in[2]);
+    }
+    Triangle tri;
+    // Edge i -> j: a x + b y + c = cross(pj - pi, p - pi) / |pj - pi| - pull, distance in pixels
+    for (int e = 0; e < 3; ++e) {
+        const float* pi = px[e];
+        const float* pj = px[(e + 1) % 3];
+        float a = pi[1] - pj[1], b = pj[0] - pi[0];
+        float len = std::sqrt(a * a + b * b);
+        tri.a[e] = a / len;
+        tri.b[e] = b / len;
+        tri.c[e] = -(tri.a[e] * pi[0] + tri.b[e] * pi[1]) - in[e];
+    }
+    tri.x0 = std::max(0, (int)std::floor(std::min({px[0][0], px[1][0], px[2][0]})));
+    tri.x1 = std::min(WIDTH - 1, (int)std::floor(std::max({px[0][0], px[1][0], px[2][0]})));
+    tri.y0 = std::max(0, (int)std::floor(std::min({px[0][1], px[1][1], px[2][1]})));
+    tri.y1 = std::min(HEIGHT - 1, (int)std::floor(std::max({px[0][1], px[1][1], px[2][1]})));
+    if (tri.x0 > tri.x1 || tri.y0 > tri.y1) return;
+    tri.depth = depth;
+    occluders.push_back(tri);
+}
+
+#ifdef OCCLUSION_SIMD
+// Vector arguments of the inlined helpers never cross a real call boundary
+#pragma GCC diagnostic ignored "-Wpsabi"
+typedef float v8f __attribute__((vector_size(32)));
+typedef int v8i __attribute__((vector_size(32)));
+#endif
+
+// depth = min(depth, tri.depth) for the pixels of row y whose center is inside the triangle
+void OcclusionCuller::raster_row(const Triangle& tri, int y, float* row)
+{
+    const float yc = y + 0.5f;
+    const float e0 = tri.b[0] * yc + tri.c[0], e1 = tri.b[1] * yc + tri.c[1], e2 = tri.b[2] * yc + tri.c[2];
+#ifdef OCCLUSION_SIMD
+    // Eight pixels per step; WIDTH is a multiple of 8, lanes left of x0 fail the edge tests
+    const v8f lane = {0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f};
+    const v8f z = v8f{} + tri.depth;
+    for (int x = tri.x0 & ~7; x <= tri.x1; x += 8) {
+        v8f xs = lane + (float)x;
+        v8i inside = (tri.a[0] * xs + e0 >= 0.0f) & (tri.a[1] * xs + e1 >= 0.0f) & (tri.a[2] * xs + e2 >= 0.0f);
+        v8f d;
+        std::memcpy(&d, row + x, sizeof(d));
+        v8i nearer = inside & (z < d);
+        d = (v8f)(((v8i)d & ~nearer) | ((v8i)z & nearer));
+        std::memcpy(row + x, &d, sizeof(d));
+    }
+#else
+    for (int x = tri.x0; x <= tri.x1; ++x) {
+        float xc = x + 0.5f;
+        if (tri.a[0] * xc + e0 >= 0.0f && tri.a[1] * xc + e1 >= 0.0f && tri.a[2] * xc + e2 >= 0.0f) {
+            row[x] = std::min(row[x], tri.depth);
+        }
+    }
+#endif
+}
+
+void OcclusionCuller::rasterize_band(int tile_row)
+{
+    const int y_begin = tile_row * TILE, y_end = y_begin + TILE;
+    std::fill(depth.begin() + (size_t)y_begin * WIDTH, depth.begin() + (size_t)y_end * WIDTH, INFINITY);
+    for (const Triangle& tri : occluders) {
+        if (tri.y1 < y_begin || tri.y0 >= y_end) continue;
+        for (int y = std::max(tri.y0, y_begin); y <= std::min(tri.y1, y_end - 1); ++y) {
+            raster_row(tri, y, &depth[(size_t)y * WIDTH]);
+        }
+    }
+    size_t covered = 0;
+    for (int tx = 0; tx < WIDTH / TILE; ++tx) {
+        float farthest = 0.0f;
+        for (int y = y_begin; y < y_end; ++y) {
+            const float* p = &depth[(size_t)y * WIDTH + tx * TILE];
+            for (int x = 0; x < TILE; ++x) {
+                farthest = std::max(farthest, p[x]);
+                covered += p[x] != INFINITY;
+            }
+        }
+        tile_max[tile_row * (WIDTH / TILE) + tx] = farthest;
+    }
+    band_covered[tile_row] = covered;
+}
+
+void OcclusionCuller::rasterize()
+{
+    depth.resize((size_t)WIDTH * HEIGHT);
+    tile_max.resize((WIDTH / TILE) * (HEIGHT / TILE));
+    band_covered.assign(HEIGHT / TILE, 0);
+    JobSystem::global().parallel_for("occlusion_raster", 0, HEIGHT / TILE, [&](size_t b, size_t e) {
+        for (size_t row = b; row < e; ++row) rasterize_band((int)row);
+    });
+    size_t covered = 0;
+    for (size_t c : band_covered) covered += c;
+    stats.coverage = (float)covered / (WIDTH * HEIGHT);
+}
+
+OcclusionCuller::BoxResult OcclusionCuller::test_box(const WorldBounds& box) const
+{
+    const float* eye = params.cam_pos;
+    float gap[3];
+    for (int k = 0; k < 3; ++k) gap[k] = std::max({box.min[k] - eye[k], eye[k] - box.max[k], 0.0f});
+    const float nearest = std::sqrt(gap[0] * gap[0] + gap[1] * gap[1] + gap[2] * gap[2]);
+    const float near_h = std::sqrt(gap[0] * gap[0] + gap[1] * gap[1]);
+    // Camera inside, or straight above/below: the box spans every azimuth
+    if (near_h <= 0.0f) return BOX_VISIBLE;
+
+    // Azimuth extremes of the footprint are at its corners. Across the wrap behind the camera
+    // the corners land more than half a turn apart.
+    float x_min = INFINITY, x_max = -INFINITY, far_h = 0.0f;
+    for (int c = 0; c < 4; ++c) {
+        const float corner[3] = {(c & 1) ? box.max[0] : box.min[0], (c & 2) ? box.max[1] : box.min[1], eye[2]};
+        float dx = corner[0] - eye[0], dy = corner[1] - eye[1];
+        far_h = std::max(far_h, std::sqrt(dx * dx + dy * dy));
+        float x = project_point(params, corner)[0];
+        x_min = std::min(x_min, x);
+        x_max = std::max(x_max, x);
+    }
+    if (x_max - x_min >= 180.0f * std::fabs(params.scale_x)) return BOX_VISIBLE;
+    // Elevation extremes: the top edge is steepest where the footprint is nearest (above the
+    // camera) or farthest (below it), the bottom edge the other way round
+    const float top = box.max[2] - eye[2], bottom = box.min[2] - eye[2];
+    const float el_top = std::atan2(top, top >= 0.0f ? near_h : far_h) * 180.0f / (float)M_PI;
+    const float el_bottom = std::atan2(bottom, bottom >= 0.0f ? far_h : near_h) * 180.0f / (float)M_PI;
+    float y_a = (params.camera_elev - el_top) * params.scale_y;
+    float y_b = (params.camera_elev - el_bottom) * params.scale_y;
+
+    // Pixel rectangle, one pixel wider on every side
+    int px0 = (int)std::floor((x_min + 1.0f) * 0.5f * WIDTH) - 1;
+    int px1 = (int)std::floor((x_max + 1.0f) * 0.5f * WIDTH) + 1;
+    int py0 = (int)std::floor((1.0f - std::max(y_a, y_b)) * 0.5f * HEIGHT) - 1;
+    int py1 = (int)std::floor((1.0f - std::min(y_a, y_b)) * 0.5f * HEIGHT) + 1;
+    if (px1 < 0 || px0 >= WIDTH || py1 < 0 || py0 >= HEIGHT) return BOX_OUTSIDE;
+    px0 = std::max(px0, 0);
+    py0 = std::max(py0, 0);
+    px1 = std::min(px1, WIDTH - 1);
+    py1 = std::min(py1, HEIGHT - 1);
+
+    // Tiles whose farthest pixel is nearer than the box are hidden as a whole
+    for (int ty = py0 / TILE; ty <= py1 / TILE; ++ty) {
+        for (int tx = px0 / TILE; tx <= px1 / TILE; ++tx) {
+            if (tile_max[ty * (WIDTH / TILE) + tx] < nearest) continue;
+            for (int y = std::max(py0, ty * TILE); y <= std::min(py1, ty * TILE + TILE - 1); ++y) {
+                const float* row = &depth[(size_t)y * WIDTH];
+                for (int x = std::max(px0, tx * TILE); x <= std::min(px1, tx * TILE + TILE - 1); ++x) {
+                    if (row[x] >= nearest) return BOX_VISIBLE;
+                }
+            }
+        }
+    }
+    return BOX_HIDDEN;
+}
+
+// Exact reference for the verification: the segment from the eye to pos crosses an occluder
+// triangle (Moller-Trumbore), no depth buffer involved
+bool OcclusionCuller::point_hidden(const float pos[3], bool& on_screen) const
+{
+    std::array<float,2> ndc = project_point(params, pos);
+    int x = (int)std::floor((ndc[0] + 1.0f) * 0.5f * WIDTH);
+    int y = (int)std::floor((1.0f - ndc[1]) * 0.5f * HEIGHT);
+    on_screen = x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT;
+    if (!on_screen) return false;
+    const float* o = params.cam_pos;
+    const float d[3] = {pos[0] - o[0], pos[1] - o[1], pos[2] - o[2]};
+    for (const auto& w : occluder_world) {
+        const float e1[3] = {w[3] - w[0], w[4] - w[1], w[5] - w[2]};
+        const float e2[3] = {w[6] - w[0], w[7] - w[1], w[8] - w[2]};
+        const float p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+        float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if (std::fabs(det) < 1e-12f) continue;
+        float inv = 1.0f / det;
+        const float s[3] = {o[0] - w[0], o[1] - w[1], o[2] - w[2]};
+        float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+        if (u < 0.0f || u > 1.0f) continue;
+        const float q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+        float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+        if (v < 0.0f || u + v > 1.0f) continue;
+        // Points on the occluder itself (its corners, the rest of its mesh) are not behind it
+        float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+        if (t > 0.0f && t < 1.0f - 1e-4f) return true;
+    }
+    return false;
+}
+
+// counts: verified, hidden but drawn, visible but culled
+void OcclusionCuller::verify_points(const SceneSnapshot& snap, const Occludee& o, bool culled, size_t counts[3]) const
+{
+    size_t step = std::max<size_t>(1, o.count / VERIFY_SAMPLES);
+    for (size_t i = 0; i < o.count; i += step) {
+        const float* pos = o.kind == Occludee::PAGE ? (*snap.cloud_pages[o.index])[i].pos : snap.items[o.first + i].pos;
+        bool on_screen;
+        bool hidden = point_hidden(pos, on_screen);
+        if (!on_screen) continue;
+        counts[0]++;
+        if (!culled && hidden) counts[1]++;
+        if (culled && !hidden) counts[2]++;
+    }
+}
+
+void OcclusionCuller::cull(const SceneSnapshot& snap, const ProjectionParams& projection, const ClipVolume& volume)
+{
+    auto start = Clock::now();
+    stats = OcclusionStats();
+    params = projection;
+    update_candidates(snap);
+    select_occluders(snap, volume);
+    rasterize();
+    stats.raster_ms = ms_since(start);
+
+    start = Clock::now();
+    occludees.clear();
+    for (size_t m = 0; m < snap.mesh_ranges.size(); ++m) {
+        const auto& range = snap.mesh_ranges[m];
+        if (range.count > 0) occludees.push_back({Occludee::MESH, m, range.first_item, range.count});
+    }
+    const size_t flat = first_mesh_item(snap);
+    for (size_t b = 0; b < block_cullable.size(); ++b) {
+        if (block_cullable[b]) occludees.push_back({Occludee::BLOCK_ITEMS, b, b * BLOCK, std::min(BLOCK, flat - b * BLOCK)});
+    }
+    for (size_t p = 0; p < snap.cloud_pages.size(); ++p) {
+        occludees.push_back({Occludee::PAGE, p, 0, snap.cloud_pages[p]->size()});
+    }
+
+    // Item boxes only change when something moved, the pages come with theirs
+    const bool moved = snap.structure_version != bounds_structure_version || snap.motion_version != bounds_motion_version;
+    bounds_structure_version = snap.structure_version;
+    bounds_motion_version = snap.motion_version;
+    item_bounds.resize(occludees.size() - snap.cloud_pages.size());
+    occludee_result.assign(occludees.size(), BOX_VISIBLE);
+    std::vector<std::array<size_t,3>> checked(verify ? occludees.size() : 0, {0, 0, 0});
+    JobSystem::global().parallel_for("occlusion_test", 0, occludees.size(), [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            const Occludee& o = occludees[i];
+            if (o.kind != Occludee::PAGE && moved) {
+                float x0 = INFINITY, y0 = INFINITY, z0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY, z1 = -INFINITY;
+                for (size_t n = o.first; n < o.first + o.count; ++n) {
+                    const float* p = snap.items[n].pos;
+                    x0 = std::min(x0, p[0]); y0 = std::min(y0, p[1]); z0 = std::min(z0, p[2]);
+                    x1 = std::max(x1, p[0]); y1 = std::max(y1, p[1]); z1 = std::max(z1, p[2]);
+                }
+                item_bounds[i] = {{x0, y0, z0}, {x1, y1, z1}};
+            }
+            const WorldBounds& box = o.kind == Occludee::PAGE ? snap.cloud_bounds[o.index] : item_bounds[i];
+            occludee_result[i] = test_box(box);
+            if (verify) verify_points(snap, o, occludee_result[i] != BOX_VISIBLE, checked[i].data());
+        }
+    }, 8);
+
+    item_culled.assign(snap.items.size(), 0);
+    mesh_culled.assign(snap.mesh_ranges.size(), 0);
+    page_culled.assign(snap.cloud_pages.size(), 0);
+    stats.boxes_tested = occludees.size();
+    for (size_t i = 0; i < occludees.size(); ++i) {
+        const Occludee& o = occludees[i];
+        if (verify) {
+            stats.verified_points += checked[i][0];
+            stats.hidden_but_drawn += checked[i][1];
+            stats.visible_but_culled += checked[i][2];
+        }
+        if (occludee_result[i] == BOX_VISIBLE) continue;
+        if (occludee_result[i] == BOX_HIDDEN) stats.boxes_culled++;
+        else stats.boxes_outside++;
+        stats.items_culled += o.count;
+        if (o.kind == Occludee::PAGE) {
+            page_culled[o.index] = 1;
+            continue;
+        }
+        if (o.kind == Occludee::MESH) mesh_culled[o.index] = 1;
+        std::memset(&item_culled[o.first], 1, o.count);
+    }
+    stats.test_ms = ms_since(start);
+}
@@ -0,0 +1,116 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "scene/scene_snapshot.h"
+#include "renderer/projection.h"
+#include "renderer/clipper.h"
+
+struct OcclusionStats {
+    double raster_ms = 0.0;          // occluder selection and rasterization
+    double test_ms = 0.0;            // box tests
+    size_t occluder_triangles = 0;   // after splitting the bent ones
+    float coverage = 0.0f;           // fraction of the depth buffer covered by occluders
+    size_t boxes_tested = 0;
+    size_t boxes_culled = 0;         // behind occluders
+    size_t boxes_outside = 0;        // entirely off screen
+    size_t items_culled = 0;         // snapshot items and cloud points never projected
+    // Only with verification: sampled vertices of every box, ray tested against the occluder
+    // triangles themselves (not the depth buffer)
+    size_t verified_points = 0;
+    size_t hidden_but_drawn = 0;     // hidden vertices of kept boxes: what a finer test could cull
+    size_t visible_but_culled = 0;   // visible vertices of culled boxes, must stay 0
+};
+
+// Software occlusion culling in front of the projection. Every frame the largest triangles
+// close to the camera (the index buffer, e.g. the floor, and a per mesh subset of its biggest
+// triangles, a coarse occluder version of the mesh) are rasterized into a small CPU depth
+// buffer, 8 pixels at a time with GCC vector extensions, one job per row of tiles. Then the
+// bounding box of every mesh, every block of BLOCK consecutive flat points (the object list
+// attaches a subtree in one piece, so a block is mostly one subtree) and every cloud page is
+// tested against the per tile maximum depth first and against the pixels only where needed.
+// Culled boxes are never projected nor drawn.
+// Conservative in depth: a covered pixel holds the farthest corner distance of its nearest
+// occluder, a box is hidden when its nearest point is farther than every pixel it touches.
+// Coverage is sampled at pixel centers, so the triangles of a tessellated surface cover it
+// without gaps; boxes are tested over their footprint grown by a pixel on every side, which
+// absorbs the sampling. The angular projection bends straight edges (the far edge of a floor
+// or a table below eye level sags away from the horizon), so occluders are split until the
+// parts' edges are straight to half a pixel and the outline is pulled inward by the rest:
+// the rasterized shape stays inside the true one. Edges two occluders share are not pulled in,
+// both sides get the farther depth of the two instead, so a tessellated surface has no seams.
+class OcclusionCuller {
+public:
+    static constexpr int WIDTH = 256, HEIGHT = 128, TILE = 8;
+    static constexpr size_t BLOCK = 1024;
+
+    // One frame: selects and rasterizes the occluders and tests every box of snap.
+    void cull(const SceneSnapshot& snap, const ProjectionParams& params, const ClipVolume& volume);
+
+    // Per snapshot item, non-zero if it belongs to a culled box. Flat items referenced by the
+    // index buffer and 2d shapes are never culled.
+    const std::vector<uint8_t>& get_item_culled() const { return item_culled; }
+    bool is_mesh_culled(size_t range) const { return mesh_culled[range] != 0; }
+    bool is_page_culled(size_t page) const { return page_culled[page] != 0; }
+    const OcclusionStats& get_stats() const { return stats; }
+    // Samples the vertices of every box to measure the culling accuracy, costs projections.
+    void set_verify(bool enabled) { verify = enabled; }
+
+private:
+    struct Triangle {
+        float a[3], b[3], c[3];     // edge functions in pixels, positive inside
+        int x0, y0, x1, y1;         // pixel bounds, inclusive
+        float depth;                // farthest corner distance
+    };
+    struct Occludee {
+        enum Kind { MESH, BLOCK_ITEMS, PAGE } kind;
+        size_t index;               // mesh range or cloud page
+        size_t first, count;        // items
+    };
+    enum BoxResult { BOX_VISIBLE, BOX_HIDDEN, BOX_OUTSIDE };
+
+    void update_candidates(const SceneSnapshot& snap);
+    void select_occluders(const SceneSnapshot& snap, const ClipVolume& volume);
+    void to_pixels(const float pos[3], float out[2]) const;
+    float bend_inward(const float p[3], const float q[3], const float pp[2], const float pq[2], const float inside[2]) const;
+    void add_occluder(const float* corner[3], const float px[3][2], const bool outline[3], float depth);
+    void add_part(const float* v[3], const float pull[3], float depth);
+    void rasterize();
+    void rasterize_band(int tile_row);
+    static void raster_row(const Triangle& tri, int y, float* row);
+    BoxResult test_box(const WorldBounds& box) const;
+    bool point_hidden(const float pos[3], bool& on_screen) const;
+    void verify_points(const SceneSnapshot& snap, const Occludee& o, bool culled, size_t counts[3]) const;
+
+    ProjectionParams params;
+    bool verify = false;
+
+    // Occluder candidates: item indices of the largest triangles, reselected when the
+    // structure changes (index buffer) or a mesh grew by a quarter (meshes, relative indices)
+    uint64_t candidates_version = UINT64_MAX;
+    std::vector<std::array<uint32_t,3>> indexed_candidates;
+    struct MeshCandidates {
+        size_t index_count = 0;
+        std::vector<std::array<uint32_t,3>> triangles;
+    };
+    std::vector<MeshCandidates> mesh_candidates;   // by mesh index
+    std::vector<uint8_t> block_cullable;           // per BLOCK of flat items
+
+    std::vector<Triangle> occluders;
+    std::vector<std::array<float,9>> occluder_world;   // corners, kept for the verification
+    std::vector<float> depth;                      // WIDTH x HEIGHT, +inf where uncovered
+    std::vector<float> tile_max;                   // farthest pixel of each tile
+    std::vector<size_t> band_covered;              // covered pixels per row of tiles
+
+    std::vector<Occludee> occludees;            // meshes, blocks, then pages
+    std::vector<WorldBounds> item_bounds;       // of the mesh and block occludees
+    uint64_t bounds_structure_version = UINT64_MAX, bounds_motion_version = 0;
+    std::vector<uint8_t> occludee_result;
+    std::vector<uint8_t> item_culled, mesh_culled, page_culled;
+    OcclusionStats stats;
+};
+
+#endif // OCCLUSION_CULLER_H
@@ -0,0 +1,199 @@
+#include "pixel_view.h"
+#include "renderer/gl_state.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "jobs/job_system.h"
+
+namespace {
+// Full screen triangle from gl_VertexID, no vertex buffer needed
+const char* pixelVertexSource = R"(
+#version 330 core
+out vec2 uv;
+void main() {
+    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    uv = vec2(p.x, 1.0 - p.y); // row 0 of the frame at the top
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+const char* pixelFragmentSource = R"(
+#version 330 core
+in vec2 uv;
+uniform sampler2D pixels;
+out vec4 outColor;
+void main() {
+    outColor = texture(pixels, uv);
+}
+)";
+
+struct GLFormat {
+    GLint internal;
+    GLenum format;
+    GLenum type;
+    bool mono;
+};
+
+const GLFormat gl_formats[PIXEL_FORMAT_COUNT] = {
+    {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, false},
+    {GL_RGBA8, GL_BGRA, GL_UNSIGNED_BYTE, false},
+    {GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, false},
+    {GL_R8, GL_RED, GL_UNSIGNED_BYTE, true},
+    {GL_R16, GL_RED, GL_UNSIGNED_SHORT, true},
+};
+
+GLuint compile(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        char buffer[512];
+        glGetShaderInfoLog(shader, 512, NULL, buffer);
+        std::cerr << "Pixel view shader compilation error: " << buffer << std::endl;
+    }
+    return shader;
+}
+}
+
+size_t pixel_bytes(PixelFormat format) {
+    switch (format) {
+        case PIXEL_RGBA8: case PIXEL_BGRA8: return 4;
+        case PIXEL_RGB8: return 3;
+        case PIXEL_MONO8: return 1;
+        case PIXEL_MONO16: return 2;
+        default: return 0;
+    }
+}
+
+bool parse_pixel_format(const char* name, PixelFormat& format) {
+    const char* names[PIXEL_FORMAT_COUNT] = {"rgba8", "bgra8", "rgb8", "mono8", "mono16"};
+    for (int i = 0; i < PIXEL_FORMAT_COUNT; ++i) {
+        if (std::strcmp(name, names[i]) == 0) {
+            format = (PixelFormat)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+PixelView::PixelView()
+{
+    GLuint vs = compile(GL_VERTEX_SHADER, pixelVertexSource);
+    GLuint fs = compile(GL_FRAGMENT_SHADER, pixelFragmentSource);
+    program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    GLState::global().use_program(program);
+    glUniform1i(glGetUniformLocation(program, "pixels"), 0);
+
+    glGenVertexArrays(1, &vao);
+    glGenTextures(1, &texture);
+    // Two regions = two PBOs used alternately
+    pbo = std::make_unique<StreamBuffer>(GL_PIXEL_UNPACK_BUFFER, 1 << 20, 2);
+}
+
+PixelView::~PixelView()
+{
+    pbo.reset();
+    GLState& gl = GLState::global();
+    gl.delete_texture(texture);
+    gl.delete_vertex_array(vao);
+    gl.delete_program(program);
+}
+
+void PixelView::allocate_texture(int w, int h, PixelFormat f)
+{
+    const GLFormat& gl = gl_formats[f];
+    // No PBO bound, the storage is allocated without data
+    GLState::global().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    GLState::global().bind_texture_2d(texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, gl.internal, w, h, 0, gl.format, gl.type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // Mono formats are sampled as gray
+    GLint swizzle[4] = {GL_RED, gl.mono ? GL_RED : GL_GREEN, gl.mono ? GL_RED : GL_BLUE, gl.mono ? GL_ONE : GL_ALPHA};
+    if (f == PIXEL_RGB8) swizzle[3] = GL_ONE;
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    width = w;
+    height = h;
+    format = f;
+}
+
+void PixelView::upload(const PixelFrame& frame)
+{
+    uploaded_bytes = 0;
+    if (!frame.data || frame.width <= 0 || frame.height <= 0 || frame.format >= PIXEL_FORMAT_COUNT) return;
+    const size_t px = pixel_bytes(frame.format);
+    const size_t stride = frame.stride ? frame.stride : frame.width * px;
+
+    // Clip the dirty rectangles; a new size or format needs everything
+    PixelRect full{0, 0, frame.width, frame.height};
+    std::vector<PixelRect> rects;
+    if (frame.width != width || frame.height != height || frame.format != format) {
+        allocate_texture(frame.width, frame.height, frame.format);
+        rects.push_back(full);
+    } else if (!frame.dirty) {
+        rects.push_back(full);
+    } else {
+        for (size_t i = 0; i < frame.dirty_count; ++i) {
+            PixelRect r = frame.dirty[i];
+            int x1 = std::min(r.x + r.width, frame.width), y1 = std::min(r.y + r.height, frame.height);
+            r.x = std::max(r.x, 0);
+            r.y = std::max(r.y, 0);
+            r.width = x1 - r.x;
+            r.height = y1 - r.y;
+            if (r.width > 0 && r.height > 0) rects.push_back(r);
+        }
+    }
+    if (rects.empty()) return;
+
+    size_t total = 0;
+    for (const auto& r : rects) total += (size_t)r.width * r.height * px + 8;
+    pbo->begin_frame(total);
+
+    // Rectangles are packed tightly in the PBO, rows copied in parallel for large ones
+    std::vector<size_t> offsets(rects.size());
+    for (size_t i = 0; i < rects.size(); ++i) {
+        const PixelRect& r = rects[i];
+        const size_t row_bytes = (size_t)r.width * px;
+        uint8_t* dst = static_cast<uint8_t*>(pbo->allocate(row_bytes * r.height, 8, offsets[i]));
+        const uint8_t* src = static_cast<const uint8_t*>(frame.data) + (size_t)r.y * stride + (size_t)r.x * px;
+        size_t min_rows = std::max<size_t>(1, (256 * 1024) / std::max<size_t>(row_bytes, 1));
+        JobSystem::global().parallel_for("pixel_upload", 0, r.height, [&](size_t b, size_t e) {
+            for (size_t y = b; y < e; ++y) std::memcpy(dst + y * row_bytes, src + y * stride, row_bytes);
+        }, min_rows);
+        uploaded_bytes += row_bytes * r.height;
+    }
+    pbo->flush();
+
+    const GLFormat& gl = gl_formats[format];
+    GLState::global().bind_buffer(GL_PIXEL_UNPACK_BUFFER, pbo->get_buffer());
+    GLState::global().bind_texture_2d(texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    for (size_t i = 0; i < rects.size(); ++i) {
+        const PixelRect& r = rects[i];
+        glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.width, r.height, gl.format, gl.type, (const void*)offsets[i]);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    pbo->end_frame();
+}
+
+void PixelView::draw()
+{
+    if (!has_frame()) return;
+    // Texture unit 0 is the active one, nothing else uses textures
+    GLState& gl = GLState::global();
+    gl.use_program(program);
+    gl.bind_texture_2d(texture);
+    gl.bind_vertex_array(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
@@ -0,0 +1,70 @@
+#ifndef PIXEL_VIEW_H
+#define PIXEL_VIEW_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "renderer/stream_buffer.h"
+
+// Formats a caller provided pixel buffer may have. Values match shm::PixelFormat.
+enum PixelFormat {
+    PIXEL_RGBA8 = 0,
+    PIXEL_BGRA8 = 1,
+    PIXEL_RGB8 = 2,
+    PIXEL_MONO8 = 3,    // shown as gray
+    PIXEL_MONO16 = 4,
+    PIXEL_FORMAT_COUNT
+};
+
+size_t pixel_bytes(PixelFormat format);
+// Parses rgba8, bgra8, rgb8, mono8, mono16. Returns false for anything else.
+bool parse_pixel_format(const char* name, PixelFormat& format);
+
+struct PixelRect {
+    int x, y, width, height;
+};
+
+// A CPU side frame buffer. Only the dirty rectangles are uploaded; without any, the whole
+// frame is. The first frame and frames that change size or format are always uploaded whole.
+struct PixelFrame {
+    const void* data = nullptr;
+    int width = 0, height = 0;
+    size_t stride = 0;                  // bytes per row, 0 = tightly packed
+    PixelFormat format = PIXEL_RGBA8;
+    const PixelRect* dirty = nullptr;
+    size_t dirty_count = 0;
+};
+
+// Shows a pixel buffer as a full window textured quad (the background of the scene).
+// Uploads go through pixel buffer objects that alternate between frames: the dirty
+// rectangles are copied into one PBO (persistently mapped when available, the copy is split
+// over the job system for large frames) and glTexSubImage2D is sourced from it, so the DMA
+// to the texture runs while the CPU fills the other PBO for the next frame.
+class PixelView {
+public:
+    PixelView();
+    ~PixelView();
+
+    // frame.data may be reused as soon as this returns. GL thread only.
+    void upload(const PixelFrame& frame);
+    void draw();
+    void clear() { width = height = 0; }
+    bool has_frame() const { return width > 0; }
+    // Bytes copied into PBOs by the last upload.
+    size_t get_uploaded_bytes() const { return uploaded_bytes; }
+
+private:
+    void allocate_texture(int w, int h, PixelFormat f);
+
+    GLuint program = 0;
+    GLuint texture = 0;
+    GLuint vao = 0;
+    std::unique_ptr<StreamBuffer> pbo;
+    int width = 0, height = 0;
+    PixelFormat format = PIXEL_RGBA8;
+    size_t uploaded_bytes = 0;
+};
+
+#endif // PIXEL_VIEW_H
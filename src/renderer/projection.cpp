@@ -0,0 +1,46 @@
+#include "projection.h"
+#include <cmath>
+#include "math/own_math.h"
+
+ProjectionParams make_projection_params(const CameraState& camera) {
+    const std::vector<float>& o = camera.orientation;
+    ProjectionParams p;
+    p.cam_pos[0] = camera.pos[0];
+    p.cam_pos[1] = camera.pos[1];
+    p.cam_pos[2] = camera.pos[2];
+    p.camera_elev = std::atan2(o[2], std::sqrt(o[0] * o[0] + o[1] * o[1])) * 180.0f / M_PI;
+    p.camera_azimuth = -std::atan2(o[1], o[0]) * 180.0f / M_PI + 90.0f;
+    // screenX = width/2 + az / fov_w * width/1000, ndcX = screenX/width*2 - 1 (same for y, flipped),
+    // so the viewport size cancels out
+    p.scale_x = 2.0f / (camera.fov_width_deg * 1000.0f);
+    p.scale_y = -2.0f / (camera.fov_height_deg * 1000.0f);
+    return p;
+}
+
+std::array<float,2> project_point(const ProjectionParams& p, const float pos[3]) {
+    float dx = pos[0] - p.cam_pos[0];
+    float dy = pos[1] - p.cam_pos[1];
+    float dz = pos[2] - p.cam_pos[2];
+    float relative_elev = -std::atan2(dz, std::sqrt(dx * dx + dy * dy)) * 180.0f / M_PI;
+    float relative_azimuth = -std::atan2(dy, dx) * 180.0f / M_PI + 90.0f;
+
+    // Both azimuths are in [-90, 270], so one wrap brings the sum into [-180, 180]. This also
+    // covers the former |camera_azimuth| > 90 branch, which produced the same value.
+    float az_for_screen = relative_azimuth + p.camera_azimuth;
+    if (az_for_screen > 180.0f)  az_for_screen -= 360.0f;
+    if (az_for_screen < -180.0f) az_for_screen += 360.0f;
+    float el_for_screen = relative_elev + p.camera_elev;
+
+    return {az_for_screen * p.scale_x, el_for_screen * p.scale_y};
+}
+
+void unproject_ndc(const ProjectionParams& p, float ndc_x, float ndc_y, float dir[3]) {
+    // project_point backwards: relative_azimuth = 90 - heading, relative_elev = -elevation
+    float relative_azimuth = ndc_x / p.scale_x - p.camera_azimuth;
+    float relative_elev = ndc_y / p.scale_y - p.camera_elev;
+    float heading = (90.0f - relative_azimuth) * M_PI / 180.0f;
+    float elevation = -relative_elev * M_PI / 180.0f;
+    dir[0] = std::cos(elevation) * std::cos(heading);
+    dir[1] = std::cos(elevation) * std::sin(heading);
+    dir[2] = std::sin(elevation);
+}
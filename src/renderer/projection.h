@@ -0,0 +1,37 @@
+#ifndef PROJECTION_H
+#define PROJECTION_H
+
+#include <array>
+#include <cstddef>
+#include "scene/scene_snapshot.h"
+
+// Angular camera model: a point is placed on screen by its azimuth/elevation relative to the
+// camera heading. Everything that only depends on the camera is computed
+// once per frame in make_projection_params, project_point only does the per-point terms.
+struct ProjectionParams {
+    float cam_pos[3];
+    float camera_elev;      // degrees
+    float camera_azimuth;   // degrees
+    float scale_x;          // NDC per degree of azimuth
+    float scale_y;          // NDC per degree of elevation (sign included)
+};
+
+ProjectionParams make_projection_params(const CameraState& camera);
+// Scalar reference.
+std::array<float,2> project_point(const ProjectionParams& params, const float pos[3]);
+// Inverse of project_point: the unit direction from the camera of every point that lands on
+// (ndc_x, ndc_y). The model is angular, so that is a single ray.
+void unproject_ndc(const ProjectionParams& params, float ndc_x, float ndc_y, float dir[3]);
+// Projects count points given as separate x/y/z arrays (SoA) with the widest SIMD kernel the
+// CPU supports. Polynomial approximations, see projection_simd.cpp for the error bound.
+void project_batch(const ProjectionParams& params, const float* x, const float* y, const float* z,
+                   size_t count, float* out_x, float* out_y);
+
+// The instances of the batch kernel, for comparing them (tools/projection_bench.cpp).
+enum ProjectionKernel { KERNEL_SSE2, KERNEL_AVX2, KERNEL_AVX512, KERNEL_COUNT };
+const char* projection_kernel_name(ProjectionKernel kernel);
+// Runs that kernel, false (and nothing written) if the CPU or the build does not have it.
+bool project_batch_with(ProjectionKernel kernel, const ProjectionParams& params, const float* x, const float* y,
+                        const float* z, size_t count, float* out_x, float* out_y);
+
+#endif // PROJECTION_H
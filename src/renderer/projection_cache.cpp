@@ -0,0 +1,46 @@
+#include "projection_cache.h"
+
+void ProjectionCache::begin_frame(const CameraState& camera, int max_id)
+{
+    if (max_id >= (int)entries.size()) entries.resize(max_id + 1);
+    camera_moved = epoch == 0 || camera.version != camera_version;
+    if (camera_moved) {
+        camera_version = camera.version;
+        params = make_projection_params(camera);
+        epoch++;
+    }
+    reprojected = 0;
+}
+
+void ProjectionCache::refresh_range(const std::vector<SnapshotItem>& items, size_t begin, size_t end, std::array<float,2>* out)
+{
+    // Scratch per job worker, reused across frames
+    thread_local std::vector<uint32_t> stale;
+    thread_local std::vector<float> xs, ys, zs, nx, ny;
+    stale.clear();
+    for (size_t i = begin; i < end; ++i) {
+        const SnapshotItem& item = items[i];
+        const Entry& e = entries[item.id];
+        if (e.epoch == epoch && e.generation == item.generation && e.parent_version == item.parent_version) out[i] = e.ndc;
+        else stale.push_back((uint32_t)i);
+    }
+    if (stale.empty()) return;
+
+    size_t n = stale.size();
+    xs.resize(n); ys.resize(n); zs.resize(n); nx.resize(n); ny.resize(n);
+    for (size_t k = 0; k < n; ++k) {
+        const SnapshotItem& item = items[stale[k]];
+        xs[k] = item.pos[0]; ys[k] = item.pos[1]; zs[k] = item.pos[2];
+    }
+    project_batch(params, xs.data(), ys.data(), zs.data(), n, nx.data(), ny.data());
+    for (size_t k = 0; k < n; ++k) {
+        const SnapshotItem& item = items[stale[k]];
+        Entry& e = entries[item.id];
+        e.ndc = {nx[k], ny[k]};
+        e.generation = item.generation;
+        e.parent_version = item.parent_version;
+        e.epoch = epoch;
+        out[stale[k]] = e.ndc;
+    }
+    reprojected.fetch_add(n, std::memory_order_relaxed);
+}
@@ -0,0 +1,44 @@
+#ifndef PROJECTION_CACHE_H
+#define PROJECTION_CACHE_H
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include "renderer/projection.h"
+#include "scene/scene_snapshot.h"
+
+// Keeps the projected NDC position of every object between frames. An entry is reused while
+// the camera version is unchanged and both the object's generation (bumped by a move or a new
+// parent) and its parent's world version match, so an idle scene costs one compare per item instead of two atan2 per item.
+// Stale items are reprojected in batches with the SIMD kernel.
+// Entries are indexed by object id; lookups for distinct ids may run concurrently.
+class ProjectionCache {
+public:
+    // Starts a frame: hoists the camera terms and invalidates everything if the camera changed.
+    void begin_frame(const CameraState& camera, int max_id);
+    // Writes the NDC position of items[begin, end) to out[begin, end). Stale items are gathered
+    // into SoA arrays and reprojected with the SIMD batch kernel, the rest come from the cache.
+    void refresh_range(const std::vector<SnapshotItem>& items, size_t begin, size_t end, std::array<float,2>* out);
+
+    const ProjectionParams& get_params() const { return params; }
+    // Items reprojected since begin_frame.
+    size_t get_reprojected() const { return reprojected.load(); }
+    bool camera_changed() const { return camera_moved; }
+
+private:
+    struct Entry {
+        uint64_t epoch = 0;
+        uint32_t generation = 0;
+        uint32_t parent_version = 0;
+        std::array<float,2> ndc;
+    };
+    std::vector<Entry> entries;
+    uint64_t epoch = 0;               // bumped on every camera change, 0 is never valid
+    uint64_t camera_version = 0;
+    bool camera_moved = true;
+    ProjectionParams params;
+    std::atomic<size_t> reprojected{0};
+};
+
+#endif // PROJECTION_CACHE_H
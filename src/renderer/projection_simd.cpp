@@ -0,0 +1,206 @@
+#include "projection.h"
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <cstdlib>
+#include <string>
+
+// Batch kernel of the angular projection, written once with GCC vector extensions and
+// instantiated for 4 (SSE2), 8 (AVX2) and 16 (AVX-512) lanes. The instances are compiled
+// with the matching target attribute and picked at runtime from the CPU's feature bits.
+//
+// Approximations and error bound:
+//   atan(a), |a| <= 1: a * (c0 + c1 a^2 + ... + c4 a^8), Abramowitz & Stegun 4.4.49,
+//                      |error| <= 1e-5 rad; atan2 is reduced to it by octant folding.
+//   sqrt(v): bit-trick inverse square root + 3 Newton steps, relative error ~1e-7.
+// Evaluated in float, the polynomial and the folding add up to 2.5e-6 rad, so an angle is off by
+// at most 1.25e-5 rad, 7.2e-4 degrees, i.e. 7.2e-4 * scale NDC. For the default camera (zoom
+// 40, scale_y ~0.058 NDC per degree) that is 4.2e-5 NDC, 0.02 pixel at 1000 px. Against
+// project_point on 4M random points all around the camera the measured maximum is 6.9e-4
+// degrees on both axes; tools/projection_bench checks every kernel against the bound.
+// VBD_PROJECTION_KERNEL=sse|avx2|avx512 forces a kernel (for comparisons).
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PROJECTION_SIMD 1
+#endif
+
+#ifdef PROJECTION_SIMD
+// Vector arguments of the inlined helpers never cross a real call boundary, and go by
+// reference so no by-value vector parameter exists whose ABI GCC would note
+#pragma GCC diagnostic ignored "-Wpsabi"
+namespace {
+
+template <int N>
+struct Lanes {
+    typedef float vf __attribute__((vector_size(4 * N)));
+    typedef int vi __attribute__((vector_size(4 * N)));
+};
+
+template <int N>
+__attribute__((always_inline)) inline typename Lanes<N>::vf splat(float v) {
+    typename Lanes<N>::vf r;
+    for (int i = 0; i < N; ++i) r[i] = v;
+    return r;
+}
+
+template <int N>
+__attribute__((always_inline)) inline typename Lanes<N>::vf vabs(const typename Lanes<N>::vf& v) {
+    typedef typename Lanes<N>::vi vi;
+    return (typename Lanes<N>::vf)((vi)v & 0x7fffffff);
+}
+
+template <int N>
+__attribute__((always_inline)) inline typename Lanes<N>::vf vsqrt(const typename Lanes<N>::vf& v) {
+    typedef typename Lanes<N>::vf vf;
+    typedef typename Lanes<N>::vi vi;
+    vf half = v * 0.5f;
+    vf y = (vf)(0x5f3759df - ((vi)v >> 1));
+    y = y * (1.5f - half * y * y);
+    y = y * (1.5f - half * y * y);
+    y = y * (1.5f - half * y * y);
+    return v > 0.0f ? v * y : splat<N>(0.0f);
+}
+
+template <int N>
+__attribute__((always_inline)) inline typename Lanes<N>::vf vatan2(const typename Lanes<N>::vf& y, const typename Lanes<N>::vf& x) {
+    typedef typename Lanes<N>::vf vf;
+    const float pi = 3.14159265358979f;
+    vf ax = vabs<N>(x), ay = vabs<N>(y);
+    vf mx = ax > ay ? ax : ay;
+    vf mn = ax > ay ? ay : ax;
+    vf a = mx > 0.0f ? mn / (mx > 0.0f ? mx : splat<N>(1.0f)) : splat<N>(0.0f);
+    vf s = a * a;
+    vf r = a * (0.9998660f + s * (-0.3302995f + s * (0.1801410f + s * (-0.0851330f + s * 0.0208351f))));
+    r = ay > ax ? (pi / 2) - r : r;
+    r = x < 0.0f ? pi - r : r;
+    r = y < 0.0f ? -r : r;
+    return r;
+}
+
+template <int N>
+__attribute__((always_inline)) inline void project_lanes(const ProjectionParams& p, const float* x, const float* y, const float* z,
+                                                          float* out_x, float* out_y) {
+    typedef typename Lanes<N>::vf vf;
+    const float r2d = 180.0f / 3.14159265358979f;
+    vf vx, vy, vz;
+    std::memcpy(&vx, x, sizeof vx);
+    std::memcpy(&vy, y, sizeof vy);
+    std::memcpy(&vz, z, sizeof vz);
+    vf dx = vx - p.cam_pos[0];
+    vf dy = vy - p.cam_pos[1];
+    vf dz = vz - p.cam_pos[2];
+    vf relative_elev = -vatan2<N>(dz, vsqrt<N>(dx * dx + dy * dy)) * r2d;
+    vf relative_azimuth = -vatan2<N>(dy, dx) * r2d + 90.0f;
+    vf az = relative_azimuth + p.camera_azimuth;
+    az = az > 180.0f ? az - 360.0f : az;
+    az = az < -180.0f ? az + 360.0f : az;
+    vf el = relative_elev + p.camera_elev;
+    vf ox = az * p.scale_x;
+    vf oy = el * p.scale_y;
+    std::memcpy(out_x, &ox, sizeof ox);
+    std::memcpy(out_y, &oy, sizeof oy);
+}
+
+template <int N>
+__attribute__((always_inline)) inline void project_batch_lanes(const ProjectionParams& p, const float* x, const float* y, const float* z,
+                                                                size_t n, float* out_x, float* out_y) {
+    size_t i = 0;
+    for (; i + N <= n; i += N) project_lanes<N>(p, x + i, y + i, z + i, out_x + i, out_y + i);
+    if (i == n) return;
+    // Tail goes through the same kernel on a padded copy so every point gets identical math
+    float tx[N] = {}, ty[N] = {}, tz[N] = {}, rx[N], ry[N];
+    for (size_t k = i; k < n; ++k) { tx[k - i] = x[k]; ty[k - i] = y[k]; tz[k - i] = z[k]; }
+    project_lanes<N>(p, tx, ty, tz, rx, ry);
+    for (size_t k = i; k < n; ++k) { out_x[k] = rx[k - i]; out_y[k] = ry[k - i]; }
+}
+
+void project_batch_sse(const ProjectionParams& p, const float* x, const float* y, const float* z, size_t n, float* ox, float* oy) {
+    project_batch_lanes<4>(p, x, y, z, n, ox, oy);
+}
+
+__attribute__((target("avx2,fma")))
+void project_batch_avx2(const ProjectionParams& p, const float* x, const float* y, const float* z, size_t n, float* ox, float* oy) {
+    project_batch_lanes<8>(p, x, y, z, n, ox, oy);
+}
+
+__attribute__((target("avx512f")))
+void project_batch_avx512(const ProjectionParams& p, const float* x, const float* y, const float* z, size_t n, float* ox, float* oy) {
+    project_batch_lanes<16>(p, x, y, z, n, ox, oy);
+}
+
+typedef void (*BatchFn)(const ProjectionParams&, const float*, const float*, const float*, size_t, float*, float*);
+
+BatchFn select_batch_kernel() {
+    __builtin_cpu_init();
+    const char* forced = std::getenv("VBD_PROJECTION_KERNEL");
+    std::string force = forced ? forced : "";
+    if (force == "sse") {
+        std::cout << "Projection kernel: SSE2 (forced)" << std::endl;
+        return project_batch_sse;
+    }
+    if (force == "avx2" && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        std::cout << "Projection kernel: AVX2 (forced)" << std::endl;
+        return project_batch_avx2;
+    }
+    if ((force.empty() || force == "avx512") && __builtin_cpu_supports("avx512f")) {
+        std::cout << "Projection kernel: AVX-512" << std::endl;
+        return project_batch_avx512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        std::cout << "Projection kernel: AVX2" << std::endl;
+        return project_batch_avx2;
+    }
+    std::cout << "Projection kernel: SSE2" << std::endl;
+    return project_batch_sse;
+}
+
+} // namespace
+#endif
+
+void project_batch(const ProjectionParams& params, const float* x, const float* y, const float* z,
+                   size_t count, float* out_x, float* out_y) {
+#ifdef PROJECTION_SIMD
+    static const BatchFn kernel = select_batch_kernel();
+    kernel(params, x, y, z, count, out_x, out_y);
+#else
+    for (size_t i = 0; i < count; ++i) {
+        float pos[3] = {x[i], y[i], z[i]};
+        std::array<float,2> ndc = project_point(params, pos);
+        out_x[i] = ndc[0];
+        out_y[i] = ndc[1];
+    }
+#endif
+}
+
+const char* projection_kernel_name(ProjectionKernel kernel) {
+    switch (kernel) {
+        case KERNEL_SSE2: return "SSE2";
+        case KERNEL_AVX2: return "AVX2";
+        case KERNEL_AVX512: return "AVX-512";
+        default: return "unknown";
+    }
+}
+
+bool project_batch_with(ProjectionKernel kernel, const ProjectionParams& params, const float* x, const float* y,
+                        const float* z, size_t count, float* out_x, float* out_y) {
+#ifdef PROJECTION_SIMD
+    __builtin_cpu_init();
+    switch (kernel) {
+        case KERNEL_SSE2:
+            project_batch_sse(params, x, y, z, count, out_x, out_y);
+            return true;
+        case KERNEL_AVX2:
+            if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma")) return false;
+            project_batch_avx2(params, x, y, z, count, out_x, out_y);
+            return true;
+        case KERNEL_AVX512:
+            if (!__builtin_cpu_supports("avx512f")) return false;
+            project_batch_avx512(params, x, y, z, count, out_x, out_y);
+            return true;
+        default:
+            return false;
+    }
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,56 @@
+#ifndef RENDER_LIST_H
+#define RENDER_LIST_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "ingest/shm_ring.h"
+#include "renderer/occlusion_culler.h"
+
+struct SceneMesh;
+
+// Vertex range inside a render list's vertex block.
+struct DrawRange {
+    size_t first = 0;
+    size_t count = 0;
+};
+
+// Indexed mesh whose projected vertices start at base_vertex in the vertex block.
+struct MeshDraw {
+    size_t mesh_index;
+    size_t base_vertex;
+};
+
+// Output of the render-list build stage: projected vertices (x, y, r, g, b) plus the draws
+// that read them. The vertex block is either written straight into the GL stream buffer
+// (in_place, GL thread only) or into storage, which submit() copies into the stream buffer.
+struct RenderList {
+    uint64_t frame = 0;
+    uint64_t simulated_ns = 0;
+    // build statistics, handed to RenderStats on submission
+    double build_ms = 0.0;
+    size_t objects_visited = 0;
+    size_t clipped_triangles = 0;
+    OcclusionStats occlusion;
+
+    bool in_place = false;
+    std::vector<float> storage;
+    float* vertices = nullptr;
+    size_t capacity = 0;        // vertices reserved in the block
+    size_t block_first = 0;     // index of vertices[0] in the stream buffer, set when in place
+
+    DrawRange triangles;
+    DrawRange points;
+    DrawRange mesh_vertices;
+    std::vector<MeshDraw> mesh_draws;
+    std::shared_ptr<const std::vector<SceneMesh>> meshes;
+
+    // Shared memory frame drawn by this list; points are part of the points range,
+    // pixels are uploaded by submit(). external_valid: not torn, may be reported as presented.
+    shm::FrameView external;
+    std::shared_ptr<ShmRing> external_ring;
+    bool external_valid = false;
+};
+
+#endif // RENDER_LIST_H
@@ -0,0 +1,185 @@
+#include "render_stats.h"
+#include "renderer/gl_state.h"
+#include <iostream>
+
+double FrameStats::gpu_total_ms() const {
+    double total = 0.0;
+    for (int p = 0; p < PASS_COUNT; ++p) total += gpu_ms[p];
+    return total;
+}
+
+uint64_t FrameStats::samples_total() const {
+    uint64_t total = 0;
+    for (int p = 0; p < PASS_COUNT; ++p) total += samples[p];
+    return total;
+}
+
+RenderStats::RenderStats()
+{
+    timer_queries = GLEW_ARB_timer_query || GLEW_VERSION_3_3;
+    for (auto& slot : slots) {
+        if (timer_queries) glGenQueries(PASS_COUNT, slot.time);
+        glGenQueries(PASS_COUNT, slot.samples);
+    }
+    if (!timer_queries) std::cout << "Render stats: no timer queries, GPU times unavailable" << std::endl;
+}
+
+RenderStats::~RenderStats()
+{
+    for (auto& slot : slots) {
+        if (timer_queries) glDeleteQueries(PASS_COUNT, slot.time);
+        glDeleteQueries(PASS_COUNT, slot.samples);
+    }
+    overlay_stream.reset();
+}
+
+bool RenderStats::open_csv(const std::string& path)
+{
+    csv.open(path, std::ios::out | std::ios::trunc);
+    if (!csv) {
+        std::cerr << "Could not open stats file " << path << std::endl;
+        return false;
+    }
+    csv << "frame,build_ms,submit_ms,objects,vertices,clipped_triangles,bytes_uploaded,draw_calls,gpu_valid,"
+           "gpu_triangles_ms,gpu_meshes_ms,gpu_points_ms,samples_triangles,samples_meshes,samples_points,render_scale,"
+           "gl_calls,gl_calls_elided,occlusion_raster_ms,occlusion_test_ms,occluders,occlusion_coverage,"
+           "occludees,occludees_culled,occludees_outside,items_culled,occlusion_verified,hidden_but_drawn,visible_but_culled\n";
+    return true;
+}
+
+void RenderStats::begin_frame(const FrameStats& cpu)
+{
+    QuerySlot& slot = slots[current];
+    if (slot.pending) collect(slot);
+    slot.stats = cpu;
+    slot.stats.gpu_valid = false;
+    slot.pending = true;
+    in_frame = true;
+}
+
+void RenderStats::begin_pass(RenderPass pass)
+{
+    if (!in_frame) return;
+    QuerySlot& slot = slots[current];
+    if (timer_queries) glBeginQuery(GL_TIME_ELAPSED, slot.time[pass]);
+    glBeginQuery(GL_SAMPLES_PASSED, slot.samples[pass]);
+}
+
+void RenderStats::end_pass(RenderPass pass)
+{
+    if (!in_frame) return;
+    if (timer_queries) glEndQuery(GL_TIME_ELAPSED);
+    glEndQuery(GL_SAMPLES_PASSED);
+}
+
+void RenderStats::end_frame(double submit_ms, size_t bytes_uploaded, size_t draw_calls, size_t gl_calls, size_t gl_calls_elided)
+{
+    if (!in_frame) return;
+    QuerySlot& slot = slots[current];
+    slot.stats.submit_ms = submit_ms;
+    slot.stats.bytes_uploaded = bytes_uploaded;
+    slot.stats.draw_calls = draw_calls;
+    slot.stats.gl_calls = gl_calls;
+    slot.stats.gl_calls_elided = gl_calls_elided;
+    current = (current + 1) % QUERY_FRAMES;
+    in_frame = false;
+}
+
+// Reads the slot's queries if the GPU is done with them, otherwise records the frame without
+// GPU numbers rather than stalling on the results.
+void RenderStats::collect(QuerySlot& slot)
+{
+    bool available = true;
+    for (int p = 0; p < PASS_COUNT && available; ++p) {
+        GLuint ready = 0;
+        glGetQueryObjectuiv(slot.samples[p], GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (ready && timer_queries) glGetQueryObjectuiv(slot.time[p], GL_QUERY_RESULT_AVAILABLE, &ready);
+        available = ready != 0;
+    }
+    if (available) {
+        for (int p = 0; p < PASS_COUNT; ++p) {
+            GLuint64 value = 0;
+            if (timer_queries) {
+                glGetQueryObjectui64v(slot.time[p], GL_QUERY_RESULT, &value);
+                slot.stats.gpu_ms[p] = value / 1.0e6;
+            }
+            glGetQueryObjectui64v(slot.samples[p], GL_QUERY_RESULT, &value);
+            slot.stats.samples[p] = value;
+        }
+        slot.stats.gpu_valid = true;
+    } else {
+        dropped_results++;
+    }
+    slot.pending = false;
+    record(slot.stats);
+}
+
+void RenderStats::record(const FrameStats& s)
+{
+    history.push_back(s);
+    if (history.size() > HISTORY) history.pop_front();
+    if (!csv.is_open()) return;
+    csv << s.frame << ',' << s.build_ms << ',' << s.submit_ms << ',' << s.objects_visited << ','
+        << s.vertices_emitted << ',' << s.clipped_triangles << ',' << s.bytes_uploaded << ','
+        << s.draw_calls << ',' << (s.gpu_valid ? 1 : 0);
+    for (int p = 0; p < PASS_COUNT; ++p) csv << ',' << s.gpu_ms[p];
+    for (int p = 0; p < PASS_COUNT; ++p) csv << ',' << s.samples[p];
+    const OcclusionStats& o = s.occlusion;
+    csv << ',' << s.render_scale << ',' << s.gl_calls << ',' << s.gl_calls_elided << ',' << o.raster_ms << ',' << o.test_ms
+        << ',' << o.occluder_triangles << ',' << o.coverage << ',' << o.boxes_tested << ',' << o.boxes_culled << ','
+        << o.boxes_outside << ',' << o.items_culled << ',' << o.verified_points << ',' << o.hidden_but_drawn << ','
+        << o.visible_but_culled << '\n';
+}
+
+void RenderStats::draw_overlay(GLuint program)
+{
+    if (!overlay || history.empty()) return;
+    if (!overlay_stream) {
+        overlay_stream = std::make_unique<StreamBuffer>(GL_ARRAY_BUFFER, 128 * 1024, 3);
+    }
+
+    // Graph in NDC: lower left corner, full height = 2 frames at 60 Hz
+    const float left = -0.98f, bottom = -0.98f, graph_w = 0.8f, graph_h = 0.4f;
+    const double full_ms = 33.3;
+    const float column = graph_w / HISTORY;
+    const size_t max_quads = HISTORY * (2 + PASS_COUNT) + 2;
+
+    overlay_stream->begin_frame((max_quads * 6 + 1) * 5 * sizeof(float));
+    size_t offset = 0;
+    VertexWriter w;
+    w.begin = w.cursor = static_cast<float*>(overlay_stream->allocate(max_quads * 6 * 5 * sizeof(float), 5 * sizeof(float), offset));
+    w.first = offset / (5 * sizeof(float));
+
+    auto quad = [&](float x0, float y0, float x1, float y1, float r, float g, float b) {
+        w.push(x0, y0, r, g, b); w.push(x1, y0, r, g, b); w.push(x0, y1, r, g, b);
+        w.push(x1, y0, r, g, b); w.push(x1, y1, r, g, b); w.push(x0, y1, r, g, b);
+    };
+    auto height = [&](double ms) { return (float)(ms / full_ms) * graph_h; };
+
+    quad(left, bottom, left + graph_w, bottom + graph_h, 0.1f, 0.1f, 0.1f);
+    quad(left, bottom + graph_h * 0.5f, left + graph_w, bottom + graph_h * 0.5f + 0.004f, 0.6f, 0.6f, 0.6f); // 16.7 ms
+    const float pass_colors[PASS_COUNT][3] = {{0.9f, 0.2f, 0.2f}, {0.9f, 0.6f, 0.1f}, {0.9f, 0.9f, 0.2f}};
+    for (size_t i = 0; i < history.size(); ++i) {
+        const FrameStats& s = history[i];
+        float x = left + (HISTORY - history.size() + i) * column;
+        float mid = x + column * 0.5f;
+        // CPU: build (blue) with submit (cyan) on top
+        float y = bottom;
+        quad(x, y, mid, y + height(s.build_ms), 0.2f, 0.4f, 1.0f);
+        y += height(s.build_ms);
+        quad(x, y, mid, y + height(s.submit_ms), 0.2f, 0.9f, 0.9f);
+        // GPU: one segment per pass
+        if (!s.gpu_valid) continue;
+        y = bottom;
+        for (int p = 0; p < PASS_COUNT; ++p) {
+            quad(mid, y, x + column, y + height(s.gpu_ms[p]), pass_colors[p][0], pass_colors[p][1], pass_colors[p][2]);
+            y += height(s.gpu_ms[p]);
+        }
+    }
+    overlay_stream->flush();
+
+    GLState::global().use_program(program);
+    GLState::global().bind_vertex_format(VERTEX_POS2_COLOR3, overlay_stream->get_buffer());
+    glDrawArrays(GL_TRIANGLES, (GLint)w.first, (GLsizei)w.count());
+    overlay_stream->end_frame();
+}
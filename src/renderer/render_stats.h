@@ -0,0 +1,102 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "renderer/stream_buffer.h"
+#include "renderer/occlusion_culler.h"
+
+// Draw passes of SimpleRenderer::submit that get their own GPU queries.
+enum RenderPass { PASS_TRIANGLES, PASS_MESHES, PASS_POINTS, PASS_COUNT };
+
+struct FrameStats {
+    uint64_t frame = 0;
+    // CPU side
+    double build_ms = 0.0;          // build_render_list
+    double submit_ms = 0.0;         // submit, GL calls only (no swap)
+    size_t objects_visited = 0;
+    size_t vertices_emitted = 0;
+    size_t clipped_triangles = 0;
+    OcclusionStats occlusion;       // zero unless occlusion culling is enabled
+    size_t bytes_uploaded = 0;      // vertices, indirect commands and index uploads
+    size_t draw_calls = 0;
+    size_t gl_calls = 0;            // state calls GLState passed to GL
+    size_t gl_calls_elided = 0;     // and the ones it skipped as redundant
+    float render_scale = 1.0f;      // dynamic resolution scale the frame was drawn at
+    // GPU side, filled in QUERY_FRAMES frames later; gpu_valid stays false if the
+    // results were not ready in time (they are never waited for)
+    bool gpu_valid = false;
+    double gpu_ms[PASS_COUNT] = {};
+    uint64_t samples[PASS_COUNT] = {};  // fragments that passed, GL_SAMPLES_PASSED
+
+    double gpu_total_ms() const;
+    uint64_t samples_total() const;
+};
+
+// Frame statistics of the renderer. Every pass is wrapped in a GL_TIME_ELAPSED and a
+// GL_SAMPLES_PASSED query; the query objects are double-buffered per frame, so the results of
+// frame N are read when frame N + 2 starts and only if GL reports them available.
+// Completed frames are kept in a short history, optionally logged as CSV and drawn as a
+// bar graph overlay. All methods are GL thread only.
+class RenderStats {
+public:
+    static constexpr int QUERY_FRAMES = 2;
+    static constexpr size_t HISTORY = 120;
+
+    RenderStats();
+    ~RenderStats();
+
+    // Starts a frame with its CPU counters; collects the GPU results of the frame that used
+    // the same query slot.
+    void begin_frame(const FrameStats& cpu);
+    void begin_pass(RenderPass pass);
+    void end_pass(RenderPass pass);
+    // Adds the counters known only after submission.
+    void end_frame(double submit_ms, size_t bytes_uploaded, size_t draw_calls, size_t gl_calls, size_t gl_calls_elided);
+
+    // Most recent frame with complete statistics (GPU results included when available).
+    const FrameStats& latest() const { return history.empty() ? empty : history.back(); }
+    const std::deque<FrameStats>& get_history() const { return history; }
+    size_t get_dropped_results() const { return dropped_results; }
+    bool has_timer_queries() const { return timer_queries; }
+
+    // Appends one line per completed frame to path. Returns false if it cannot be opened.
+    bool open_csv(const std::string& path);
+
+    void set_overlay(bool enabled) { overlay = enabled; }
+    bool overlay_enabled() const { return overlay; }
+    // Draws the last HISTORY frames as bars (CPU build/submit left, GPU passes right of each
+    // frame) into the lower left corner, using program's position/color attributes.
+    void draw_overlay(GLuint program);
+
+private:
+    struct QuerySlot {
+        GLuint time[PASS_COUNT] = {};
+        GLuint samples[PASS_COUNT] = {};
+        bool pending = false;
+        FrameStats stats;
+    };
+
+    void collect(QuerySlot& slot);
+    void record(const FrameStats& stats);
+
+    QuerySlot slots[QUERY_FRAMES];
+    int current = 0;
+    bool timer_queries = false;
+    bool in_frame = false;
+    size_t dropped_results = 0;
+    std::deque<FrameStats> history;
+    FrameStats empty;
+    std::ofstream csv;
+
+    bool overlay = false;
+    std::unique_ptr<StreamBuffer> overlay_stream;
+};
+
+#endif // RENDER_STATS_H
@@ -0,0 +1,58 @@
+#include "render_target.h"
+#include "renderer/gl_state.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+RenderTarget::~RenderTarget()
+{
+    if (color) glDeleteRenderbuffers(1, &color);
+    GLState::global().delete_framebuffer(fbo);
+}
+
+void RenderTarget::resize(int w, int h, float max_scale)
+{
+    window_width = std::max(w, 1);
+    window_height = std::max(h, 1);
+    int sw = std::max(1, (int)std::ceil(window_width * max_scale));
+    int sh = std::max(1, (int)std::ceil(window_height * max_scale));
+    if (fbo && sw == storage_width && sh == storage_height) return;
+
+    if (!fbo) {
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(1, &color);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, sw, sh);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    GLState& gl = GLState::global();
+    gl.bind_framebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    gl.bind_framebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Render target " << sw << "x" << sh << " incomplete: 0x" << std::hex << status << std::dec << std::endl;
+    }
+    storage_width = sw;
+    storage_height = sh;
+}
+
+void RenderTarget::begin(float scale)
+{
+    width = std::clamp((int)std::lround(window_width * scale), 1, storage_width);
+    height = std::clamp((int)std::lround(window_height * scale), 1, storage_height);
+    GLState::global().bind_framebuffer(GL_FRAMEBUFFER, fbo);
+    GLState::global().viewport(0, 0, width, height);
+}
+
+void RenderTarget::end()
+{
+    GLState& gl = GLState::global();
+    gl.bind_framebuffer(GL_READ_FRAMEBUFFER, fbo);
+    gl.bind_framebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    // Nearest is exact at scale 1, linear smooths the upscale otherwise
+    GLenum filter = (width == window_width && height == window_height) ? GL_NEAREST : GL_LINEAR;
+    glBlitFramebuffer(0, 0, width, height, 0, 0, window_width, window_height, GL_COLOR_BUFFER_BIT, filter);
+    gl.bind_framebuffer(GL_FRAMEBUFFER, 0);
+    gl.viewport(0, 0, window_width, window_height);
+}
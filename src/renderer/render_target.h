@@ -0,0 +1,34 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Offscreen color buffer the scene is drawn into at a fraction of the window size and then
+// upscaled to the window with one glBlitFramebuffer. Storage is sized for the largest allowed
+// scale, so a scale change only moves the viewport and the blit source rectangle.
+class RenderTarget {
+public:
+    RenderTarget() = default;
+    ~RenderTarget();
+
+    // (Re)allocates the storage when the window size or the largest scale changed.
+    void resize(int window_width, int window_height, float max_scale);
+    // Binds the offscreen buffer with a viewport of scale * window size.
+    void begin(float scale);
+    // Upscales the drawn area into the default framebuffer and leaves that bound with a
+    // full window viewport (for overlays drawn at native resolution).
+    void end();
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+
+private:
+    GLuint fbo = 0;
+    GLuint color = 0;
+    int storage_width = 0, storage_height = 0;
+    int window_width = 0, window_height = 0;
+    int width = 0, height = 0;   // area drawn this frame
+};
+
+#endif // RENDER_TARGET_H
@@ -8,6 +8,11 @@
 #include "../math/own_math.h"
 #include <functional>
 #include <iterator>
+#include <cstring>
+#include "jobs/job_system.h"
+#include "renderer/clipper.h"
+#include "renderer/gl_state.h"
+#include "particles/particle_system.h"
 
 // Vertex and Fragment Shader source code
 const char* vertexShaderSource = R"(
@@ -25,9 +30,10 @@ void main() {
 const char* fragmentShaderSource = R"(
     #version 330 core
     in vec3 fragColor;
+    uniform vec3 tint; // material diffuse color, white for untextured draws
     out vec4 outColor;
     void main() {
-        outColor = vec4(fragColor, 1.0);
+        outColor = vec4(fragColor * tint, 1.0);
     }
     )";
 
@@ -85,208 +91,497 @@ SimpleRenderer::SimpleRenderer(SDL_Window* window, int width, int height,
     }
     
     // Set the viewport and enable blending for transparency if needed.
-    glViewport(0, 0, width, height);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState& gl = GLState::global();
+    gl.viewport(0, 0, width, height);
+    gl.set_blend(true);
+    gl.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glEnable(GL_PROGRAM_POINT_SIZE);
     // Compile and link the shader program.
     shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
+    tintLocation = glGetUniformLocation(shaderProgram, "tint");
+    gl.use_program(shaderProgram);
+    gl.uniform3f(tintLocation, 1.0f, 1.0f, 1.0f);
     
-    // Generate a Vertex Array Object and a Vertex Buffer Object.
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+    // The streaming vertex buffer (3 frames in flight), its vertex array is prebuilt by GLState.
+    stream = std::make_unique<StreamBuffer>(GL_ARRAY_BUFFER, 1 << 20, 3);
+    batcher = std::make_unique<DrawBatcher>();
+    stats = std::make_unique<RenderStats>();
 }
 
 
-static void flattenInto(const ObjSP& obj, const ObjVecP& out) {
-    out->push_back(obj);
-    const auto& children = obj->get_children(); // shared_ptr<vector<shared_ptr<Object>>>
-    if (!children) return;
-    out->reserve(out->size() + children->size());
-    for (const auto& ch : *children) {
-        flattenInto(ch, out);
+void SimpleRenderer::enable_occlusion_culling(bool verify) {
+    occlusion = std::make_unique<OcclusionCuller>();
+    occlusion->set_verify(verify);
+}
+
+void SimpleRenderer::enable_dynamic_resolution(const ResolutionSettings& settings) {
+    resolution = std::make_unique<ResolutionController>(settings);
+    target = std::make_unique<RenderTarget>();
+    target->resize(width, height, resolution->get_settings().max_scale);
+    if (!stats->has_timer_queries()) {
+        std::cerr << "Dynamic resolution needs GPU timer queries, the scale stays at "
+                  << resolution->get_scale() << std::endl;
     }
 }
-// In this OpenGL version, we build a vertex array (positions + colors) from the scene->get_objects().
-// For simplicity, we assume all scene->get_objects() are rendered as triangles in normalized device coordinates.
-// You’ll need to convert your shape coordinates (which are in screen space) into NDC.
-void SimpleRenderer::render() {
-    // Clear the screen.
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    
-    glUseProgram(shaderProgram);
 
-    // Data containers: one for triangles and one for vertices.
-    std::vector<float> triangleData;
-    std::vector<float> pointData;
-    //flatten  tree of scene->get_objects() into list of object references
+// Projects point records (ingest ring or point cloud pages) into interleaved vertices through the SIMD kernel.
+static void project_point_records(const ProjectionParams& params, const shm::PointRecord* src, size_t count, float* dst) {
+    thread_local std::vector<float> xs, ys, zs, nx, ny;
+    xs.resize(count); ys.resize(count); zs.resize(count); nx.resize(count); ny.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        xs[i] = src[i].pos[0]; ys[i] = src[i].pos[1]; zs[i] = src[i].pos[2];
+    }
+    project_batch(params, xs.data(), ys.data(), zs.data(), count, nx.data(), ny.data());
+    for (size_t i = 0; i < count; ++i) {
+        float* v = dst + i * 5;
+        v[0] = nx[i]; v[1] = ny[i];
+        v[2] = src[i].color[0] / 255.0f; v[3] = src[i].color[1] / 255.0f; v[4] = src[i].color[2] / 255.0f;
+    }
+}
+
+// Projects particles straight from the frame's SoA arrays, only the colors need unpacking.
+static void project_particles(const ProjectionParams& params, const ParticleFrame& frame, size_t first, size_t count, float* dst) {
+    thread_local std::vector<float> nx, ny;
+    nx.resize(count); ny.resize(count);
+    project_batch(params, &frame.x[first], &frame.y[first], &frame.z[first], count, nx.data(), ny.data());
+    for (size_t i = 0; i < count; ++i) {
+        float* v = dst + i * 5;
+        uint32_t c = frame.color[first + i];
+        v[0] = nx[i]; v[1] = ny[i];
+        v[2] = (c & 0xff) / 255.0f; v[3] = (c >> 8 & 0xff) / 255.0f; v[4] = (c >> 16 & 0xff) / 255.0f;
+    }
+}
+
+void SimpleRenderer::set_pixel_frame(const PixelFrame& frame) {
+    if (!pixelView) pixelView = std::make_unique<PixelView>();
+    pixelView->upload(frame);
+    pixelBytesPending += pixelView->get_uploaded_bytes();
+}
+
+void SimpleRenderer::clear_pixel_frame() {
+    if (pixelView) pixelView->clear();
+    externalPixelFrame = UINT64_MAX;
+}
 
+// Single threaded path: capture, build in place and submit on the calling (GL) thread.
+void SimpleRenderer::render() {
+    scene->capture(frameSnapshot, width, height);
+    build_render_list(frameSnapshot, frameList, true);
+    submit(frameList);
+}
+
+// In this OpenGL version, we build a vertex array (positions + colors) from the snapshot items.
+// For simplicity, we assume all 2d shapes are given in screen space and converted into NDC.
+// The worst case vertex count is computed first so the whole block can be reserved before
+// any projection happens; in place that block is the mapped stream buffer itself.
+void SimpleRenderer::build_render_list(const SceneSnapshot& snap, RenderList& list, bool in_place) {
+    uint64_t buildStart = SDL_GetTicksNS();
+    list.frame = snap.frame;
+    list.simulated_ns = snap.simulated_ns;
+    list.meshes = snap.meshes;
+    list.mesh_draws.clear();
+    const int w = snap.width;
+    const int h = snap.height;
+
+    // Project every item once, spread over the job system; the emit loops below only copy.
+    // The cache skips items that did not move since the last frame with the same camera.
+    // Clip outcodes are classified alongside, they decide which triangles need clipping.
+    // Items of boxes the occlusion culler found hidden are skipped from here on.
+    projectionCache.begin_frame(snap.camera, snap.max_id);
+    const ClipVolume clipVolume = make_clip_volume(snap.camera);
+    if (occlusion) occlusion->cull(snap, projectionCache.get_params(), clipVolume);
+    const uint8_t* culled = occlusion ? occlusion->get_item_culled().data() : nullptr;
+    projected.resize(snap.items.size());
+    clipCodes.resize(snap.items.size());
+    JobSystem::global().parallel_for("render_project", 0, snap.items.size(), [&](size_t b, size_t e) {
+        size_t i = b;
+        while (i < e) {
+            if (culled && culled[i]) {
+                clipCodes[i++] = 0;
+                continue;
+            }
+            size_t run = i;
+            while (run < e && !(culled && culled[run])) ++run;
+            projectionCache.refresh_range(snap.items, i, run, projected.data());
+            for (; i < run; ++i) clipCodes[i] = clip_outcode(clipVolume, snap.items[i].pos);
+        }
+    }, 512);
+    auto meshCulled = [&](size_t m) { return occlusion && occlusion->is_mesh_culled(m); };
+
+    // Meshes with every vertex inside the clip volume keep the indexed draw, the others are
+    // drawn de-indexed so their triangles can be clipped one by one.
+    meshNeedsClip.assign(snap.mesh_ranges.size(), 0);
+    for (size_t m = 0; m < snap.mesh_ranges.size(); ++m) {
+        if (meshCulled(m)) continue;
+        const auto& range = snap.mesh_ranges[m];
+        uint8_t any = 0;
+        for (size_t i = range.first_item; i < range.first_item + range.count; ++i) any |= clipCodes[i];
+        meshNeedsClip[m] = any != 0;
+    }
+    // Vertices a triangle emits: 3 unclipped, none when rejected, a fan of up to 4 when clipped
+    auto clippedVertexBound = [&](uint32_t a, uint32_t b, uint32_t c) -> size_t {
+        if (clipCodes[a] & clipCodes[b] & clipCodes[c]) return 0;
+        if ((clipCodes[a] | clipCodes[b] | clipCodes[c]) == 0) return 3;
+        return 3 * (MAX_CLIPPED_VERTICES - 2);
+    };
 
-   // If your roots are shared_ptr<Object>
-    ObjVecP flat = std::make_shared<ObjVec>();
-    for (const auto& root : *scene->get_objects()) flattenInto(root, flat);
+    // Upper bound of emitted vertices: one for every point, fixed counts for 2d shapes
+    size_t meshVerts = 0;
+    for (const auto& range : snap.mesh_ranges) meshVerts += range.count;   // flat items end here, culled or not
+    size_t maxTriangleVerts = 0;
+    for (const auto& idx : snap.indexed) maxTriangleVerts += clippedVertexBound(idx[0], idx[1], idx[2]);
+    for (size_t m = 0; m < snap.mesh_ranges.size(); ++m) {
+        if (!meshNeedsClip[m]) continue;
+        const auto& range = snap.mesh_ranges[m];
+        const SceneMesh& mesh = (*snap.meshes)[range.mesh_index];
+        const auto& indices = *mesh.indices;
+        // Only the submesh ranges, a mesh that is still loading has indices past its vertices
+        for (const auto& sm : mesh.submeshes) {
+            for (size_t t = sm.indexOffset; t + 2 < sm.indexOffset + sm.indexCount; t += 3) {
+                maxTriangleVerts += clippedVertexBound((uint32_t)(range.first_item + indices[t]),
+                                                       (uint32_t)(range.first_item + indices[t + 1]),
+                                                       (uint32_t)(range.first_item + indices[t + 2]));
+            }
+        }
+    }
+    size_t maxPointVerts = 0;
+    for (size_t i = 0; i < snap.items.size() - meshVerts; ++i) {
+        switch (snap.items[i].type) {
+            case RECTANGLE: maxTriangleVerts += 6; break;
+            case CIRCLE:    maxTriangleVerts += CIRCLE_SEGMENTS * 3; break;
+            case TRIANGLE:  maxTriangleVerts += 3; break;
+            case VERTEX:    maxPointVerts += 1; break;
+            default: break;
+        }
+    }
+    const bool externalPoints = snap.external_ring && snap.external.type == shm::PAYLOAD_POINTS;
+    if (externalPoints) maxPointVerts += snap.external.count;
+    std::vector<size_t> cloudFirst;   // first point of each cloud page in the points block
+    size_t cloudPoints = 0;
+    for (size_t p = 0; p < snap.cloud_pages.size(); ++p) {
+        cloudFirst.push_back(cloudPoints);
+        if (!occlusion || !occlusion->is_page_culled(p)) cloudPoints += snap.cloud_pages[p]->size();
+    }
+    maxPointVerts += cloudPoints;
+    size_t particlePoints = 0;
+    for (const auto& frame : snap.particles) particlePoints += frame->count;
+    maxPointVerts += particlePoints;
+    reserve_vertices(list, maxTriangleVerts + maxPointVerts + meshVerts, in_place);
+    VertexWriter triangles = make_writer(list, 0);
+    VertexWriter points = make_writer(list, maxTriangleVerts);
+    VertexWriter meshVertices = make_writer(list, maxTriangleVerts + maxPointVerts);
+
+    // Emits one 3d triangle given by item positions, clipped when it leaves the clip volume.
+    const ProjectionParams& params = projectionCache.get_params();
+    auto emit_triangle = [&](const uint32_t corner[3], const float tint[3]) {
+        uint8_t all = clipCodes[corner[0]] & clipCodes[corner[1]] & clipCodes[corner[2]];
+        uint8_t any = clipCodes[corner[0]] | clipCodes[corner[1]] | clipCodes[corner[2]];
+        if (all) return; // completely behind the camera or outside one FOV edge
+        if (!any) {
+            for (int k = 0; k < 3; ++k) {
+                const SnapshotItem& v = snap.items[corner[k]];
+                triangles.push(projected[corner[k]][0], projected[corner[k]][1],
+                               v.color[0] / 255.f * tint[0], v.color[1] / 255.f * tint[1], v.color[2] / 255.f * tint[2]);
+            }
+            return;
+        }
+        ClipVertex in[3];
+        for (int k = 0; k < 3; ++k) {
+            const SnapshotItem& v = snap.items[corner[k]];
+            for (int c = 0; c < 3; ++c) {
+                in[k].pos[c] = v.pos[c];
+                in[k].color[c] = v.color[c] / 255.f * tint[c];
+            }
+        }
+        ClipVertex out[MAX_CLIPPED_VERTICES];
+        int n = clip_triangle(clipVolume, in, out);
+        std::array<float,2> ndc[MAX_CLIPPED_VERTICES];
+        for (int k = 0; k < n; ++k) ndc[k] = project_point(params, out[k].pos);
+        // Fan around the first corner, the clipped polygon is convex
+        for (int k = 1; k + 1 < n; ++k) {
+            const int fan[3] = {0, k, k + 1};
+            for (int f : fan) triangles.push(ndc[f][0], ndc[f][1], out[f].color[0], out[f].color[1], out[f].color[2]);
+        }
+        list.clipped_triangles++;
+    };
+    list.clipped_triangles = 0;
+
+    // Each mesh vertex is projected exactly once; the triangles reference it via baseVertex.
+    for (size_t m = 0; m < snap.mesh_ranges.size(); ++m) {
+        if (meshCulled(m)) continue;
+        const auto& range = snap.mesh_ranges[m];
+        if (!meshNeedsClip[m]) {
+            list.mesh_draws.push_back({range.mesh_index, meshVertices.first + meshVertices.count()});
+        } else {
+            // Same triangles as the indexed draw, with the material tint applied here
+            const SceneMesh& mesh = (*snap.meshes)[range.mesh_index];
+            const auto& indices = *mesh.indices;
+            for (const auto& sm : mesh.submeshes) {
+                float tint[3] = {1.0f, 1.0f, 1.0f};
+                if (sm.material >= 0) {
+                    const Vector3& kd = mesh.materials[sm.material].Kd;
+                    tint[0] = kd.x; tint[1] = kd.y; tint[2] = kd.z;
+                }
+                for (size_t t = sm.indexOffset; t + 2 < sm.indexOffset + sm.indexCount; t += 3) {
+                    const uint32_t corner[3] = {(uint32_t)(range.first_item + indices[t]),
+                                                (uint32_t)(range.first_item + indices[t + 1]),
+                                                (uint32_t)(range.first_item + indices[t + 2])};
+                    emit_triangle(corner, tint);
+                }
+            }
+        }
+        for (size_t i = range.first_item; i < range.first_item + range.count; ++i) {
+            const SnapshotItem& v = snap.items[i];
+            meshVertices.push(projected[i][0], projected[i][1], v.color[0] / 255.0f, v.color[1] / 255.0f, v.color[2] / 255.0f);
+        }
+    }
 
-    // id -> weak_ptr so we don’t extend lifetimes
-    IdMap idMap;
-    idMap.reserve(flat->size());
-    for (const auto& sp : *flat) idMap.emplace(sp->id, sp);
+    // Iterate the *flattened* list so child vertices get added to points
+    for (size_t i = 0; i < snap.items.size() - meshVerts; ++i) {
+        if (culled && culled[i]) continue;
+        const SnapshotItem& shape = snap.items[i];
+        bool in_frame = is_point_in_frame(shape.pos, snap.camera);
 
-    // Iterate the *flattened* list so child vertices get added to pointData
-    for (const auto& shape : *flat) {
         // Common color data.
-        
-        //print orientation of camera
-        shape->in_frame=is_point_in_frame(shape->get_coords(),scene->get_camera()->pos,scene->get_camera()->orientation);
-
-       
-        std::array<uint8_t, 3> colors = shape->get_color();
-        float r = colors[0] / 255.0f;
-        float g = colors[1] / 255.0f;
-        float b = colors[2] / 255.0f;
-      
-
-        if (shape->get_shape_type() == RECTANGLE) {
-            auto rect = static_cast<Rect*>(shape.get());
-            auto pos = rect->get_coords();
-            float w = rect->get_width();
-            float h = rect->get_height();
+        float r = shape.color[0] / 255.0f;
+        float g = shape.color[1] / 255.0f;
+        float b = shape.color[2] / 255.0f;
+
+        if (shape.type == RECTANGLE) {
+            float rw = shape.size[0];
+            float rh = shape.size[1];
             // Convert screen coordinates to NDC.
-            float x = (pos[0] / width) * 2.0f - 1.0f;
-            float y = 1.0f - (pos[1] / height) * 2.0f;
-            float ndcW = (w / width) * 2.0f;
-            float ndcH = (h / height) * 2.0f;
+            float x = (shape.pos[0] / w) * 2.0f - 1.0f;
+            float y = 1.0f - (shape.pos[1] / h) * 2.0f;
+            float ndcW = (rw / w) * 2.0f;
+            float ndcH = (rh / h) * 2.0f;
             // Two triangles for the rectangle.
-            triangleData.insert(triangleData.end(), { x, y, r, g, b });
-            triangleData.insert(triangleData.end(), { x + ndcW, y, r, g, b });
-            triangleData.insert(triangleData.end(), { x, y - ndcH, r, g, b });
+            triangles.push(x, y, r, g, b);
+            triangles.push(x + ndcW, y, r, g, b);
+            triangles.push(x, y - ndcH, r, g, b);
             
-            triangleData.insert(triangleData.end(), { x + ndcW, y, r, g, b });
-            triangleData.insert(triangleData.end(), { x + ndcW, y - ndcH, r, g, b });
-            triangleData.insert(triangleData.end(), { x, y - ndcH, r, g, b });
+            triangles.push(x + ndcW, y, r, g, b);
+            triangles.push(x + ndcW, y - ndcH, r, g, b);
+            triangles.push(x, y - ndcH, r, g, b);
         }
-        else if (shape->get_shape_type() == CIRCLE) {
-            auto circle = static_cast<Circle*>(shape.get());
-            auto pos = circle->get_coords();
-            float radius = circle->get_radius();
-            float cx = (pos[0] / width) * 2.0f - 1.0f;
-            float cy = 1.0f - (pos[1] / height) * 2.0f;
-            float ndcRadiusX = (radius / width) * 2.0f;
-            float ndcRadiusY = (radius / height) * 2.0f;
-            const int segments = 32;
+        else if (shape.type == CIRCLE) {
+            float radius = shape.size[0];
+            float cx = (shape.pos[0] / w) * 2.0f - 1.0f;
+            float cy = 1.0f - (shape.pos[1] / h) * 2.0f;
+            float ndcRadiusX = (radius / w) * 2.0f;
+            float ndcRadiusY = (radius / h) * 2.0f;
+            const int segments = CIRCLE_SEGMENTS;
             // Use a triangle fan for the circle.
-            for (int i = 0; i < segments; ++i) {
-                float theta1 = (2.0f * M_PI * i) / segments;
-                float theta2 = (2.0f * M_PI * (i + 1)) / segments;
-                triangleData.insert(triangleData.end(), { cx, cy, r, g, b });
-                triangleData.insert(triangleData.end(), { cx + ndcRadiusX * static_cast<float>(cos(theta1)), cy + ndcRadiusY * static_cast<float>(sin(theta1)), r, g, b });
-                triangleData.insert(triangleData.end(), { cx + ndcRadiusX * static_cast<float>(cos(theta2)), cy + ndcRadiusY * static_cast<float>(sin(theta2)), r, g, b });
+            for (int k = 0; k < segments; ++k) {
+                float theta1 = (2.0f * M_PI * k) / segments;
+                float theta2 = (2.0f * M_PI * (k + 1)) / segments;
+                triangles.push(cx, cy, r, g, b);
+                triangles.push(cx + ndcRadiusX * static_cast<float>(cos(theta1)), cy + ndcRadiusY * static_cast<float>(sin(theta1)), r, g, b);
+                triangles.push(cx + ndcRadiusX * static_cast<float>(cos(theta2)), cy + ndcRadiusY * static_cast<float>(sin(theta2)), r, g, b);
             }
         }
-        else if (shape->get_shape_type() == TRIANGLE) {
-            if(shape->in_frame==false){
-                continue; // Skip scene->get_objects() that are not in the frame
+        else if (shape.type == TRIANGLE) {
+            if(in_frame==false){
+                continue; // Skip objects that are not in the frame
             }
-            auto triangle = static_cast<Triangle*>(shape.get());
-            auto pos = triangle->get_coords();
-            float size = triangle->get_size();
-            float x = (pos[0] / width) * 2.0f - 1.0f;
-            float y = 1.0f - (pos[1] / height) * 2.0f;
-            float ndcSizeX = (size / width) * 2.0f;
-            float ndcSizeY = (size / height) * 2.0f;
-            triangleData.insert(triangleData.end(), { x, y, r, g, b });
-            triangleData.insert(triangleData.end(), { x + ndcSizeX, y, r, g, b });
-            triangleData.insert(triangleData.end(), { x + ndcSizeX / 2, y - ndcSizeY, r, g, b });
+            float size = shape.size[0];
+            float x = (shape.pos[0] / w) * 2.0f - 1.0f;
+            float y = 1.0f - (shape.pos[1] / h) * 2.0f;
+            float ndcSizeX = (size / w) * 2.0f;
+            float ndcSizeY = (size / h) * 2.0f;
+            triangles.push(x, y, r, g, b);
+            triangles.push(x + ndcSizeX, y, r, g, b);
+            triangles.push(x + ndcSizeX / 2, y - ndcSizeY, r, g, b);
         }
-        else if (shape->get_shape_type() == VERTEX) {
-            if(shape->in_frame==false){
-                continue; // Skip scene->get_objects() that are not in the frame
+        else if (shape.type == VERTEX) {
+            if(in_frame==false){
+                continue; // Skip objects that are not in the frame
             }
             // For vertices, use the camera's orientation and position to project.
-            auto vertex = static_cast<Vertex*>(shape.get());
-            auto pos = vertex->get_coords();
-            // Use your custom projection function.
-            std::array<float,2> coords = project(pos, scene->get_camera()->orientation, scene->get_camera()->pos);
-            // In this OpenGL version, we simulate drawing a "block" by using a point with an increased size.
-            // (Alternatively, you could add several points to form a quad.)
-            // Assume 'coords' are already in NDC or convert from screen space if needed.
-            pointData.insert(pointData.end(), { coords[0], coords[1], r, g, b });
+            points.push(projected[i][0], projected[i][1], r, g, b);
         }
         // Extend with other shape types if needed.
     }
 
+    // Points of the shared memory ingest are projected straight out of the mapping into the
+    // vertex block. If the producer lapped the ring meanwhile they may be torn and are dropped.
+    list.external = snap.external;
+    list.external_ring = snap.external_ring;
+    list.external_valid = false;
+    if (externalPoints) {
+        const shm::PointRecord* src = static_cast<const shm::PointRecord*>(snap.external.payload);
+        float* dst = points.cursor;
+        JobSystem::global().parallel_for("render_external", 0, snap.external.count, [&](size_t b, size_t e) {
+            project_point_records(params, src + b, e - b, dst + b * 5);
+        }, 1024);
+        if (snap.external_ring->validate(snap.external)) {
+            points.cursor += (size_t)snap.external.count * 5;
+            list.external_valid = true;
+        }
+    }
+
+    // Paged point cloud, one job per page (pages hold up to 64k points)
+    if (cloudPoints > 0) {
+        float* dst = points.cursor;
+        JobSystem::global().parallel_for("render_cloud", 0, snap.cloud_pages.size(), [&](size_t b, size_t e) {
+            for (size_t p = b; p < e; ++p) {
+                if (occlusion && occlusion->is_page_culled(p)) continue;
+                const auto& page = *snap.cloud_pages[p];
+                project_point_records(params, page.data(), page.size(), dst + cloudFirst[p] * 5);
+            }
+        });
+        points.cursor += cloudPoints * 5;
+    }
+
+    // Particles, every emitter split into jobs of 16k
+    for (const auto& frame : snap.particles) {
+        float* dst = points.cursor;
+        JobSystem::global().parallel_for("render_particles", 0, frame->count, [&](size_t b, size_t e) {
+            project_particles(params, *frame, b, e - b, dst + b * 5);
+        }, 16384);
+        points.cursor += frame->count * 5;
+    }
+
     // Now process the index_buffer to draw triangles based on shape ids.
-    // For each index triplet, find the corresponding scene->get_objects(), project their coordinates,
-    // and add a triangle with per-vertex colors.
-    hand_data_to_shader(triangleData, pointData, idMap);
+    // The snapshot already resolved the ids, add the projected corners with per-vertex colors.
+    const float white[3] = {1.0f, 1.0f, 1.0f};
+    for (const auto& idx : snap.indexed) emit_triangle(idx.data(), white);
+
+    list.triangles = {triangles.first, triangles.count()};
+    list.points = {points.first, points.count()};
+    list.mesh_vertices = {meshVertices.first, meshVertices.count()};
+    list.objects_visited = snap.items.size();
+    list.occlusion = occlusion ? occlusion->get_stats() : OcclusionStats();
+    list.build_ms = (SDL_GetTicksNS() - buildStart) / 1.0e6;
 }
 
-void SimpleRenderer::hand_data_to_shader(std::vector<float> triangleData,
-                                   std::vector<float> pointData,
-                                   const IdMap& idMap)
-{
-    auto getObj = [&](int id) -> std::shared_ptr<Object> {
-        auto it = idMap.find(id);
-        if (it == idMap.end())
-            throw std::runtime_error("Object not found for given index: " + std::to_string(id));
-        auto sp = it->second.lock();
-        if (!sp)
-            throw std::runtime_error("Indexed object expired: " + std::to_string(id));
-        return sp;
-    };
+void SimpleRenderer::reserve_vertices(RenderList& list, size_t count, bool in_place) {
+    list.in_place = in_place;
+    list.capacity = count;
+    if (in_place) {
+        // + one stride for alignment padding
+        stream->begin_frame((count + 1) * VERTEX_STRIDE);
+        size_t offset = 0;
+        list.vertices = static_cast<float*>(stream->allocate(count * VERTEX_STRIDE, VERTEX_STRIDE, offset));
+        list.block_first = offset / VERTEX_STRIDE;
+    } else {
+        list.storage.resize(count * 5);
+        list.vertices = list.storage.data();
+        list.block_first = 0;
+    }
+}
 
-    for (const std::array<int,3>& idx : *scene->get_index_buffer()) {
-        auto s1 = getObj(idx[0]);
-        auto s2 = getObj(idx[1]);
-        auto s3 = getObj(idx[2]);
+VertexWriter SimpleRenderer::make_writer(RenderList& list, size_t first) {
+    VertexWriter writer;
+    writer.begin = list.vertices + first * 5;
+    writer.cursor = writer.begin;
+    writer.first = first;
+    return writer;
+}
 
-        auto p1 = project(s1->get_coords(), scene->get_camera()->orientation, scene->get_camera()->pos);
-        auto p2 = project(s2->get_coords(), scene->get_camera()->orientation, scene->get_camera()->pos);
-        auto p3 = project(s3->get_coords(), scene->get_camera()->orientation, scene->get_camera()->pos);
+void SimpleRenderer::submit(RenderList& list) {
+    uint64_t submitStart = SDL_GetTicksNS();
+    GLState& gl = GLState::global();
+    gl.begin_frame();
+    FrameStats frameStats;
+    frameStats.frame = list.frame;
+    frameStats.build_ms = list.build_ms;
+    frameStats.objects_visited = list.objects_visited;
+    frameStats.clipped_triangles = list.clipped_triangles;
+    frameStats.occlusion = list.occlusion;
+    frameStats.vertices_emitted = list.triangles.count + list.points.count + list.mesh_vertices.count;
+    if (resolution) {
+        // GPU times arrive a couple of frames late, each measured frame is fed once
+        const FrameStats& measured = stats->latest();
+        if (measured.gpu_valid && measured.frame != lastControlledFrame) {
+            resolution->update(measured.gpu_total_ms());
+            lastControlledFrame = measured.frame;
+        }
+        frameStats.render_scale = resolution->get_scale();
+        target->begin(frameStats.render_scale);
+    }
+    stats->begin_frame(frameStats);
+    size_t uploaded = frameStats.vertices_emitted * VERTEX_STRIDE; // written in place into the mapped buffer
 
-        auto c1 = s1->get_color(); auto c2 = s2->get_color(); auto c3 = s3->get_color();
-        float r1=c1[0]/255.f,g1=c1[1]/255.f,b1=c1[2]/255.f;
-        float r2=c2[0]/255.f,g2=c2[1]/255.f,b2=c2[2]/255.f;
-        float r3=c3[0]/255.f,g3=c3[1]/255.f,b3=c3[2]/255.f;
+    // Clear the screen.
+    gl.clear_color(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
 
-        triangleData.insert(triangleData.end(), {
-            p1[0], p1[1], r1, g1, b1,
-            p2[0], p2[1], r2, g2, b2,
-            p3[0], p3[1], r3, g3, b3
-        });
+    // Externally produced pixels become the background, copied from the mapping into the PBO
+    if (list.external_ring && list.external.type == shm::PAYLOAD_PIXELS && list.external.frame != externalPixelFrame) {
+        PixelFrame frame;
+        frame.data = list.external.payload;
+        frame.width = list.external.width;
+        frame.height = list.external.height;
+        frame.stride = list.external.stride;
+        frame.format = (PixelFormat)list.external.format;
+        set_pixel_frame(frame);
+        list.external_valid = list.external_ring->validate(list.external);
+        externalPixelFrame = list.external_valid ? list.external.frame : UINT64_MAX; // torn: upload again
     }
-
-    // --- draw triangles (same as your original) ---
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    if (!triangleData.empty()) {
-        glBufferData(GL_ARRAY_BUFFER, triangleData.size()*sizeof(float), triangleData.data(), GL_DYNAMIC_DRAW);
-        GLint posAttrib = glGetAttribLocation(shaderProgram, "position");
-        glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)0);
-        glEnableVertexAttribArray(posAttrib);
-        GLint colAttrib = glGetAttribLocation(shaderProgram, "color");
-        glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(2*sizeof(float)));
-        glEnableVertexAttribArray(colAttrib);
-        glDrawArrays(GL_TRIANGLES, 0, triangleData.size()/5);
+    if (pixelView) pixelView->draw();
+
+    if (!list.in_place) {
+        // Built off the GL thread: one bulk copy into the mapped stream region
+        stream->begin_frame((list.capacity + 1) * VERTEX_STRIDE);
+        size_t offset = 0;
+        void* dst = stream->allocate(list.capacity * VERTEX_STRIDE, VERTEX_STRIDE, offset);
+        std::memcpy(dst, list.storage.data(), list.capacity * VERTEX_STRIDE);
+        list.block_first = offset / VERTEX_STRIDE;
+        uploaded = list.capacity * VERTEX_STRIDE;
     }
+    uploaded += pixelBytesPending;
+    pixelBytesPending = 0;
+    if (list.meshes) {
+        batcher->sync_meshes(*list.meshes);
+        for (const auto& draw : list.mesh_draws) {
+            batcher->add_mesh(draw.mesh_index, (*list.meshes)[draw.mesh_index], shaderProgram,
+                              (GLint)(list.block_first + draw.base_vertex));
+        }
+    }
+    gl.use_program(shaderProgram);
+    hand_data_to_shader(list);
+    stream->end_frame();
+    if (target) target->end();
+
+    size_t drawCalls = batcher->get_draw_calls() + (list.triangles.count > 0) + (list.points.count > 0) + (list.mesh_vertices.count > 0);
+    stats->end_frame((SDL_GetTicksNS() - submitStart) / 1.0e6, uploaded + batcher->get_uploaded_bytes(), drawCalls,
+                     gl.get_issued_calls(), gl.get_elided_calls());
+    stats->draw_overlay(shaderProgram);
+}
 
-    // --- draw points (same as your original) ---
-    if (!pointData.empty()) {
-        glBufferData(GL_ARRAY_BUFFER, pointData.size()*sizeof(float), pointData.data(), GL_DYNAMIC_DRAW);
-        GLint posAttrib = glGetAttribLocation(shaderProgram, "position");
-        glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)0);
-        glEnableVertexAttribArray(posAttrib);
-        GLint colAttrib = glGetAttribLocation(shaderProgram, "color");
-        glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(2*sizeof(float)));
-        glEnableVertexAttribArray(colAttrib);
-        glDrawArrays(GL_POINTS, 0, pointData.size()/5);
+void SimpleRenderer::hand_data_to_shader(const RenderList& list)
+{
+    // Vertices are already in the stream buffer, only make them visible and draw.
+    // The attribute layout lives in the prebuilt vertex array of the stream buffer.
+    stream->flush();
+    GLState::global().bind_vertex_format(VERTEX_POS2_COLOR3, stream->get_buffer());
+
+    stats->begin_pass(PASS_TRIANGLES);
+    if (list.triangles.count > 0) {
+        glDrawArrays(GL_TRIANGLES, list.block_first + list.triangles.first, list.triangles.count);
+    }
+    stats->end_pass(PASS_TRIANGLES);
+    // Indexed mesh triangles, sorted by material
+    stats->begin_pass(PASS_MESHES);
+    batcher->flush(tintLocation);
+    stats->end_pass(PASS_MESHES);
+    stats->begin_pass(PASS_POINTS);
+    if (list.points.count > 0) {
+        glDrawArrays(GL_POINTS, list.block_first + list.points.first, list.points.count);
+    }
+    // Mesh vertices are still drawn as points on top, same as before they were indexed
+    if (list.mesh_vertices.count > 0) {
+        glDrawArrays(GL_POINTS, list.block_first + list.mesh_vertices.first, list.mesh_vertices.count);
     }
-    glBindVertexArray(0);
+    stats->end_pass(PASS_POINTS);
 }
 
 
 
-bool SimpleRenderer::is_point_in_frame(const std::vector<float> point, const std::vector<float> camera_pos, const std::vector<float> camera_orientation) {
+bool SimpleRenderer::is_point_in_frame(const float point[3], const CameraState& camera) {
+    const std::vector<float>& camera_pos = camera.pos;
+    const std::vector<float>& camera_orientation = camera.orientation;
     // Calculate the vector from the camera to the point
     Vector3 camera_to_point = {point[0] - camera_pos[0],point[1]- camera_pos[1] , point[2] - camera_pos[2]};
     
@@ -300,120 +595,12 @@ bool SimpleRenderer::is_point_in_frame(const std::vector<float> point, const std
 }
 
 
-void SimpleRenderer::hand_data_to_shader(std::vector<float> triangleData,    std::vector<float> pointData){
-    for (const std::array<int,3>& index : *scene->get_index_buffer()) {
-        Object* shape1 = nullptr;
-        Object* shape2 = nullptr;
-        Object* shape3 = nullptr;
-        for (const auto& shape : *scene->get_objects()) {
-            if (shape->id == index[0])
-                shape1 = shape.get();
-            else if (shape->id == index[1])
-                shape2 = shape.get();
-            else if (shape->id == index[2])
-                shape3 = shape.get();
-        }
-        if (!shape1 || !shape2 || !shape3) {
-            throw std::runtime_error("Object not found for given index");
-        }
-        // Project each shape's coordinate using the camera parameters.
-        std::array<float,2> coords1 = project(shape1->get_coords(), scene->get_camera()->orientation, scene->get_camera()->pos);
-        std::array<float,2> coords2 = project(shape2->get_coords(), scene->get_camera()->orientation, scene->get_camera()->pos);
-        std::array<float,2> coords3 = project(shape3->get_coords(), scene->get_camera()->orientation, scene->get_camera()->pos);
-        // Get colors for each shape.
-        std::array<uint8_t, 3> colors1 = shape1->get_color();
-        std::array<uint8_t, 3> colors2 = shape2->get_color();
-        std::array<uint8_t, 3> colors3 = shape3->get_color();
-        // Convert color components.
-        float r1 = colors1[0] / 255.0f, g1 = colors1[1] / 255.0f, b1 = colors1[2] / 255.0f;
-        float r2 = colors2[0] / 255.0f, g2 = colors2[1] / 255.0f, b2 = colors2[2] / 255.0f;
-        float r3 = colors3[0] / 255.0f, g3 = colors3[1] / 255.0f, b3 = colors3[2] / 255.0f;
-        // Add the triangle vertices.
-        triangleData.insert(triangleData.end(), { coords1[0], coords1[1], r1, g1, b1 });
-        triangleData.insert(triangleData.end(), { coords2[0], coords2[1], r2, g2, b2 });
-        triangleData.insert(triangleData.end(), { coords3[0], coords3[1], r3, g3, b3 });
-    }
-
-    // Bind the VAO and VBO for rendering.
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    // --- Render triangle-based scene->get_objects() ---
-    if (!triangleData.empty()) {
-        glBufferData(GL_ARRAY_BUFFER, triangleData.size() * sizeof(float), triangleData.data(), GL_DYNAMIC_DRAW);
-        GLint posAttrib = glGetAttribLocation(shaderProgram, "position");
-        glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(posAttrib);
-        GLint colAttrib = glGetAttribLocation(shaderProgram, "color");
-        glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(2 * sizeof(float)));
-        glEnableVertexAttribArray(colAttrib);
-        glDrawArrays(GL_TRIANGLES, 0, triangleData.size() / 5);
-    }
-
-    // --- Render vertices as points ---
-    if (!pointData.empty()) {
-        // Set an increased point size to simulate a pixel block.
-        glPointSize(1.0f);
-        glBufferData(GL_ARRAY_BUFFER, pointData.size() * sizeof(float), pointData.data(), GL_DYNAMIC_DRAW);
-        GLint posAttrib = glGetAttribLocation(shaderProgram, "position");
-        glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(posAttrib);
-        GLint colAttrib = glGetAttribLocation(shaderProgram, "color");
-        glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(2 * sizeof(float)));
-        glEnableVertexAttribArray(colAttrib);
-        glDrawArrays(GL_POINTS, 0, pointData.size() / 5);
-    }
-    
-    // Unbind the VAO.
-    glBindVertexArray(0);
-}
-
-std::array<float,2> SimpleRenderer::project(std::vector<float> pos, std::vector<float> camera_orientation, std::vector<float> camera_pos){
-    // Calculate camera and relative angles (in degrees)
-    float camara_elev = atan2(camera_orientation[2], sqrt(pow(camera_orientation[0],2) + pow(camera_orientation[1],2))) * 180.0f / M_PI;
-    float camera_azimuth = -atan2(camera_orientation[1], camera_orientation[0]) * 180.0f / M_PI + 90.0f;
-    float relative_elev = -atan2(pos[2] - camera_pos[2], sqrt(pow(pos[0] - camera_pos[0],2) + pow(pos[1] - camera_pos[1],2))) * 180.0f / M_PI;
-    float relative_azimuth = -atan2(pos[1] - camera_pos[1], pos[0] - camera_pos[0]) * 180.0f / M_PI + 90.0f;
-    
-    float az_for_screen = relative_azimuth + camera_azimuth;
-    if (az_for_screen > 180.0f)  az_for_screen -= 360.0f;
-    if (az_for_screen < -180.0f) az_for_screen += 360.0f;
-    if (fabsf(camera_azimuth) > 90.0f) {
-        // Use shortest signed angle between point and camera heading
-        float dYaw = relative_azimuth + camera_azimuth;
-        // wrap to [-180, 180]
-        while (dYaw > 180.0f)  dYaw -= 360.0f;
-        while (dYaw < -180.0f) dYaw += 360.0f;
-        az_for_screen = dYaw;  // only in the >±90° case
-    }
-    float el_for_screen = relative_elev + camara_elev;
-    if (fabsf(camera_azimuth) > 90.0f) {
-        // Use shortest signed pitch difference to avoid flip when heading past ±90°
-        float dPit = relative_elev - camara_elev;
-        while (dPit > 180.0f)  dPit -= 360.0f;
-        while (dPit < -180.0f) dPit += 360.0f;
-        el_for_screen = dPit;
-    }
-
-
-    float screenX = width / 2.0f + (az_for_screen) / scene->get_camera()->fov_width_deg * width / 1000.0f;
-    float screenY = height / 2.0f + (relative_elev + camara_elev) / scene->get_camera()->fov_height_deg * height / 1000.0f;
-
-    // Convert screen-space coordinates to NDC: 
-    // x_ndc = (screenX / width)*2 - 1, y_ndc = 1 - (screenY / height)*2
-    float ndcX = (screenX / width) * 2.0f - 1.0f;
-    float ndcY = 1.0f - (screenY / height) * 2.0f;
-    
-    return {ndcX, ndcY}; 
-}
-
-
-
 void SimpleRenderer::resize(int newWidth, int newHeight) {
     width = newWidth;
     height = newHeight;
     // Update the viewport to the new window size.
-    glViewport(0, 0, width, height);
+    GLState::global().viewport(0, 0, width, height);
+    if (target) target->resize(width, height, resolution->get_settings().max_scale);
 }
 
 int SimpleRenderer::getWindowWidth() {
@@ -424,7 +611,11 @@ int SimpleRenderer::getWindowHeight() {
 }
 
 SimpleRenderer::~SimpleRenderer() {
-    glDeleteProgram(shaderProgram);
-    glDeleteBuffers(1, &VBO);
-    glDeleteVertexArrays(1, &VAO);
+    GLState::global().delete_program(shaderProgram);
+    stats.reset();
+    pixelView.reset();
+    target.reset();
+    batcher.reset();
+    stream.reset();
+    GLState::global().release();
 }
@@ -15,6 +15,16 @@
 #include "camera/camera.h"
 #include <unordered_map>
 #include "scene/scene.h"
+#include "renderer/stream_buffer.h"
+#include "renderer/draw_batcher.h"
+#include "renderer/render_list.h"
+#include "scene/scene_snapshot.h"
+#include "renderer/projection_cache.h"
+#include "renderer/render_stats.h"
+#include "renderer/render_target.h"
+#include "renderer/resolution_controller.h"
+#include "renderer/pixel_view.h"
+#include "renderer/occlusion_culler.h"
 using ObjSP   = std::shared_ptr<Object>;
 using ObjVec  = std::vector<ObjSP>;
 using ObjVecP = std::shared_ptr<ObjVec>;
@@ -30,33 +40,62 @@ public:
 
     
     // Render function that now uses OpenGL for accelerated rendering
+    // (capture + build + submit on the calling thread, same as pipeline depth 1)
     void render();
+    // CPU half of a frame: projects the snapshot into list. Thread safe unless in_place,
+    // which writes straight into the stream buffer and must run on the GL thread.
+    void build_render_list(const SceneSnapshot& snap, RenderList& list, bool in_place);
+    // GL half of a frame, GL thread only.
+    void submit(RenderList& list);
     void resize(int newWidth, int newHeight);
     int getWindowWidth();
     int getWindowHeight();
+    // Per frame CPU counters and GPU pass timings, GL thread only.
+    RenderStats& get_stats() { return *stats; }
+    // Draws into an offscreen target whose size follows the GPU frame time within the
+    // settings' bounds, upscaled to the window at the end of submit(). GL thread only.
+    void enable_dynamic_resolution(const ResolutionSettings& settings);
+    // Culls hidden meshes, point blocks and cloud pages against a CPU depth buffer of the
+    // largest occluders in build_render_list, see OcclusionCuller. verify: accuracy statistics.
+    void enable_occlusion_culling(bool verify);
+    float get_render_scale() const { return resolution ? resolution->get_scale() : 1.0f; }
+    // Shows a CPU side pixel buffer as the background from the next submit() on, see
+    // PixelView. Only the frame's dirty rectangles are uploaded. GL thread only.
+    void set_pixel_frame(const PixelFrame& frame);
+    void clear_pixel_frame();
 
-    // Legacy SDL renderer and texture (if you still need them)
-    SDL_Renderer* renderer;
-    SDL_Texture* texture;
-    std::vector<uint32_t> buffer;
     int width, height;
     std::shared_ptr<Scene> scene;
     
 private:
-bool is_point_in_frame(const std::vector<float> point, const std::vector<float> camera_pos, const std::vector<float> camera_orientation);
-void hand_data_to_shader(std::vector<float> triangleData,    std::vector<float> pointData);
-void hand_data_to_shader(std::vector<float> triangleData,
-                                   std::vector<float> pointData,
-                                   const IdMap& idMap);
-    std::array<float, 2> project(std::vector<float> pos,
-                                 std::vector<float> camera_orientation,
-                                 std::vector<float> camera_pos);
+bool is_point_in_frame(const float point[3], const CameraState& camera);
+void reserve_vertices(RenderList& list, size_t count, bool in_place);
+VertexWriter make_writer(RenderList& list, size_t first);
+void hand_data_to_shader(const RenderList& list);
     
 
     // OpenGL-specific members for hardware-accelerated rendering
     GLuint shaderProgram = 0;
-    GLuint VAO = 0;
-    GLuint VBO = 0;
+    std::unique_ptr<StreamBuffer> stream; // per-frame vertices, written in place
+    std::unique_ptr<DrawBatcher> batcher; // indexed mesh draws grouped by material
+    std::unique_ptr<RenderStats> stats;
+    std::unique_ptr<RenderTarget> target;              // only with dynamic resolution
+    std::unique_ptr<ResolutionController> resolution;
+    std::unique_ptr<PixelView> pixelView;              // created on the first pixel frame
+    std::unique_ptr<OcclusionCuller> occlusion;        // only with occlusion culling, used by the build
+    size_t pixelBytesPending = 0;                      // uploaded since the last submit
+    uint64_t externalPixelFrame = UINT64_MAX;          // ingest frame shown by pixelView
+    uint64_t lastControlledFrame = UINT64_MAX;         // frame whose GPU time was fed last
+    GLint tintLocation = -1;
+    SceneSnapshot frameSnapshot;  // reused by render()
+    std::vector<std::array<float,2>> projected; // per item NDC, scratch of build_render_list (one build at a time)
+    ProjectionCache projectionCache;
+    std::vector<uint8_t> clipCodes;     // per item clip outcode, scratch like projected
+    std::vector<uint8_t> meshNeedsClip; // per mesh range
+    RenderList frameList;
+
+    static constexpr size_t VERTEX_STRIDE = 5 * sizeof(float); // x, y, r, g, b
+    static constexpr int CIRCLE_SEGMENTS = 32;
 
     // Helper to compile and link shaders
     GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource);
@@ -0,0 +1,59 @@
+#include "resolution_controller.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double SMOOTHING = 0.2;       // weight of the newest frame
+constexpr double UPPER = 1.0;           // scale down above budget * UPPER ...
+constexpr double LOWER = 0.7;           // ... up below budget * LOWER
+constexpr int DOWN_FRAMES = 4;
+constexpr int UP_FRAMES = 30;
+constexpr int COOLDOWN_FRAMES = 8;      // GPU times arrive a few frames late
+constexpr float STEP = 1.0f / 32.0f;    // scales are quantized to this
+}
+
+ResolutionController::ResolutionController(const ResolutionSettings& s)
+    : settings(s)
+{
+    settings.min_scale = std::clamp(settings.min_scale, 0.1f, 2.0f);
+    settings.max_scale = std::clamp(settings.max_scale, settings.min_scale, 2.0f);
+    scale = settings.max_scale;
+}
+
+void ResolutionController::set_scale(float next)
+{
+    next = std::round(next / STEP) * STEP;
+    next = std::clamp(next, settings.min_scale, settings.max_scale);
+    if (next == scale) return;
+    scale = next;
+    over_frames = under_frames = 0;
+    cooldown = COOLDOWN_FRAMES;
+    smoothed_ms = 0.0; // old samples were taken at another scale
+}
+
+float ResolutionController::update(double frame_ms)
+{
+    smoothed_ms = smoothed_ms == 0.0 ? frame_ms : smoothed_ms * (1.0 - SMOOTHING) + frame_ms * SMOOTHING;
+    if (cooldown > 0) {
+        cooldown--;
+        return scale;
+    }
+    if (smoothed_ms > settings.budget_ms * UPPER) {
+        under_frames = 0;
+        if (++over_frames >= DOWN_FRAMES) {
+            // Aim a bit below the budget, at most 25% per axis at once
+            float factor = (float)std::sqrt(settings.budget_ms * 0.9 / smoothed_ms);
+            set_scale(scale * std::clamp(factor, 0.75f, 1.0f - STEP));
+        }
+    } else if (smoothed_ms < settings.budget_ms * LOWER) {
+        over_frames = 0;
+        if (++under_frames >= UP_FRAMES) {
+            float factor = (float)std::sqrt(settings.budget_ms * 0.85 / std::max(smoothed_ms, 0.01));
+            set_scale(scale * std::clamp(factor, 1.0f + STEP, 1.1f));
+            under_frames = 0;
+        }
+    } else {
+        over_frames = under_frames = 0;
+    }
+    return scale;
+}
@@ -0,0 +1,37 @@
+#ifndef RESOLUTION_CONTROLLER_H
+#define RESOLUTION_CONTROLLER_H
+
+// Bounds and budget of dynamic resolution scaling.
+struct ResolutionSettings {
+    float min_scale = 0.5f;     // fraction of the window size per axis
+    float max_scale = 1.0f;
+    double budget_ms = 12.0;    // GPU time per frame the controller aims for
+};
+
+// Picks the render scale from measured GPU frame times. Fill cost grows with the pixel count,
+// i.e. with scale^2, so steps are sized by sqrt(budget / time). Hysteresis against
+// oscillation: the time is smoothed, scaling down needs a few frames over budget, scaling up
+// many frames well below it (a dead band between), and after every change the controller
+// waits until frames rendered at the new scale have been measured.
+// Plain arithmetic, no GL, so any backend (GL target, CPU raster) can use it.
+class ResolutionController {
+public:
+    explicit ResolutionController(const ResolutionSettings& settings);
+
+    // Feeds the GPU time of one finished frame, returns the scale for the next one.
+    float update(double frame_ms);
+    float get_scale() const { return scale; }
+    const ResolutionSettings& get_settings() const { return settings; }
+
+private:
+    void set_scale(float next);
+
+    ResolutionSettings settings;
+    float scale;
+    double smoothed_ms = 0.0;
+    int over_frames = 0;
+    int under_frames = 0;
+    int cooldown = 0;
+};
+
+#endif // RESOLUTION_CONTROLLER_H
@@ -0,0 +1,123 @@
+#include "stream_buffer.h"
+#include "renderer/gl_state.h"
+#include <iostream>
+#include <stdexcept>
+
+StreamBuffer::StreamBuffer(GLenum target, size_t region_bytes, int region_count)
+    : target(target), region_count(region_count < 1 ? 1 : region_count)
+{
+    // Mesa (llvmpipe included) and all desktop drivers since GL 4.4 expose buffer storage.
+    persistent = GLEW_ARB_buffer_storage || GLEW_VERSION_4_4;
+    fences.assign(this->region_count, nullptr);
+    create_storage(region_bytes);
+    std::cout << "Stream buffer: " << this->region_count << " x " << region_size << " bytes, "
+              << (persistent ? "persistent mapping" : "orphaning fallback") << std::endl;
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    destroy_storage();
+}
+
+void StreamBuffer::create_storage(size_t region_bytes)
+{
+    region_size = region_bytes;
+    size_t total = region_size * region_count;
+    GLState& gl = GLState::global();
+    glGenBuffers(1, &buffer);
+    gl.bind_buffer(target, buffer);
+    if (persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, total, nullptr, flags);
+        mapped = static_cast<uint8_t*>(glMapBufferRange(target, 0, total, flags));
+        if (!mapped) {
+            // Driver refused the mapping, drop to the copy path instead of failing.
+            std::cerr << "Persistent mapping failed, using orphaning fallback" << std::endl;
+            gl.delete_buffer(buffer);
+            glGenBuffers(1, &buffer);
+            gl.bind_buffer(target, buffer);
+            persistent = false;
+        }
+    }
+    if (!persistent) {
+        glBufferData(target, total, nullptr, GL_STREAM_DRAW);
+        staging.resize(total);
+        mapped = staging.data();
+    }
+}
+
+void StreamBuffer::destroy_storage()
+{
+    for (int i = 0; i < region_count; ++i) wait_for_region(i);
+    if (buffer) {
+        if (persistent) {
+            GLState::global().bind_buffer(target, buffer);
+            glUnmapBuffer(target);
+        }
+        GLState::global().delete_buffer(buffer);
+        buffer = 0;
+    }
+    mapped = nullptr;
+}
+
+void StreamBuffer::wait_for_region(int region)
+{
+    GLsync& fence = fences[region];
+    if (!fence) return;
+    // Flush on the first wait so the fence is guaranteed to signal, then spin with a 1ms timeout.
+    // Only a timeout waits again; anything else (signaled, failed, or 0 without a current
+    // context) ends the wait instead of spinning for ever.
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    GLenum res;
+    while ((res = glClientWaitSync(fence, flags, 1000000)) == GL_TIMEOUT_EXPIRED) flags = 0;
+    if (res != GL_ALREADY_SIGNALED && res != GL_CONDITION_SATISFIED)
+        std::cerr << "glClientWaitSync failed on stream buffer region " << region << std::endl;
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamBuffer::begin_frame(size_t required_bytes)
+{
+    current_region = (current_region + 1) % region_count;
+    head = 0;
+    if (required_bytes > region_size) {
+        // Grow by 1.5x over the request so a slowly growing scene does not reallocate every frame.
+        size_t grown = required_bytes + required_bytes / 2;
+        destroy_storage();
+        create_storage(grown);
+        current_region = 0;
+        std::cout << "Stream buffer grown to " << region_count << " x " << region_size << " bytes" << std::endl;
+        return;
+    }
+    wait_for_region(current_region);
+}
+
+void* StreamBuffer::allocate(size_t bytes, size_t alignment, size_t& offset)
+{
+    size_t base = region_size * current_region;
+    size_t start = base + head;
+    if (alignment > 1) start = (start + alignment - 1) / alignment * alignment;
+    if (start + bytes > base + region_size) {
+        throw std::runtime_error("Stream buffer region overflow: begin_frame() was called with too small a size");
+    }
+    head = start + bytes - base;
+    offset = start;
+    return mapped + start;
+}
+
+void StreamBuffer::flush()
+{
+    if (persistent || head == 0) return;
+    size_t base = region_size * current_region;
+    GLState::global().bind_buffer(target, buffer);
+    // Orphan the old storage so the driver does not have to wait for pending draws.
+    glBufferData(target, region_size * region_count, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(target, base, head, staging.data() + base);
+}
+
+void StreamBuffer::end_frame()
+{
+    if (!persistent) return;
+    if (fences[current_region]) glDeleteSync(fences[current_region]);
+    fences[current_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,66 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ring buffer for per-frame vertex streaming.
+// The GL buffer is split into region_count regions, one per frame in flight. When
+// ARB_buffer_storage is available the whole buffer is mapped once (persistent + coherent)
+// and producers write straight into GPU visible memory; a fence per region keeps the CPU
+// from overwriting data the GPU is still reading. Without buffer storage the writes go
+// to a CPU staging copy that flush() uploads with buffer orphaning.
+class StreamBuffer {
+public:
+    StreamBuffer(GLenum target, size_t region_bytes, int region_count = 3);
+    ~StreamBuffer();
+
+    // Waits until the next region is no longer used by the GPU and makes it current.
+    // Grows the buffer if a frame needs more than one region can hold.
+    void begin_frame(size_t required_bytes);
+    // Reserves bytes in the current region. Returns the write pointer and stores the byte
+    // offset (relative to the start of the GL buffer) in offset. offset is a multiple of alignment.
+    void* allocate(size_t bytes, size_t alignment, size_t& offset);
+    // Makes the written data visible to GL, must be called before drawing from the buffer.
+    void flush();
+    // Fences the current region, call after the last draw that reads from it.
+    void end_frame();
+
+    GLuint get_buffer() const { return buffer; }
+    bool is_persistent() const { return persistent; }
+    size_t get_region_size() const { return region_size; }
+
+private:
+    void create_storage(size_t region_bytes);
+    void destroy_storage();
+    void wait_for_region(int region);
+
+    GLenum target;
+    GLuint buffer = 0;
+    int region_count;
+    size_t region_size = 0;
+    int current_region = 0;
+    size_t head = 0;          // bytes used in the current region
+    bool persistent = false;
+    uint8_t* mapped = nullptr;
+    std::vector<uint8_t> staging;   // fallback path only
+    std::vector<GLsync> fences;
+};
+
+// Small helper for producers writing interleaved position/color vertices.
+struct VertexWriter {
+    float* cursor = nullptr;
+    float* begin = nullptr;
+    size_t first = 0;   // index of the first vertex inside the GL buffer
+
+    void push(float x, float y, float r, float g, float b) {
+        cursor[0] = x; cursor[1] = y; cursor[2] = r; cursor[3] = g; cursor[4] = b;
+        cursor += 5;
+    }
+    size_t count() const { return (cursor - begin) / 5; }
+};
+
+#endif // STREAM_BUFFER_H
@@ -0,0 +1,58 @@
+#include "asset_load.h"
+#include "io/file_reader.h"
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+AssetLoad::AssetLoad(std::string filename_obj, std::string filename_mtl, std::string name)
+    : filename_obj(std::move(filename_obj)), filename_mtl(std::move(filename_mtl)), name(std::move(name))
+{
+    future = promise.get_future().share();
+}
+
+float AssetLoad::get_progress() const {
+    size_t total = total_vertices.load(std::memory_order_acquire);
+    if (get_status() == DONE) return 1.0f;
+    return total ? (float)published_vertices.load(std::memory_order_relaxed) / total : 0.0f;
+}
+
+std::string AssetLoad::get_error() const {
+    return get_status() == FAILED ? error : std::string();
+}
+
+void AssetLoad::parse() {
+    status.store(PARSING, std::memory_order_release);
+    try {
+        // Both files in one batch
+        std::vector<std::string> paths = {std::filesystem::absolute(filename_obj).string(),
+                                          std::filesystem::absolute(filename_mtl).string()};
+        FileReader reader(1 << 20, 8);
+        std::vector<FileReader::FileResult> results;
+        std::vector<std::string> texts = reader.read_all(paths, &results);
+        for (size_t i = 0; i < paths.size(); ++i) {
+            if (!results[i].ok) throw std::runtime_error("Failed to read " + paths[i] + ": " + results[i].error);
+            if (texts[i].empty()) throw std::runtime_error(paths[i] + " is empty");
+        }
+        const std::string& objText = texts[0];
+        const std::string& mtlText = texts[1];
+        mesh = objmini::LoadOBJFromStrings(objText, mtlText);
+        indices = std::make_shared<const std::vector<uint32_t>>(std::move(mesh.indices));
+        total_vertices.store(mesh.vertices.size(), std::memory_order_release);
+        std::cout << "Mesh " << name << " parsed: " << mesh.vertices.size() << " vertices, " << indices->size() / 3
+                  << " triangles, " << mesh.submeshes.size() << " submeshes" << std::endl;
+        status.store(PUBLISHING, std::memory_order_release);
+    } catch (const std::exception& e) {
+        finish(false, e.what());
+    }
+}
+
+void AssetLoad::finish(bool ok, const std::string& message) {
+    if (!ok) {
+        error = message;
+        std::cerr << "Loading " << filename_obj << " failed: " << message << std::endl;
+    }
+    // The parsed copy is no longer needed, the scene owns the published objects
+    mesh = objmini::Mesh();
+    status.store(ok ? DONE : FAILED, std::memory_order_release);
+    promise.set_value(ok);
+}
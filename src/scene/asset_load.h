@@ -0,0 +1,58 @@
+#ifndef ASSET_LOAD_H
+#define ASSET_LOAD_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include "object_loader/object_loader.h"
+
+class Object;
+
+// Handle of a mesh loaded by Scene::load_object_async. The files are read and parsed by a
+// job; afterwards the scene publishes the vertices in chunks while capturing frames, so the
+// mesh appears progressively. Triangles become visible as soon as all three corners are in.
+class AssetLoad {
+public:
+    enum Status { QUEUED, PARSING, PUBLISHING, DONE, FAILED };
+
+    AssetLoad(std::string filename_obj, std::string filename_mtl, std::string name);
+
+    Status get_status() const { return status.load(std::memory_order_acquire); }
+    bool is_finished() const { Status s = get_status(); return s == DONE || s == FAILED; }
+    // Published fraction of the vertices, 0 until parsed.
+    float get_progress() const;
+    // Reason of a FAILED load.
+    std::string get_error() const;
+    // Becomes ready with true once everything is published, false if the load failed.
+    // Do not wait on it from the thread that captures the scene, that thread publishes.
+    std::shared_future<bool> get_future() const { return future; }
+
+private:
+    friend class Scene;
+
+    // Reads and parses the files, runs on a job. Sets PUBLISHING or FAILED.
+    void parse();
+    void finish(bool ok, const std::string& message = std::string());
+
+    std::string filename_obj, filename_mtl, name;
+    std::atomic<Status> status{QUEUED};
+    std::string error;                            // written before status becomes FAILED
+    std::promise<bool> promise;
+    std::shared_future<bool> future;
+
+    // Written by parse(), read by the publishing scene once status is PUBLISHING
+    objmini::Mesh mesh;
+    std::shared_ptr<const std::vector<uint32_t>> indices;
+    std::atomic<size_t> total_vertices{0};
+
+    // Publishing state, scene thread only
+    std::shared_ptr<Object> root;
+    size_t mesh_index = 0;
+    std::atomic<size_t> published_vertices{0};
+    size_t published_indices = 0;
+};
+
+#endif // ASSET_LOAD_H
@@ -0,0 +1,117 @@
+#include "object_list.h"
+
+// Both walks use an explicit stack, loaded scenes can be deep
+
+void ObjectList::attach(Object* root)
+{
+    version++;
+    std::vector<Object*> stack{root};
+    while (!stack.empty()) {
+        Object* obj = stack.back();
+        stack.pop_back();
+        if (obj->list == this) continue;
+        obj->list = this;
+        obj->list_slot = (uint32_t)flat.size();
+        flat.push_back(obj);
+        by_id[obj->id] = obj;
+        if (!obj->children->empty()) add_group(obj);
+        if (obj->body_type != BODY_STATIC && !obj->sleeping) add_active(obj);
+        for (const auto& ch : *obj->children) stack.push_back(ch.get());
+    }
+}
+
+void ObjectList::detach(Object* root)
+{
+    version++;
+    std::vector<Object*> stack{root};
+    while (!stack.empty()) {
+        Object* obj = stack.back();
+        stack.pop_back();
+        if (obj->list != this) continue;
+        Object* last = flat.back();
+        flat[obj->list_slot] = last;
+        last->list_slot = obj->list_slot;
+        flat.pop_back();
+        by_id.erase(obj->id);
+        if (obj->group_slot >= 0) remove_group(obj);
+        if (obj->active_slot >= 0) remove_active(obj);
+        obj->list = nullptr;
+        for (const auto& ch : *obj->children) stack.push_back(ch.get());
+    }
+}
+
+void ObjectList::child_added(Object* parent, Object* child)
+{
+    if (parent->group_slot < 0) add_group(parent);
+    attach(child);
+}
+
+void ObjectList::child_removed(Object* parent, Object* child)
+{
+    detach(child);
+    // Called before the child leaves the child list
+    if (parent->children->size() == 1 && parent->group_slot >= 0) remove_group(parent);
+}
+
+void ObjectList::body_changed(Object* obj)
+{
+    bool wanted = obj->body_type != BODY_STATIC && !obj->sleeping;
+    if (wanted && obj->active_slot < 0) add_active(obj);
+    else if (!wanted && obj->active_slot >= 0) remove_active(obj);
+}
+
+void ObjectList::add_group(Object* obj)
+{
+    obj->group_slot = (int32_t)groups.size();
+    groups.push_back(obj);
+}
+
+void ObjectList::remove_group(Object* obj)
+{
+    Object* last = groups.back();
+    groups[obj->group_slot] = last;
+    last->group_slot = obj->group_slot;
+    groups.pop_back();
+    obj->group_slot = -1;
+}
+
+void ObjectList::add_active(Object* obj)
+{
+    obj->active_slot = (int32_t)active.size();
+    active.push_back(obj);
+}
+
+void ObjectList::remove_active(Object* obj)
+{
+    Object* last = active.back();
+    active[obj->active_slot] = last;
+    last->active_slot = obj->active_slot;
+    active.pop_back();
+    obj->active_slot = -1;
+}
+
+void ObjectList::clear()
+{
+    version++;
+    for (Object* obj : flat) {
+        obj->list = nullptr;
+        obj->group_slot = -1;
+        obj->active_slot = -1;
+    }
+    flat.clear();
+    groups.clear();
+    active.clear();
+    by_id.clear();
+}
+
+int64_t ObjectList::position_of(int id) const
+{
+    auto it = by_id.find(id);
+    return it == by_id.end() ? -1 : it->second->list_slot;
+}
+
+Object* ObjectList::find(int id) const
+{
+    auto it = by_id.find(id);
+    return it == by_id.end() ? nullptr : it->second;
+}
@@ -0,0 +1,58 @@
+#ifndef OBJECT_LIST_H
+#define OBJECT_LIST_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "shapes/object.h"
+
+// Flattened object tree of a scene: every attached object and its descendants, by raw
+// pointer. The tree keeps ownership, the list only follows it: Object::add_child and
+// remove_child on an attached object attach/detach the subtree, so a structural change
+// costs the size of that subtree and never the size of the scene. Removal moves the last
+// entry into the hole, so the order is stable except for that one entry.
+// Attached objects that have children are also kept in groups, the objects whose world
+// transform the capture needs. Mesh roots are not attached, their vertices are read from
+// the child list directly. Non-static bodies that are not sleeping are also kept in the
+// active set, the objects the physics step visits. Scene thread only.
+class ObjectList {
+public:
+    ObjectList() = default;
+    ObjectList(const ObjectList&) = delete;
+    ObjectList& operator=(const ObjectList&) = delete;
+    ~ObjectList() { clear(); }
+
+    void attach(Object* root);
+    void detach(Object* root);
+    void clear();
+    // Called by Object::add_child/remove_child of an attached parent.
+    void child_added(Object* parent, Object* child);
+    void child_removed(Object* parent, Object* child);
+    // Called when obj's body type or sleep state changed, adds or removes it from the active set.
+    void body_changed(Object* obj);
+
+    const std::vector<Object*>& get() const { return flat; }
+    size_t size() const { return flat.size(); }
+    const std::vector<Object*>& get_groups() const { return groups; }
+    const std::vector<Object*>& get_active() const { return active; }
+    // Bumped by every attach/detach/clear.
+    uint64_t get_version() const { return version; }
+    // Position in get() of the object with that id, -1 if it is not in the list.
+    int64_t position_of(int id) const;
+    // nullptr if it is not in the list.
+    Object* find(int id) const;
+
+private:
+    void add_group(Object* obj);
+    void remove_group(Object* obj);
+    void add_active(Object* obj);
+    void remove_active(Object* obj);
+
+    std::vector<Object*> flat;
+    std::vector<Object*> groups;
+    std::vector<Object*> active;
+    std::unordered_map<int, Object*> by_id;
+    uint64_t version = 0;
+};
+
+#endif // OBJECT_LIST_H
@@ -12,33 +12,101 @@
 #include "object_loader/object_loader.h"
 #include <filesystem>
 #include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <chrono>
 
 void Scene::set_camera_position(std::vector<float> pos, std::vector<float> orientation) {
-        camera->pos = pos;
+        camera->set_pos(pos);
         if(!orientation.empty())
-            camera->orientation = orientation;
+            camera->set_orientation(orientation);
     }
 
     std::shared_ptr<std::vector<std::shared_ptr<Object>>> Scene::get_objects() { return objects; }
     std::shared_ptr<std::vector<std::array<int,3>>> Scene::get_index_buffer() { return index_buffer; }
+    std::shared_ptr<std::vector<SceneMesh>> Scene::get_meshes() { return meshes; }
     std::shared_ptr<Camera> Scene::get_camera() { return camera; }
 
+// All three counters only grow, so their sum changes iff one of them did
+uint64_t Scene::get_version() const {
+    uint64_t version = Object::get_change_count() + Camera::get_latest_version() + content_version.load();
+    // New frames of an external producer count as changes too
+    std::shared_ptr<ShmRing> ring = std::atomic_load(&ingest);
+    if (ring) version += ring->get_header().latest.load(std::memory_order_acquire);
+    std::shared_ptr<PagedPointCloud> pc = std::atomic_load(&cloud);
+    if (pc) version += pc->get_loaded_count();
+    version += particle_steps.load();
+    return version;
+}
+
+void Scene::set_ingest(const std::string& name) {
+    ingest_name = name;
+    next_ingest_attempt_ns = 0;
+}
+
 
     
-Scene::Scene(/* args */)
+Scene::Scene(const std::string& scene_file)
 {
     objects = std::make_shared<std::vector<std::shared_ptr<Object>>>();
     index_buffer = std::make_shared<std::vector<std::array<int,3>>>();
-    // Populate the scene with objects and indices
-    populate_scene(objects, index_buffer);
-    // Create shapes (your current objects)
+    meshes = std::make_shared<std::vector<SceneMesh>>();
     camera = std::make_shared<Camera>(std::vector<float>{0, 0, 0},
                                                std::vector<float>{0, 100, 0},
                                                 40);
+    // Populate the scene with objects and indices
+    if (scene_file.empty()) {
+        populate_scene(objects, index_buffer);
+        rebuild_object_list();
+    }
+    else load(scene_file);
+}
+
+void Scene::rebuild_object_list() {
+    object_list.clear();
+    for (const auto& root : *objects) {
+        bool is_mesh = std::any_of(meshes->begin(), meshes->end(),
+                                   [&](const SceneMesh& m) { return m.root == root; });
+        if (!is_mesh) object_list.attach(root.get());
+    }
+    content_version++;
+}
+
+void Scene::insert_object(std::shared_ptr<Object> obj) {
+    object_list.attach(obj.get());
+    objects->push_back(std::move(obj));
+    content_version++;
+}
+
+bool Scene::remove_object(const std::shared_ptr<Object>& obj) {
+    auto it = std::find(objects->begin(), objects->end(), obj);
+    if (it == objects->end()) return false;
+    auto mesh = std::find_if(meshes->begin(), meshes->end(), [&](const SceneMesh& m) { return m.root == obj; });
+    if (mesh != meshes->end()) {
+        std::lock_guard<std::mutex> lock(loads_mutex);
+        for (const auto& l : loads) {
+            if (l->root == obj && !l->is_finished()) return false;
+        }
+        // Copy-on-write like publishing, snapshots in flight keep the old list
+        auto next = std::make_shared<std::vector<SceneMesh>>(*meshes);
+        next->erase(next->begin() + (mesh - meshes->begin()));
+        meshes = next;
+    }
+    object_list.detach(obj.get());
+    objects->erase(it);
+    content_version++;
+    return true;
 }
 
 Scene::~Scene()
 {
+    // Loader jobs reference the scene
+    std::vector<JobSystem::JobHandle> jobs;
+    {
+        std::lock_guard<std::mutex> lock(loads_mutex);
+        jobs.swap(load_jobs);
+    }
+    for (const auto& job : jobs) JobSystem::global().wait(job);
 }
 
 
@@ -51,21 +119,36 @@ void Scene::populate_scene(std::shared_ptr<std::vector<std::shared_ptr<Object>>>
         //objects->push_back(std::shared_ptr<Object>(new Triangle({100, 50,0},{0,0,0},{1,1,1}, 60, 0, 0, 255)));
         // Red rectangle
         objects->push_back(std::shared_ptr<Object>(new Rect({100, 100,0},{0,0,0},{1,1,1}, 50, 50, 255, 0, 0))); // Red Rect
-        // Add a vertex that comes from straight ahead
-        for (float i = -5; i <= 5; i++) {
-            for (float j = -5; j <= 5; j++) {
-                objects->push_back(std::make_shared<Vertex>(std::vector<float>{i, 80, j}, std::vector<float>{0,0,0}, std::vector<float>{1,1,1},
-                                               (int)(255 - i) % 255,
-                                               (int)(255 + j) % 255,
-                                               (int)(255 + i - j) % 255,"moving_over")); // Yellow vertex
-            }
-        }//*/
-        // Add a vertex that tiles the floor
+        // Both drift diagonally for ever, everything else is static
+        for (const auto& shape : *objects) {
+            shape->set_body_type(BODY_KINEMATIC);
+            shape->set_velocity(100, 100, 0);
+        }
+        // Small blue triangle on the rectangle's path: asleep after half a second, woken and
+        // pushed along when the rectangle runs into it, asleep again once damping stopped it
+        auto pushed = std::make_shared<Triangle>(std::vector<float>{300, 300, 0}, std::vector<float>{0,0,0},
+                                                 std::vector<float>{1,1,1}, 15, 0, 0, 255);
+        pushed->set_body_type(BODY_DYNAMIC);
+        objects->push_back(pushed);
+        // Points that come from straight ahead: a stream falling from y=100 over x, z in [-5, 5]
+        EmitterDesc stream;
+        stream.origin[1] = 100.0f;
+        stream.extent[0] = 5.0f;
+        stream.extent[2] = 5.0f;
+        stream.velocity[1] = -20.0f;
+        stream.lifetime = 5.0f;             // gone where it reaches y=0
+        stream.rate = 121.0f;
+        stream.max_particles = 1024;
+        const uint8_t a[3] = {255, 250, 0}, b[3] = {0, 250, 255};
+        std::copy(a, a + 3, stream.color_a);
+        std::copy(b, b + 3, stream.color_b);
+        particles.add_emitter(stream);
+        // Add a vertex that tiles the floor, positioned relative to the floor
       std::shared_ptr<Object> floor = std::make_shared<Object>(Object({0, 0, -2}, {0, 0, 0}, {1, 1, 1}, 255, 255, 0, "floor"));
         objects->push_back(floor);
         for (float i = -10; i <= 10; i+=0.1) {            
             for (float j = -10; j <= 10; j+=0.1) {
-                 std::shared_ptr<Object> vx = std::make_shared<Vertex>(std::vector<float>{i, j, -2}, std::vector<float>{0,0,0}, std::vector<float>{1,1,1},
+                 std::shared_ptr<Object> vx = std::make_shared<Vertex>(std::vector<float>{i, j, 0}, std::vector<float>{0,0,0}, std::vector<float>{1,1,1},
                                                (int)(255 - i) % 255,
                                                (int)(255 + j) % 255,
                                                (int)(255 + i - j) % 255,"floor"); // Yellow vertex
@@ -74,87 +157,288 @@ void Scene::populate_scene(std::shared_ptr<std::vector<std::shared_ptr<Object>>>
         }
         std::cout << "Floor initialized" << std::endl;
 
-        
-        index_buffer.get()->push_back(std::array<int,3>{{3, 10, 87}});//*/
 
-        add_object("external/newell_teaset/spoon.obj", "external/newell_teaset/spoon.mtl");
+        // Triangle ahead of the camera, where the first wave of points used to start
+        std::array<int,3> corners;
+        const float corner_pos[3][3] = {{-5, 80, -4}, {-5, 80, 3}, {2, 80, 3}};
+        for (int k = 0; k < 3; ++k) {
+            auto corner = std::make_shared<Vertex>(std::vector<float>(corner_pos[k], corner_pos[k] + 3), std::vector<float>{0,0,0},
+                                                   std::vector<float>{1,1,1}, 255, 255, 255, "triangle_corner");
+            objects->push_back(corner);
+            corners[k] = corner->id;
+        }
+        index_buffer.get()->push_back(corners);
+
+        // Streamed in while the first frames are already drawn
+        load_object_async("external/newell_teaset/spoon.obj", "external/newell_teaset/spoon.mtl");
 
 }
+// Vertices created per step; each is a heap allocated Vertex, ~1k take well under a millisecond
+static const size_t PUBLISH_CHUNK = 1024;
+
+static std::string asset_name(const std::string& filename_obj) {
+    return std::filesystem::path(filename_obj).stem().string();
+}
+
 void Scene::add_object(std::string filename_obj, std::string filename_mtl) {
-    // Load the OBJ and MTL files
-        std::cout << "Loading OBJ and MTL files..." << std::endl;
-        std::string objText;
-        std::string mtlText;
-            try
-        {
-            //load string from file
-            //create absolute path
-            std::string absolute_path_spoon = std::filesystem::absolute(filename_obj).string();
-            std::string absolute_path_mtl = std::filesystem::absolute(filename_mtl).string();
-            std::cout << "Absolute path to spoon.obj: " << absolute_path_spoon << std::endl;
-            std::ifstream objFile(absolute_path_spoon);
-            std::ifstream mtlFile(absolute_path_mtl);
-            if (!objFile || !mtlFile) {
-                throw std::runtime_error("Failed to open OBJ/MTL file");
+    AssetLoad load(filename_obj, filename_mtl, asset_name(filename_obj));
+    load.parse();
+    while (load.get_status() == AssetLoad::PUBLISHING) publish_chunk(load, load.total_vertices);
+}
+
+std::shared_ptr<AssetLoad> Scene::load_object_async(std::string filename_obj, std::string filename_mtl) {
+    auto load = std::make_shared<AssetLoad>(filename_obj, filename_mtl, asset_name(filename_obj));
+    std::lock_guard<std::mutex> lock(loads_mutex);
+    loads.push_back(load);
+    // The version bump makes an idle on-change loop draw, and capture() then publishes
+    load_jobs.push_back(JobSystem::global().run("asset_load", [this, load] {
+        load->parse();
+        content_version++;
+    }));
+    return load;
+}
+
+void Scene::finish_loads() {
+    std::vector<JobSystem::JobHandle> jobs;
+    {
+        std::lock_guard<std::mutex> lock(loads_mutex);
+        jobs = load_jobs;
+    }
+    for (const auto& job : jobs) JobSystem::global().wait(job);
+    std::vector<std::shared_ptr<AssetLoad>> pending;
+    {
+        std::lock_guard<std::mutex> lock(loads_mutex);
+        pending = loads;
+    }
+    for (const auto& load : pending) {
+        while (load->get_status() == AssetLoad::PUBLISHING) publish_chunk(*load, load->total_vertices);
+    }
+}
+
+void Scene::publish_chunk(AssetLoad& load, size_t max_vertices) {
+    const objmini::Mesh& parsed = load.mesh;
+    if (!load.root) {
+        load.root = std::make_shared<Object>(
+            std::vector<float>{0, 0, 0}, // Position
+            std::vector<float>{0, 0, 0}, // Orientation
+            std::vector<float>{1, 1, 1}, // Scale
+            255, 255, 255, // Color (white)
+            load.name);
+        SceneMesh mesh;
+        mesh.root = load.root;
+        mesh.indices = load.indices;
+        mesh.materials = parsed.materials;
+        auto next = std::make_shared<std::vector<SceneMesh>>(*meshes);
+        next->push_back(std::move(mesh));
+        load.mesh_index = next->size() - 1;
+        meshes = next;
+        objects->push_back(load.root); // not in object_list, captured as a mesh
+    }
+
+    size_t begin = load.published_vertices, end = std::min(parsed.vertices.size(), begin + max_vertices);
+    for (size_t i = begin; i < end; ++i) {
+        const objmini::Vertex& vertex = parsed.vertices[i];
+        load.root->add_child(std::make_shared<Vertex>(
+            std::vector<float>{vertex.pos.x, vertex.pos.y, vertex.pos.z},
+            std::vector<float>{0, 0, 0}, // Orientation
+            std::vector<float>{1, 1, 1}, // Scale
+            static_cast<uint8_t>(vertex.u * 255), // Color R
+            static_cast<uint8_t>(vertex.v * 255), // Color G
+            static_cast<uint8_t>(vertex.norm.x * 255), // Color B
+            load.name + "_vertex"));
+    }
+    load.published_vertices = end;
+
+    // The loader numbers welded vertices in order of first use, so the triangles whose
+    // corners exist are (nearly all of) a prefix of the index list
+    const std::vector<uint32_t>& indices = *load.indices;
+    size_t count = load.published_indices;
+    while (count + 2 < indices.size() && indices[count] < end && indices[count + 1] < end && indices[count + 2] < end) count += 3;
+    load.published_indices = count;
+
+    // Copy-on-write with the submesh ranges cut to the published prefix
+    auto next = std::make_shared<std::vector<SceneMesh>>(*meshes);
+    std::vector<objmini::Submesh>& submeshes = (*next)[load.mesh_index].submeshes;
+    submeshes.clear();
+    for (const auto& sm : parsed.submeshes) {
+        if (sm.indexOffset >= count) break;
+        submeshes.push_back(sm);
+        submeshes.back().indexCount = std::min<uint32_t>(sm.indexCount, (uint32_t)(count - sm.indexOffset));
+    }
+    meshes = next;
+    content_version++;
+
+    if (end == parsed.vertices.size()) {
+        std::cout << "Mesh " << load.name << " published: " << end << " vertices, " << count / 3 << " triangles" << std::endl;
+        load.finish(true);
+    }
+}
+
+void Scene::set_point_cloud(const std::string& path, size_t cache_bytes) {
+    std::lock_guard<std::mutex> lock(loads_mutex);
+    load_jobs.push_back(JobSystem::global().run("point_cloud_open", [this, path, cache_bytes] {
+        try {
+            std::string pages = path;
+            if (!pointcloud::is_page_file(path)) {
+                pages = path + ".vbdpc";
+                if (!pointcloud::is_page_file(pages)) pointcloud::import_point_cloud(path, pages);
             }
-             objText=std::string((std::istreambuf_iterator<char>(objFile)), std::istreambuf_iterator<char>());
-             mtlText=std::string((std::istreambuf_iterator<char>(mtlFile)), std::istreambuf_iterator<char>());
+            std::atomic_store(&cloud, std::make_shared<PagedPointCloud>(pages, cache_bytes));
+            content_version++;
+        } catch (const std::exception& e) {
+            std::cerr << "Point cloud " << path << ": " << e.what() << std::endl;
+        }
+    }));
+}
 
+void Scene::publish_assets() {
+    std::vector<std::shared_ptr<AssetLoad>> ready;
+    {
+        std::lock_guard<std::mutex> lock(loads_mutex);
+        if (loads.empty()) return;
+        loads.erase(std::remove_if(loads.begin(), loads.end(),
+                                   [](const std::shared_ptr<AssetLoad>& l) { return l->is_finished(); }),
+                    loads.end());
+        for (const auto& l : loads) {
+            if (l->get_status() == AssetLoad::PUBLISHING) ready.push_back(l);
         }
-        catch(const std::exception& e)
-        {
-            std::cerr << e.what() << '\n';
+    }
+    // At least one chunk per frame, so a tiny budget still makes progress
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& load : ready) {
+        while (load->get_status() == AssetLoad::PUBLISHING) {
+            publish_chunk(*load, PUBLISH_CHUNK);
+            std::chrono::duration<double, std::milli> spent = std::chrono::steady_clock::now() - start;
+            if (spent.count() >= publish_budget_ms) return;
         }
-        if(objText.empty() || mtlText.empty()) {
-            std::cerr << "Error: OBJ or MTL file is empty." << std::endl;
-            return;
+    }
+}
+
+static void capture_item(Object* obj, SnapshotItem& item) {
+    item.id = obj->id;
+    item.type = obj->get_shape_type();
+    const std::vector<float>& pos = obj->get_coords();
+    const Object* parent = obj->get_parent();
+    if (parent) {
+        // Parent world transforms are up to date, see capture()
+        const float local[3] = {pos[0], pos[1], pos[2]};
+        parent->get_world_transform().apply(local, item.pos);
+        item.parent_version = parent->get_world_version();
+    } else {
+        item.pos[0] = pos[0]; item.pos[1] = pos[1]; item.pos[2] = pos[2];
+        item.parent_version = 0;
+    }
+    item.generation = obj->get_generation();
+    std::array<uint8_t,3> c = obj->get_color();
+    item.color[0] = c[0]; item.color[1] = c[1]; item.color[2] = c[2];
+    item.size[0] = item.size[1] = 0.0f;
+    switch (item.type) {
+        case RECTANGLE: {
+            auto rect = static_cast<Rect*>(obj);
+            item.size[0] = rect->get_width();
+            item.size[1] = rect->get_height();
+            break;
         }
-        std::cout << "OBJ and MTL files loaded" << std::endl;
-        try
-        {
-           std::pair<std::vector<objmini::Vertex>, std::vector<uint32_t>> result;
-
-            result=objmini::BuildVerticesAndIndices(objText, mtlText);
-           Object spoon(
-                std::vector<float>{0, 0, 0}, // Position
-                std::vector<float>{0, 0, 0}, // Orientation
-                std::vector<float>{1, 1, 1}, // Scale
-                255, 255, 255, // Color (white)
-                "spoon" // Name
-            );
-            int first_index = -1;
-            for (const auto& vertex : result.first) {
-                // Create a Vertex object for each vertex in the spoon model
-                std::shared_ptr<Vertex> v = std::make_shared<Vertex>(
-                    std::vector<float>{vertex.pos.x, vertex.pos.y, vertex.pos.z},
-                    std::vector<float>{0, 0, 0}, // Orientation
-                    std::vector<float>{1, 1, 1}, // Scale
-                    static_cast<uint8_t>(vertex.u * 255), // Color R
-                    static_cast<uint8_t>(vertex.v * 255), // Color G
-                    static_cast<uint8_t>(vertex.norm.x * 255), // Color B
-                    "spoon_vertex"
-                );
-                if(first_index == -1) {
-                    first_index = v.get()->id; // Store the ID of the first vertex
-                }
-                v.get()->id;
-                spoon.add_child(v);
-            }
-            for (size_t i = 0; i < result.second.size(); i += 3) {
-                // Create an index triplet for the spoon model
-                std::array<int, 3> index_triplet = {
-                    first_index + result.second[i],
-                    first_index + result.second[i + 1],
-                    first_index + result.second[i + 2]
-                };
-                if(i%100 == 0) std::cout << "Adding index triplet: " << index_triplet[0] << ", " << index_triplet[1] << ", " << index_triplet[2] << std::endl;
-
-                index_buffer->push_back(index_triplet);
+        case CIRCLE: item.size[0] = static_cast<Circle*>(obj)->get_radius(); break;
+        case TRIANGLE: item.size[0] = static_cast<Triangle*>(obj)->get_size(); break;
+        default: break;
+    }
+}
+
+void Scene::capture(SceneSnapshot& out, int width, int height) {
+    out.width = width;
+    out.height = height;
+    out.camera.pos = camera->pos;
+    out.camera.orientation = camera->orientation;
+    out.camera.fov_width_deg = camera->fov_width_deg;
+    out.camera.fov_height_deg = camera->fov_height_deg;
+    out.camera.version = camera->version;
+    publish_assets();
+    out.meshes = meshes;
+    out.cloud_pages.clear();
+    out.cloud_bounds.clear();
+    std::shared_ptr<PagedPointCloud> pc = std::atomic_load(&cloud);
+    if (pc) pc->update(out.camera, out.cloud_pages, out.cloud_bounds);
+    out.particles.clear();
+    particles.capture(out.particles);
+    out.external = shm::FrameView();
+    out.external_ring = nullptr;
+    if (!ingest_name.empty()) {
+        std::shared_ptr<ShmRing> ring = std::atomic_load(&ingest);
+        uint64_t now = ShmRing::now_ns();
+        if (!ring && now >= next_ingest_attempt_ns) {
+            next_ingest_attempt_ns = now + 1000000000ull; // producer not there yet, retry every second
+            ring = ShmRing::open(ingest_name);
+            if (ring) {
+                std::cout << "Ingest ring " << ingest_name << " opened: " << ring->get_slot_count() << " slots of "
+                          << ring->get_slot_bytes() << " bytes" << std::endl;
+                std::atomic_store(&ingest, ring);
             }
-        objects->push_back(std::make_shared<Object>(spoon));
         }
-        catch(const std::exception& e)
-        {
-            std::cerr << e.what() << '\n';
+        if (ring && ring->acquire(out.external)) out.external_ring = ring;
+    }
+    out.items.clear();
+    out.mesh_ranges.clear();
+    out.indexed.clear();
+
+    // Only parents need a world transform, moving one cost nothing until now. The children
+    // are then transformed in bulk below, each reading its parent's cached transform.
+    for (Object* group : object_list.get_groups()) group->update_world_transform();
+    for (const auto& mesh : *meshes) mesh.root->update_world_transform();
+
+    // The flattened list first, then the mesh vertices so each mesh is one contiguous range.
+    // Item i < object_list.size() is object_list.get()[i].
+    const std::vector<Object*>& flat = object_list.get();
+    size_t mesh_vertices = 0;
+    for (const auto& mesh : *meshes) mesh_vertices += mesh.root->get_children()->size();
+    out.items.resize(flat.size() + mesh_vertices);
+    JobSystem::global().parallel_for("scene_capture", 0, flat.size(), [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) capture_item(flat[i], out.items[i]);
+    }, 4096);
+    size_t next = flat.size();
+    for (size_t i = 0; i < meshes->size(); ++i) {
+        const auto& children = *(*meshes)[i].root->get_children();
+        out.mesh_ranges.push_back({i, next, children.size()});
+        JobSystem::global().parallel_for("scene_capture", 0, children.size(), [&](size_t b, size_t e) {
+            for (size_t k = b; k < e; ++k) capture_item(children[k].get(), out.items[next + k]);
+        }, 4096);
+        next += children.size();
+    }
+
+    out.max_id = -1;
+    for (const auto& item : out.items) out.max_id = std::max(out.max_id, item.id);
+
+    auto lookup = [&](int id) -> uint32_t {
+        int64_t pos = object_list.position_of(id);
+        if (pos < 0)
+            throw std::runtime_error("Object not found for given index: " + std::to_string(id));
+        return (uint32_t)pos;
+    };
+    out.indexed.reserve(index_buffer->size());
+    for (const auto& idx : *index_buffer) {
+        out.indexed.push_back({lookup(idx[0]), lookup(idx[1]), lookup(idx[2])});
+    }
+
+    out.structure_version = content_version.load() + object_list.get_version();
+    out.motion_version = Object::get_change_count();
+    PickResult pick;
+    if (picker.update(out, pick)) {
+        selection = pick;
+        if (pick.hit) {
+            std::cout << "Picked object " << pick.object_id << " (vertex " << pick.vertex_id << ") at distance "
+                      << pick.distance << std::endl;
+        } else {
+            std::cout << "Nothing picked" << std::endl;
         }
-}
\ No newline at end of file
+    }
+}
+
+void Scene::update_particles(float dt) {
+    if (particles.get_emitter_count() == 0) return;
+    particles.update(dt);
+    if (particles.get_live_count() > 0) particle_steps.fetch_add(1);
+}
+
+void Scene::request_pick(float ndc_x, float ndc_y) {
+    picker.request(ndc_x, ndc_y);
+}
@@ -15,28 +15,109 @@
 #include "shapes/rectangle.h"
 #include <filesystem>
 #include "object_loader/object_loader.h"
+#include "scene/scene_snapshot.h"
+#include "scene/asset_load.h"
+#include "jobs/job_system.h"
+#include "pointcloud/paged_point_cloud.h"
+#include "scene/object_list.h"
+#include "picking/picker.h"
+#include "particles/particle_system.h"
+#include <mutex>
 #ifndef SCENE_H
 #define SCENE_H
 
+// Indexed mesh loaded from a file. The root object holds one Vertex child per mesh vertex,
+// indices and submesh ranges refer to the position in that child list. While a mesh is
+// still being published the submeshes only cover triangles whose vertices already exist.
+struct SceneMesh {
+    std::shared_ptr<Object> root;
+    std::shared_ptr<const std::vector<uint32_t>> indices; // complete from the start, shared by all copies
+    std::vector<objmini::Submesh> submeshes;
+    std::vector<objmini::Material> materials;
+};
+
 class Scene
 {
 private:
     friend class PhysicsEngine; // Allow SimpleRenderer to access private members
     std::shared_ptr<std::vector<std::shared_ptr<Object>>> objects;
+    ObjectList object_list; // flattened non-mesh objects, declared after objects so it goes first
     std::shared_ptr<std::vector<std::array<int,3>>> index_buffer;
+    std::shared_ptr<std::vector<SceneMesh>> meshes; // replaced, never modified in place, snapshots keep old lists alive
     //camera
     std::shared_ptr<Camera> camera;
+    std::atomic<uint64_t> content_version{0}; // bumped when objects or meshes are added
+    std::string ingest_name;
+    std::shared_ptr<ShmRing> ingest;          // atomic_load/atomic_store, get_version reads it from other threads
+    uint64_t next_ingest_attempt_ns = 0;
+    std::mutex loads_mutex;
+    std::vector<std::shared_ptr<AssetLoad>> loads;     // not yet completely published
+    std::vector<JobSystem::JobHandle> load_jobs;       // waited for by the destructor
+    double publish_budget_ms = 2.0;
+    std::shared_ptr<PagedPointCloud> cloud;   // atomic_load/atomic_store, set by a job
+    Picker picker;
+    PickResult selection;
+    ParticleSystem particles;
+    std::atomic<uint64_t> particle_steps{0};  // updates with live particles, part of get_version
     void set_camera_position(std::vector<float> pos, std::vector<float> orientation={}) ;
+    // Publishes parsed loads until the frame's budget is used up, called by capture().
+    void publish_assets();
+    // Adds up to max_vertices more vertices of load and the triangles they complete.
+    void publish_chunk(AssetLoad& load, size_t max_vertices);
+    // Lists all top level objects except mesh roots again, after objects was replaced wholesale.
+    void rebuild_object_list();
 
 public:
-    Scene(/* args */);
+    // Empty scene_file: the built in demo scene, otherwise the scene saved in that file.
+    explicit Scene(const std::string& scene_file = std::string());
     ~Scene();
     void populate_scene(std::shared_ptr<std::vector<std::shared_ptr<Object>>> objects,std::shared_ptr<std::vector<std::array<int,3>>> index_buffer);
+    // Loads a mesh and adds it before returning. Blocks for as long as parsing takes.
     void add_object(std::string filename_obj = "external/newell_teaset/spoon.obj", 
                     std::string filename_mtl = "external/newell_teaset/spoon.mtl");
+    // Parses the files on the job system and returns immediately. The parsed mesh is then
+    // added over the following frames, at most the publish budget per capture().
+    std::shared_ptr<AssetLoad> load_object_async(std::string filename_obj, std::string filename_mtl);
+    void set_publish_budget_ms(double ms) { publish_budget_ms = ms; }
+    // Waits for all loads started so far and publishes them completely, so a run starts from
+    // the same scene however long loading took (input replay). Scene thread.
+    void finish_loads();
+    // Shows a point cloud of any size through a cache of cache_bytes. PLY/XYZ input is first
+    // converted into a page file next to it (path + ".vbdpc", reused later); that and opening
+    // run on the job system, the cloud appears when ready.
+    void set_point_cloud(const std::string& path, size_t cache_bytes);
+    // Binary scene file with the object tree, index buffer, meshes and camera (scene_file.h).
+    // Both must run on the thread that mutates the scene; meshes still loading are saved as
+    // far as they are published. Throw std::runtime_error on failure.
+    void save(const std::string& path);
+    void load(const std::string& path);
+    // Top level objects. Add and remove them through insert_object/remove_object so the
+    // flattened list follows, and children through Object::add_child/remove_child.
     std::shared_ptr<std::vector<std::shared_ptr<Object>>> get_objects() ;
+    void insert_object(std::shared_ptr<Object> obj);
+    // False if obj is not a top level object or the mesh it is the root of is still loading.
+    // Remove triangles of the index buffer that use it first.
+    bool remove_object(const std::shared_ptr<Object>& obj);
+    const ObjectList& get_object_list() const { return object_list; }
     std::shared_ptr<std::vector<std::array<int,3>>> get_index_buffer() ;
+    std::shared_ptr<std::vector<SceneMesh>> get_meshes() ;
+    // Copies the flattened object list into out for the render stages. Must run on the thread that mutates the scene.
+    void capture(SceneSnapshot& out, int width, int height);
     std::shared_ptr<Camera> get_camera() ;
+    // Changes whenever something that is drawn may have changed: object moves, camera moves,
+    // loaded assets. Thread safe, used to skip redraws of an unchanged scene.
+    uint64_t get_version() const;
+    // Selects the object under the given point of the view (NDC, y up) once a later capture()
+    // has the picking trees for the current scene; get_selection() then returns it.
+    void request_pick(float ndc_x, float ndc_y);
+    const PickResult& get_selection() const { return selection; }
+    // Shows frames of the shared memory ring name (see ingest/shm_ring.h). The ring is
+    // (re)opened by capture(), so the producer may start later.
+    void set_ingest(const std::string& name);
+    // Particle effects, see particles/particle_system.h. Add emitters and update them on the
+    // thread that mutates the scene; capture() hands the newest frames to the renderer.
+    ParticleSystem& get_particles() { return particles; }
+    void update_particles(float dt);
 };
 
 #endif // SCENE_H
\ No newline at end of file
@@ -0,0 +1,308 @@
+// Scene::save and Scene::load, the file layout is described in scene_file.h.
+#include "scene.h"
+#include "scene_file.h"
+#include "io/file_reader.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace scenefile;
+
+namespace {
+struct Writer {
+    std::FILE* file;
+    uint64_t offset = 0;
+    bool ok = true;
+
+    void write(const void* data, size_t bytes) {
+        if (bytes == 0) return;
+        ok = ok && std::fwrite(data, 1, bytes, file) == bytes;
+        offset += bytes;
+    }
+    template <typename T> void write_array(const std::vector<T>& v) { write(v.data(), v.size() * sizeof(T)); }
+};
+
+// Bounds checked reads from the loaded file
+struct Reader {
+    const std::string& data;
+    uint64_t offset;
+
+    uint64_t remaining() const { return offset > data.size() ? 0 : data.size() - offset; }
+    void read(void* out, size_t bytes) {
+        if (bytes > remaining()) throw std::runtime_error("scene file is truncated");
+        std::memcpy(out, data.data() + offset, bytes);
+        offset += bytes;
+    }
+    // Checked before allocating, a corrupt count must not turn into a huge allocation
+    template <typename T> void read_array(std::vector<T>& v, uint64_t count) {
+        if (count > remaining() / sizeof(T)) throw std::runtime_error("scene file is truncated");
+        v.resize(count);
+        read(v.data(), count * sizeof(T));
+    }
+};
+
+void vec3(const std::vector<float>& v, float out[3]) {
+    for (int k = 0; k < 3; ++k) out[k] = k < (int)v.size() ? v[k] : 0.0f;
+}
+
+std::shared_ptr<Object> make_object(const ObjectRecord& r, const std::string& name) {
+    std::vector<float> pos(r.pos, r.pos + 3), orientation(r.orientation, r.orientation + 3), scale(r.scale, r.scale + 3);
+    switch (r.kind) {
+        case KIND_VERTEX: return std::make_shared<Vertex>(std::move(pos), std::move(orientation), std::move(scale), r.color[0], r.color[1], r.color[2], name);
+        case KIND_CIRCLE: return std::make_shared<Circle>(std::move(pos), std::move(orientation), std::move(scale), r.size[0], r.color[0], r.color[1], r.color[2], name);
+        case KIND_RECTANGLE: return std::make_shared<Rect>(std::move(pos), std::move(orientation), std::move(scale), r.size[0], r.size[1], r.color[0], r.color[1], r.color[2], name);
+        case KIND_TRIANGLE: return std::make_shared<Triangle>(std::move(pos), std::move(orientation), std::move(scale), r.size[0], r.color[0], r.color[1], r.color[2], name);
+        default: return std::make_shared<Object>(std::move(pos), std::move(orientation), std::move(scale), r.color[0], r.color[1], r.color[2], name);
+    }
+}
+}
+
+void Scene::save(const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ObjectRecord> records;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> name_index;
+    std::vector<uint32_t> record_of_id;   // object ids are small dense integers
+    auto intern = [&](const std::string& name) {
+        auto it = name_index.emplace(name, (uint32_t)names.size());
+        if (it.second) names.push_back(name);
+        return it.first->second;
+    };
+
+    // Pre-order, so the loader can attach every object to an already created parent
+    std::vector<std::pair<Object*, uint32_t>> stack;
+    for (auto it = objects->rbegin(); it != objects->rend(); ++it) stack.push_back({it->get(), NO_PARENT});
+    while (!stack.empty()) {
+        Object* obj = stack.back().first;
+        uint32_t parent = stack.back().second;
+        stack.pop_back();
+        ObjectRecord r{};
+        r.parent = parent;
+        r.name = intern(obj->get_name());
+        std::array<uint8_t,3> c = obj->get_color();
+        r.color[0] = c[0]; r.color[1] = c[1]; r.color[2] = c[2];
+        vec3(obj->get_coords(), r.pos);
+        vec3(obj->get_orientation(), r.orientation);
+        vec3(obj->get_scale(), r.scale);
+        r.body = obj->get_body_type();
+        for (int k = 0; k < 3; ++k) r.velocity[k] = obj->get_velocity()[k];
+        switch (obj->get_shape_type()) {
+            case VERTEX: r.kind = KIND_VERTEX; break;
+            case CIRCLE:
+                r.kind = KIND_CIRCLE;
+                r.size[0] = static_cast<Circle*>(obj)->get_radius();
+                break;
+            case RECTANGLE:
+                r.kind = KIND_RECTANGLE;
+                r.size[0] = static_cast<Rect*>(obj)->get_width();
+                r.size[1] = static_cast<Rect*>(obj)->get_height();
+                break;
+            case TRIANGLE:
+                r.kind = KIND_TRIANGLE;
+                r.size[0] = static_cast<Triangle*>(obj)->get_size();
+                break;
+            default: r.kind = KIND_OBJECT; break;
+        }
+        uint32_t self = (uint32_t)records.size();
+        records.push_back(r);
+        if (obj->id >= (int)record_of_id.size()) record_of_id.resize(obj->id + 1, NO_PARENT);
+        record_of_id[obj->id] = self;
+        const auto& children = *obj->get_children();
+        for (auto it = children.rbegin(); it != children.rend(); ++it) stack.push_back({it->get(), self});
+    }
+
+    std::vector<uint32_t> triangles;
+    triangles.reserve(index_buffer->size() * 3);
+    for (const auto& idx : *index_buffer) {
+        for (int id : idx) {
+            if (id < 0 || id >= (int)record_of_id.size() || record_of_id[id] == NO_PARENT)
+                throw std::runtime_error("Index buffer references unknown object " + std::to_string(id));
+            triangles.push_back(record_of_id[id]);
+        }
+    }
+    for (const auto& mesh : *meshes) {
+        for (const auto& mat : mesh.materials) intern(mat.name);
+    }
+
+    std::string temp = path + ".tmp";
+    Writer w{std::fopen(temp.c_str(), "wb")};
+    if (!w.file) throw std::runtime_error("Cannot create " + temp);
+    SceneFileHeader header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.object_count = records.size();
+    header.triangle_count = index_buffer->size();
+    header.mesh_count = meshes->size();
+    header.name_count = names.size();
+    vec3(camera->pos, header.camera_pos);
+    vec3(camera->orientation, header.camera_orientation);
+    header.camera_zoom = camera->zoom;
+    w.write(&header, sizeof(header));   // again at the end with the offsets
+
+    header.objects_offset = w.offset;
+    w.write_array(records);
+    header.indices_offset = w.offset;
+    w.write_array(triangles);
+    header.meshes_offset = w.offset;
+    for (const auto& mesh : *meshes) {
+        if (mesh.root->id >= (int)record_of_id.size() || record_of_id[mesh.root->id] == NO_PARENT)
+            throw std::runtime_error("Mesh root is not part of the scene");
+        MeshRecord m{};
+        m.root = record_of_id[mesh.root->id];
+        m.index_count = (uint32_t)mesh.indices->size();
+        m.submesh_count = (uint32_t)mesh.submeshes.size();
+        m.material_count = (uint32_t)mesh.materials.size();
+        w.write(&m, sizeof(m));
+        w.write_array(*mesh.indices);
+        for (const auto& sm : mesh.submeshes) {
+            SubmeshRecord s{sm.material, sm.indexOffset, sm.indexCount};
+            w.write(&s, sizeof(s));
+        }
+        for (const auto& mat : mesh.materials) {
+            MaterialRecord mr{name_index[mat.name], {mat.Ka.x, mat.Ka.y, mat.Ka.z}, {mat.Kd.x, mat.Kd.y, mat.Kd.z}, {mat.Ks.x, mat.Ks.y, mat.Ks.z}};
+            w.write(&mr, sizeof(mr));
+        }
+    }
+    header.names_offset = w.offset;
+    for (const auto& name : names) {
+        uint32_t length = (uint32_t)name.size();
+        w.write(&length, sizeof(length));
+        w.write(name.data(), length);
+    }
+    header.file_bytes = w.offset;
+    w.ok = w.ok && std::fseek(w.file, 0, SEEK_SET) == 0;
+    w.write(&header, sizeof(header));
+    w.ok = std::fclose(w.file) == 0 && w.ok;
+    std::error_code ec;
+    if (w.ok) std::filesystem::rename(temp, path, ec);
+    if (!w.ok || ec) {
+        std::remove(temp.c_str());
+        throw std::runtime_error("Writing " + path + " failed");
+    }
+    std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - start;
+    std::cout << "Scene saved to " << path << ": " << records.size() << " objects, " << (header.file_bytes >> 10)
+              << " KB in " << took.count() << " ms" << std::endl;
+}
+
+void Scene::load(const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+    FileReader reader(4 << 20, 16);
+    std::vector<FileReader::FileResult> results;
+    std::vector<std::string> files = reader.read_all({path}, &results);
+    if (!results[0].ok) throw std::runtime_error("Cannot read " + path + ": " + results[0].error);
+    const std::string& data = files[0];
+
+    Reader r{data, 0};
+    SceneFileHeader header;
+    r.read(&header, sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION) throw std::runtime_error(path + " is not a scene file");
+    if (header.file_bytes != data.size()) throw std::runtime_error(path + " is truncated");
+
+    // Bulk copies of the fixed size sections
+    std::vector<ObjectRecord> records;
+    std::vector<uint32_t> triangles;
+    r.offset = header.objects_offset;
+    r.read_array(records, header.object_count);
+    r.offset = header.indices_offset;
+    if (header.triangle_count > UINT64_MAX / 3) throw std::runtime_error("scene file is truncated");
+    r.read_array(triangles, header.triangle_count * 3);
+    r.offset = header.names_offset;
+    if (header.name_count > r.remaining() / sizeof(uint32_t)) throw std::runtime_error("scene file is truncated");
+    std::vector<std::string> names(header.name_count);
+    for (auto& name : names) {
+        uint32_t length;
+        r.read(&length, sizeof(length));
+        name.resize(length);
+        r.read(&name[0], length);
+    }
+    for (size_t i = 0; i < records.size(); ++i) {
+        const ObjectRecord& rec = records[i];
+        if ((rec.parent != NO_PARENT && rec.parent >= i) || rec.name >= names.size() || rec.body > BODY_DYNAMIC)
+            throw std::runtime_error(path + ": bad object record " + std::to_string(i));
+    }
+    for (uint32_t t : triangles) {
+        if (t >= records.size()) throw std::runtime_error(path + ": index buffer out of range");
+    }
+
+    // Creating the objects is the expensive part (a few allocations each), spread it out
+    std::vector<std::shared_ptr<Object>> created(records.size());
+    JobSystem::global().parallel_for("scene_load", 0, records.size(), [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            created[i] = make_object(records[i], names[records[i].name]);
+            // Not in a list yet, the list picks the body up when the objects are attached
+            created[i]->set_body_type((BodyType)records[i].body);
+            created[i]->set_velocity(records[i].velocity[0], records[i].velocity[1], records[i].velocity[2]);
+        }
+    }, 4096);
+
+    std::vector<uint32_t> child_count(records.size(), 0);
+    for (const auto& rec : records) {
+        if (rec.parent != NO_PARENT) child_count[rec.parent]++;
+    }
+    std::vector<std::shared_ptr<Object>> roots;
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (child_count[i]) created[i]->get_children()->reserve(child_count[i]);
+        if (records[i].parent == NO_PARENT) roots.push_back(created[i]);
+        else created[records[i].parent]->add_child(created[i]);
+    }
+
+    std::vector<std::array<int,3>> indices(header.triangle_count);
+    for (size_t t = 0; t < indices.size(); ++t) {
+        for (int k = 0; k < 3; ++k) indices[t][k] = created[triangles[3 * t + k]]->id;
+    }
+
+    auto loaded_meshes = std::make_shared<std::vector<SceneMesh>>();
+    r.offset = header.meshes_offset;
+    for (uint64_t m = 0; m < header.mesh_count; ++m) {
+        MeshRecord mr;
+        r.read(&mr, sizeof(mr));
+        if (mr.root >= records.size()) throw std::runtime_error(path + ": mesh root out of range");
+        if (records[mr.root].parent != NO_PARENT) throw std::runtime_error(path + ": mesh root is not a top level object");
+        SceneMesh mesh;
+        mesh.root = created[mr.root];
+        std::vector<uint32_t> mesh_indices;
+        r.read_array(mesh_indices, mr.index_count);
+        // Indices address the root's children, the renderer looks them up unchecked
+        size_t vertex_count = mesh.root->get_children()->size();
+        for (uint32_t index : mesh_indices) {
+            if (index >= vertex_count) throw std::runtime_error(path + ": mesh index out of range");
+        }
+        mesh.indices = std::make_shared<const std::vector<uint32_t>>(std::move(mesh_indices));
+        for (uint32_t s = 0; s < mr.submesh_count; ++s) {
+            SubmeshRecord sr;
+            r.read(&sr, sizeof(sr));
+            if ((uint64_t)sr.index_offset + sr.index_count > mr.index_count) throw std::runtime_error(path + ": submesh out of range");
+            if (sr.material < -1 || (sr.material >= 0 && (uint32_t)sr.material >= mr.material_count))
+                throw std::runtime_error(path + ": submesh material out of range");
+            mesh.submeshes.push_back({sr.material, sr.index_offset, sr.index_count});
+        }
+        for (uint32_t s = 0; s < mr.material_count; ++s) {
+            MaterialRecord mat;
+            r.read(&mat, sizeof(mat));
+            objmini::Material material;
+            material.name = mat.name < names.size() ? names[mat.name] : std::string();
+            material.Ka = {mat.ka[0], mat.ka[1], mat.ka[2]};
+            material.Kd = {mat.kd[0], mat.kd[1], mat.kd[2]};
+            material.Ks = {mat.ks[0], mat.ks[1], mat.ks[2]};
+            mesh.materials.push_back(material);
+        }
+        loaded_meshes->push_back(std::move(mesh));
+    }
+
+    // Swap the contents in, holders of the containers and the camera keep valid pointers
+    *objects = std::move(roots);
+    *index_buffer = std::move(indices);
+    meshes = loaded_meshes;
+    rebuild_object_list();
+    *camera = Camera(std::vector<float>(header.camera_pos, header.camera_pos + 3),
+                     std::vector<float>(header.camera_orientation, header.camera_orientation + 3), header.camera_zoom);
+    content_version++;
+
+    std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - start;
+    std::cout << "Scene loaded from " << path << ": " << records.size() << " objects, " << header.triangle_count
+              << " triangles, " << header.mesh_count << " meshes in " << took.count() << " ms" << std::endl;
+}
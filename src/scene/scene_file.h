@@ -0,0 +1,73 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <cstdint>
+
+// Binary scene file written by Scene::save and read by Scene::load (little endian):
+//   SceneFileHeader
+//   ObjectRecord[object_count]     pre-order: a parent always precedes its children
+//   uint32_t[3 * triangle_count]   index buffer, as object record numbers
+//   meshes: per mesh a MeshRecord, uint32_t indices[index_count], SubmeshRecord[submesh_count],
+//           MaterialRecord[material_count]
+//   names: per name a uint32_t length and the bytes (object and material names, deduplicated)
+// All sections are plain arrays, so loading is one read of the file and a pass over the
+// records; the objects are then created in parallel.
+namespace scenefile {
+
+constexpr uint32_t MAGIC = 0x53444256;   // "VBDS"
+constexpr uint32_t VERSION = 3;   // 2: positions relative to the parent, 3: physics bodies
+constexpr uint32_t NO_PARENT = 0xffffffffu;
+
+enum ObjectKind : uint8_t { KIND_OBJECT = 0, KIND_CIRCLE, KIND_RECTANGLE, KIND_TRIANGLE, KIND_VERTEX };
+
+struct SceneFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t object_count;
+    uint64_t triangle_count;
+    uint64_t mesh_count;
+    uint64_t name_count;
+    uint64_t objects_offset, indices_offset, meshes_offset, names_offset;
+    uint64_t file_bytes;
+    float camera_pos[3];
+    float camera_orientation[3];
+    float camera_zoom;
+    uint32_t reserved;
+};
+
+struct ObjectRecord {
+    uint32_t parent;          // record number or NO_PARENT for top level objects
+    uint32_t name;            // name number
+    uint8_t kind;
+    uint8_t color[3];
+    float pos[3];             // pos, orientation and scale relative to the parent
+    float orientation[3];
+    float scale[3];
+    float size[2];            // circle radius, rectangle width/height, triangle size
+    uint8_t body;             // BodyType, sleeping bodies are saved awake
+    uint8_t reserved[3];
+    float velocity[3];
+};
+static_assert(sizeof(ObjectRecord) == 72, "ObjectRecord is part of the file format");
+
+struct MeshRecord {
+    uint32_t root;            // record number of the mesh root object
+    uint32_t index_count;
+    uint32_t submesh_count;
+    uint32_t material_count;
+};
+
+struct SubmeshRecord {
+    int32_t material;
+    uint32_t index_offset;
+    uint32_t index_count;
+};
+
+struct MaterialRecord {
+    uint32_t name;
+    float ka[3], kd[3], ks[3];
+};
+
+} // namespace scenefile
+
+#endif // SCENE_FILE_H
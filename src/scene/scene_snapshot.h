@@ -0,0 +1,70 @@
+#ifndef SCENE_SNAPSHOT_H
+#define SCENE_SNAPSHOT_H
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstdint>
+#include "shapes/object.h"
+#include "ingest/shm_ring.h"
+
+struct SceneMesh;
+struct ParticleFrame;
+
+// Copy of the camera values the projection needs.
+struct CameraState {
+    std::vector<float> pos = {0, 0, 0};
+    std::vector<float> orientation = {0, 1, 0};
+    float fov_width_deg = 1.0f;
+    float fov_height_deg = 1.0f;
+    uint64_t version = 0;   // Camera::version when captured
+};
+
+// Axis aligned box in world space.
+struct WorldBounds {
+    float min[3], max[3];
+};
+
+// One flattened object, plain data so it can cross threads.
+struct SnapshotItem {
+    int id;
+    uint32_t generation;    // Object::get_generation(), changes when the object moved or was reparented
+    uint32_t parent_version;    // the parent's world version, 0 for top level objects
+    ShapeType type;
+    float pos[3];
+    uint8_t color[3];
+    float size[2]; // rect width/height, circle radius, triangle size
+};
+
+// Read-only view of the scene for one frame. It is filled by the simulation stage
+// (Scene::capture) and consumed by the render-list build stage, so the build never
+// touches the live object tree while the simulation is mutating it.
+struct SceneSnapshot {
+    struct MeshRange {
+        size_t mesh_index;
+        size_t first_item;   // mesh vertices are items [first_item, first_item + count)
+        size_t count;
+    };
+
+    uint64_t frame = 0;
+    uint64_t simulated_ns = 0;      // SDL_GetTicksNS() when the simulation step finished
+    uint64_t structure_version = 0; // changes when items or triangles were added or removed
+    uint64_t motion_version = 0;    // changes when any object moved (Object::get_change_count)
+    int width = 0, height = 0;      // viewport the frame is projected for
+    CameraState camera;
+    std::vector<SnapshotItem> items;
+    int max_id = -1;
+    std::vector<std::array<uint32_t,3>> indexed;   // index buffer resolved to item positions
+    std::vector<MeshRange> mesh_ranges;
+    std::shared_ptr<const std::vector<SceneMesh>> meshes;
+    // Newest frame of the shared memory ingest, payload still in the mapping
+    shm::FrameView external;
+    std::shared_ptr<ShmRing> external_ring;
+    // Resident pages of the paged point cloud that are in view
+    std::vector<std::shared_ptr<const std::vector<shm::PointRecord>>> cloud_pages;
+    std::vector<WorldBounds> cloud_bounds;   // of the grid cell of cloud_pages[i]
+    // Live particles, one frame per emitter, drawn as points
+    std::vector<std::shared_ptr<const ParticleFrame>> particles;
+};
+
+#endif // SCENE_SNAPSHOT_H
@@ -9,7 +9,7 @@ private:
     float radius;
 public:
     Circle(std::vector<float> pos,std::vector<float> orientation,std::vector<float> scale, float radius, uint8_t r, uint8_t g, uint8_t b, std::string name="Circle")
-        : Object(pos,orientation,scale, r, g, b,name), radius(radius) {shape_type=CIRCLE;}
+        : Object(std::move(pos),std::move(orientation),std::move(scale), r, g, b,std::move(name)), radius(radius) {shape_type=CIRCLE;}
 
         float get_radius() {
             return radius;
@@ -1,29 +1,118 @@
 #include   "object.h"
-int Object::next_id = 0;
+#include "scene/object_list.h"
+#include <algorithm>
+std::atomic<int> Object::next_id{0};
+std::atomic<uint64_t> Object::change_counter{0};
 
 Object::Object(std::vector<float> pos, std::vector<float> orientation, std::vector<float> scale, uint8_t r, uint8_t g, uint8_t b,std::string name)
-    : pos(pos), orientation(orientation), scale(scale), r(r), g(g), b(b), id(next_id++),name(name) {}
+    : pos(std::move(pos)), orientation(std::move(orientation)), scale(std::move(scale)), r(r), g(g), b(b), id(next_id++),name(std::move(name)) {}
+
+// Still listed only if the tree was changed behind the list's back, never leave it dangling
+Object::~Object() {
+    if (list) list->detach(this);
+    for (const auto& ch : *children) {
+        if (ch->parent == this) ch->parent = nullptr; // children kept alive elsewhere
+    }
+}
 
    void Object::move(float dx, float dy, float dz)  { 
         pos[0] += dx; 
         pos[1] += dy; 
         pos[2] += dz; 
+        if (sleeping) wake();
+        local_changed();
     } // Move shape in 3D space
 
     void Object::move_to(float x, float y, float z) { 
         pos[0] = x; 
         pos[1]= y; 
         pos[2]= z; 
+        if (sleeping) wake();
+        local_changed();
     } // Move shape in 3D space
-    std::vector<float> Object::get_coords() { 
+
+void Object::local_changed() {
+    generation++;
+    local_dirty = true;
+    change_counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Object::set_body_type(BodyType type) {
+    body_type = type;
+    sleeping = false;
+    rest_seconds = 0.0f;
+    if (list) list->body_changed(this);
+}
+
+void Object::set_velocity(float vx, float vy, float vz) {
+    velocity[0] = vx;
+    velocity[1] = vy;
+    velocity[2] = vz;
+    if (sleeping) wake();
+}
+
+void Object::wake() {
+    rest_seconds = 0.0f;
+    if (!sleeping) return;
+    sleeping = false;
+    if (list) list->body_changed(this);
+}
+
+void Object::set_orientation(float x, float y, float z) {
+    orientation = {x, y, z};
+    local_changed();
+}
+
+void Object::rotate(float dx, float dy, float dz) {
+    orientation[0] += dx;
+    orientation[1] += dy;
+    orientation[2] += dz;
+    local_changed();
+}
+
+void Object::set_scale(float x, float y, float z) {
+    scale = {x, y, z};
+    local_changed();
+}
+
+const Transform& Object::update_world_transform() {
+    uint32_t parent_version = 0;
+    if (parent) {
+        parent->update_world_transform();
+        parent_version = parent->world_version;
+    }
+    if (local_dirty || parent_version != world_parent_version) {
+        Transform local = Transform::from_trs(pos, orientation, scale);
+        world = parent ? parent->world * local : local;
+        world_parent_version = parent_version;
+        local_dirty = false;
+        world_version++;
+    }
+    return world;
+}
+    const std::vector<float>& Object::get_coords() const { 
         return pos; 
     }
     std::array<uint8_t,3> Object::get_color() { 
         return {r, g, b}; 
     }
     void Object::add_child(std::shared_ptr<Object> child) { 
+        child->parent = this;
+        child->local_changed(); // new parent, new world
         children->push_back(child); 
+        if (list) list->child_added(this, child.get());
+        change_counter.fetch_add(1, std::memory_order_relaxed);
     } // Add a child object
+    bool Object::remove_child(const std::shared_ptr<Object>& child) {
+        auto it = std::find(children->begin(), children->end(), child);
+        if (it == children->end()) return false;
+        if (list) list->child_removed(this, child.get());
+        child->parent = nullptr;
+        child->local_changed();
+        children->erase(it);
+        change_counter.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
     std::shared_ptr<std::vector<std::shared_ptr<Object>>> Object::get_children() { 
         return children; 
     } // Get children objects
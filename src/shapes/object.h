@@ -6,43 +6,110 @@
 #include <exception>
 #include <iostream>
 #include <memory>
+#include <atomic>
+#include <cstdint>
+#include "math/transform.h"
+
+class ObjectList;
 
 enum ShapeType {
+    GROUP = 0,      // plain Object, only positions its children
     CIRCLE = 1,
     RECTANGLE = 2,
     TRIANGLE = 3,
     VERTEX = 4
 };
 
+// How the physics step treats an object (BodySimulation::step).
+enum BodyType : uint8_t {
+    BODY_STATIC = 0,     // never moved by the simulation: floor, meshes, anything not tagged
+    BODY_KINEMATIC = 1,  // moves with its velocity every step, never sleeps
+    BODY_DYNAMIC = 2     // velocity slowed by damping, sleeps once it came to rest
+};
+
 class Object {
     private :
+    friend class ObjectList;
+    friend class BodySimulation;
     
     //generate a const id that is unique for each shape
-    static int next_id;
+    static std::atomic<int> next_id; // atomic, objects may be created by several jobs at once
+    static std::atomic<uint64_t> change_counter; // bumped by every move/move_to/add_child of any object
+    ObjectList* list = nullptr; // flattened list this object is in, see scene/object_list.h
+    uint32_t list_slot = 0;
+    int32_t group_slot = -1;    // position in the list's groups, -1 while it has no children
+    Object* parent = nullptr;   // set by add_child, the parent owns this object
+
+    // Simulation state. Non-static bodies that are awake are in the list's active set.
+    BodyType body_type = BODY_STATIC;
+    bool sleeping = false;
+    int32_t active_slot = -1;   // position in the list's active set, -1 if not in it
+    uint32_t sleep_stamp = 0;   // bumped when the body falls asleep, see BodySimulation
+    float velocity[3] = {0, 0, 0};  // units per second, local space
+    float rest_seconds = 0.0f;  // how long a dynamic body has been slower than the sleep speed
+
+    // World transform cache, refreshed lazily by update_world_transform
+    Transform world = Transform::identity();
+    uint32_t world_version = 0;         // bumped whenever world changed
+    uint32_t world_parent_version = 0;  // parent's world_version world was computed from
+    bool local_dirty = true;            // pos/orientation/scale changed since
+    void local_changed();
     
 protected:
     std::string name; // Name of the object for identification
-    ShapeType shape_type;
-    std::vector<float> pos; // Now includes z-index
+    ShapeType shape_type = GROUP;
+    std::vector<float> pos; // Now includes z-index, relative to the parent like orientation and scale
     std::vector<float> orientation;
     std::vector<float> scale;
     uint8_t r, g, b; // Color
+    uint32_t generation = 0; // bumped by every move and reparent, lets caches detect stale data
     std::shared_ptr<std::vector<std::shared_ptr<Object>>> children = std::make_shared<std::vector<std::shared_ptr<Object>>>(); // Children objects
 
 public:
     const int id;
     Object(std::vector<float> pos,std::vector<float> orientation,std::vector<float> scale,  uint8_t r, uint8_t g, uint8_t b, std::string name);
     ShapeType get_shape_type();
-    ~Object() {};
+    ~Object();
     void move(float dx, float dy, float dz);
     void move_to(float x, float y, float z);
+    // Radians about x, y, z (applied in that order). Only the children see orientation and
+    // scale, shapes are drawn at their world position with their own size.
+    void set_orientation(float x, float y, float z);
+    void rotate(float dx, float dy, float dz);
+    void set_scale(float x, float y, float z);
 
-    std::vector<float> get_coords() ;
+    const std::vector<float>& get_coords() const;
     std::array<uint8_t,3> get_color();
+    // Also attach/detach the child's subtree to/from the list this object is in. Change
+    // the tree through these, not through get_children(), once it is part of a scene.
     void add_child(std::shared_ptr<Object> child) ;
+    bool remove_child(const std::shared_ptr<Object>& child);
 
     std::shared_ptr<std::vector<std::shared_ptr<Object>>> get_children() ; 
+    bool has_children() const { return !children->empty(); }
+    Object* get_parent() const { return parent; }
+
+    // Moving a parent only marks it, the children are transformed when the scene is captured.
+    // Brings the cached world transform up to date (walking up the parents), not thread safe.
+    const Transform& update_world_transform();
+    // The cached value, valid after update_world_transform in the same frame.
+    const Transform& get_world_transform() const { return world; }
+    uint32_t get_world_version() const { return world_version; }
     std::string get_name() ;// Get the name of the object
+    const std::vector<float>& get_orientation() const { return orientation; }
+    const std::vector<float>& get_scale() const { return scale; }
+    uint32_t get_generation() const { return generation; }
+    // Compare two values to know whether any object changed in between, thread safe.
+    static uint64_t get_change_count() { return change_counter.load(std::memory_order_relaxed); }
+    // Physics body, see BodyType. Changing the type wakes the body.
+    void set_body_type(BodyType type);
+    BodyType get_body_type() const { return body_type; }
+    // Wakes a sleeping dynamic body.
+    void set_velocity(float vx, float vy, float vz);
+    const float* get_velocity() const { return velocity; }
+    // Puts a sleeping dynamic body back into the active set; moving it does the same.
+    void wake();
+    bool is_sleeping() const { return sleeping; }
     bool in_frame=true; // Flag to indicate if the object is in the frame
 
 };
@@ -9,7 +9,7 @@ private:
 
 public:
     Rect(std::vector<float> pos,std::vector<float> orientation,std::vector<float> scale, float width, float height, uint8_t r, uint8_t g, uint8_t b,std::string name="Rectangle")
-        : Object(pos,orientation,scale, r, g, b,name), width(width), height(height) {shape_type=RECTANGLE;}
+        : Object(std::move(pos),std::move(orientation),std::move(scale), r, g, b,std::move(name)), width(width), height(height) {shape_type=RECTANGLE;}
 
         float get_width() {
             return width;
@@ -9,7 +9,7 @@ class Vertex : public Object {
 
 public:
     Vertex(std::vector<float> pos,std::vector<float> orientation,std::vector<float> scale, uint8_t r, uint8_t g, uint8_t b,std::string name="Vertex")
-        : Object(pos,orientation,scale, r, g, b,name)  {shape_type=VERTEX;}
+        : Object(std::move(pos),std::move(orientation),std::move(scale), r, g, b,std::move(name))  {shape_type=VERTEX;}
 
 };
 
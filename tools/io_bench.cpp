@@ -0,0 +1,116 @@
+// Compares the file read paths (src/io/file_reader.h) on a set of files.
+//
+//   io_bench [--chunk KB] [--depth N] [--no-direct] [--drop-caches] PATH...
+//
+// PATH may be a file or a directory (all regular files below it). Each pass reads every file
+// completely: the old ifstream + istreambuf_iterator path, FileReader in blocking mode and
+// FileReader on io_uring. --drop-caches writes to /proc/sys/vm/drop_caches before every pass
+// (needs root) so all passes start from cold storage; otherwise the later passes may be
+// served from the page cache, except the O_DIRECT reads.
+#include "io/file_reader.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static void drop_caches() {
+    std::FILE* f = std::fopen("/proc/sys/vm/drop_caches", "w");
+    if (!f) {
+        std::printf("  (cannot drop caches, not root?)\n");
+        return;
+    }
+    std::fputs("3\n", f);
+    std::fclose(f);
+}
+
+struct Pass {
+    uint64_t bytes = 0;
+    uint64_t checksum = 0;
+    size_t failed = 0;
+};
+
+static void report(const char* name, const Pass& pass, double seconds) {
+    std::printf("%-34s %8.1f MB in %7.3f s  %8.1f MB/s  checksum %016llx%s\n", name, pass.bytes / 1.0e6, seconds,
+                pass.bytes / 1.0e6 / seconds, (unsigned long long)pass.checksum,
+                pass.failed ? "  (some files failed)" : "");
+}
+
+// Order independent, chunks arrive in any order
+static uint64_t sum_bytes(const uint8_t* data, size_t size) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; ++i) sum += data[i];
+    return sum;
+}
+
+int main(int argc, char* argv[]) {
+    size_t chunk_kb = 1024;
+    unsigned depth = 32;
+    bool direct = true, drop = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) chunk_kb = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc) depth = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--no-direct") == 0) direct = false;
+        else if (std::strcmp(argv[i], "--drop-caches") == 0) drop = true;
+        else if (argv[i][0] == '-') {
+            std::printf("usage: %s [--chunk KB] [--depth N] [--no-direct] [--drop-caches] PATH...\n", argv[0]);
+            return 1;
+        } else if (std::filesystem::is_directory(argv[i])) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(argv[i])) {
+                if (entry.is_regular_file()) files.push_back(entry.path().string());
+            }
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        std::printf("no files\n");
+        return 1;
+    }
+    std::printf("%zu files, chunk %zu KB, queue depth %u\n", files.size(), chunk_kb, depth);
+
+    using clock = std::chrono::steady_clock;
+    auto seconds_since = [](clock::time_point start) { return std::chrono::duration<double>(clock::now() - start).count(); };
+
+    {
+        if (drop) drop_caches();
+        Pass pass;
+        auto start = clock::now();
+        for (const auto& path : files) {
+            std::ifstream file(path);
+            if (!file) {
+                pass.failed++;
+                continue;
+            }
+            std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            pass.bytes += text.size();
+            pass.checksum += sum_bytes(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+        }
+        report("ifstream + istreambuf_iterator", pass, seconds_since(start));
+    }
+
+    for (FileReader::Backend backend : {FileReader::BLOCKING, FileReader::IO_URING}) {
+        if (drop) drop_caches();
+        FileReader reader(chunk_kb * 1024, depth, backend);
+        reader.set_direct(direct);
+        if (backend == FileReader::IO_URING && reader.get_backend() != FileReader::IO_URING) {
+            std::printf("io_uring not available, skipped\n");
+            continue;
+        }
+        Pass pass;
+        auto start = clock::now();
+        std::vector<FileReader::FileResult> results = reader.read(files, [&](size_t, uint64_t, const uint8_t* data, size_t size) {
+            pass.bytes += size;
+            pass.checksum += sum_bytes(data, size);
+        });
+        for (const auto& r : results) pass.failed += r.ok ? 0 : 1;
+        std::string name = std::string("FileReader ") + reader.get_backend_name();
+        report(name.c_str(), pass, seconds_since(start));
+    }
+    return 0;
+}
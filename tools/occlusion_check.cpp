@@ -0,0 +1,106 @@
+// Accuracy of the software occlusion culler (src/renderer/occlusion_culler.h), the
+// --occlusion-verify statistics on synthetic scenes.
+//
+//   occlusion_check [--points N]
+//
+// A camera 2 units above a floor of about N points (default 600k) in blocks of one culler
+// BLOCK each, looking along +y. Two occluders are tested in turn:
+//   table  a horizontal quad below eye level; its far edge bends away from the horizon in the
+//          angular projection, the floor right behind it is visible under the edge
+//   wall   a vertical quad standing on the floor
+// The table is also run cut into 8 x 8 tiles, whose shared edges must not open seams.
+// For each the culler runs with verification on and reports the culled blocks and the sampled
+// vertices. Fails (exit code 1) when a visible vertex was culled.
+#include "renderer/occlusion_culler.h"
+#include "renderer/clipper.h"
+#include "renderer/projection.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+static SnapshotItem make_item(int id, float x, float y, float z) {
+    SnapshotItem item = {};
+    item.id = id;
+    item.type = VERTEX;
+    item.pos[0] = x; item.pos[1] = y; item.pos[2] = z;
+    return item;
+}
+
+// Quad a b c d (in order around it) cut into cuts x cuts cells as the index buffer, floor points
+// after it
+static SceneSnapshot make_scene(const float quad[4][3], int cuts, size_t points) {
+    SceneSnapshot snap;
+    snap.structure_version = 1;
+    snap.motion_version = 1;
+    snap.camera.pos = {0, 0, 2};
+    snap.camera.orientation = {0, 1, 0};
+    snap.camera.fov_width_deg = 0.12f;   // +-60 degrees
+    snap.camera.fov_height_deg = 0.06f;  // +-30 degrees
+    for (int v = 0; v <= cuts; ++v) {
+        for (int u = 0; u <= cuts; ++u) {
+            float s = (float)u / cuts, t = (float)v / cuts, p[3];
+            for (int k = 0; k < 3; ++k) {
+                p[k] = (1 - s) * (1 - t) * quad[0][k] + s * (1 - t) * quad[1][k] + s * t * quad[2][k] + (1 - s) * t * quad[3][k];
+            }
+            snap.items.push_back(make_item((int)snap.items.size(), p[0], p[1], p[2]));
+        }
+    }
+    for (int v = 0; v < cuts; ++v) {
+        for (int u = 0; u < cuts; ++u) {
+            uint32_t a = v * (cuts + 1) + u, b = a + 1, c = b + cuts + 1, d = a + cuts + 1;
+            snap.indexed.push_back({a, b, c});
+            snap.indexed.push_back({a, c, d});
+        }
+    }
+    // The block holding the quad is never culled, fill it up first
+    while (snap.items.size() < OcclusionCuller::BLOCK) {
+        snap.items.push_back(make_item((int)snap.items.size(), 0.0f, -50.0f, -1.0f));
+    }
+    // Floor at z = -1, x in [-30, 30], y in [5, 45], one 32 x 32 patch of 2 x 2 units per block
+    const int patch = 32;
+    const float step = 2.0f / patch;
+    size_t patches = points / (patch * patch);
+    size_t across = 30;
+    for (size_t p = 0; p < patches; ++p) {
+        float x0 = -30.0f + 2.0f * (p % across), y0 = 5.0f + 2.0f * (p / across);
+        for (int v = 0; v < patch; ++v) {
+            for (int u = 0; u < patch; ++u) {
+                snap.items.push_back(make_item((int)snap.items.size(), x0 + u * step, y0 + v * step, -1.0f));
+            }
+        }
+    }
+    snap.max_id = (int)snap.items.size() - 1;
+    return snap;
+}
+
+static bool run(const char* name, const float quad[4][3], int cuts, size_t points) {
+    SceneSnapshot snap = make_scene(quad, cuts, points);
+    OcclusionCuller culler;
+    culler.set_verify(true);
+    culler.cull(snap, make_projection_params(snap.camera), make_clip_volume(snap.camera));
+    const OcclusionStats& s = culler.get_stats();
+    bool ok = s.visible_but_culled == 0;
+    std::printf("%-6s %zu occluder parts, coverage %.3f, %zu of %zu blocks culled, %zu vertices verified: "
+                "%zu visible but culled, %zu hidden but drawn%s\n",
+                name, s.occluder_triangles, s.coverage, s.boxes_culled, s.boxes_tested, s.verified_points,
+                s.visible_but_culled, s.hidden_but_drawn, ok ? "" : "  FAILED");
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    size_t points = 600000;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--points") == 0 && i + 1 < argc) points = std::strtoull(argv[++i], nullptr, 10);
+    }
+
+    // 2 below the eye, far edge from x = -6 to 6 at y = 6: its middle sags about 5 degrees
+    const float table[4][3] = {{-4, 4, 0}, {4, 4, 0}, {6, 6, 0}, {-6, 6, 0}};
+    const float wall[4][3] = {{-8, 12, -1}, {8, 12, -1}, {8, 12, 4}, {-8, 12, 4}};
+    bool ok = run("table", table, 1, points);
+    ok &= run("tiled", table, 8, points);
+    ok &= run("wall", wall, 1, points);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+// Particle system throughput (src/particles/particle_system.h).
+//
+//   particle_bench [--particles N] [--frames N]
+//
+// Fills one emitter to about N live particles (default 1M), then runs --frames updates of
+// 1/60 s and reports the update time and the time to project all live particles with the
+// renderer's batch kernel, per frame. Both together are the CPU cost of the effect.
+#include "particles/particle_system.h"
+#include "renderer/projection.h"
+#include "jobs/job_system.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void report(const char* name, std::vector<double>& times) {
+    std::sort(times.begin(), times.end());
+    double sum = 0.0;
+    for (double t : times) sum += t;
+    std::printf("%-8s mean %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", name, sum / times.size(),
+                times[times.size() / 2], times[times.size() * 99 / 100], times.back());
+}
+
+int main(int argc, char* argv[]) {
+    size_t particles = 1000000, frames = 300;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--particles") == 0 && i + 1 < argc) particles = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = std::strtoull(argv[++i], nullptr, 10);
+    }
+    if (particles == 0 || frames == 0) return 1;
+
+    const float dt = 1.0f / 60.0f;
+    EmitterDesc desc;
+    desc.origin[1] = 60.0f;
+    desc.extent[0] = desc.extent[2] = 20.0f;
+    desc.extent[1] = 5.0f;
+    desc.velocity[2] = 4.0f;
+    desc.velocity_jitter[0] = desc.velocity_jitter[1] = desc.velocity_jitter[2] = 6.0f;
+    desc.lifetime = 2.0f;
+    desc.rate = particles / desc.lifetime;
+    desc.max_particles = particles;
+    ParticleSystem system;
+    system.add_emitter(desc);
+    std::printf("%zu particles, %d job threads\n", particles, JobSystem::global().get_worker_count());
+
+    // One lifetime to fill the pool, from then on every frame recycles a 120th of it
+    for (int i = 0; i < 120; ++i) system.update(dt);
+
+    CameraState camera;
+    camera.pos = {0.0f, 0.0f, 0.0f};
+    camera.orientation = {0.0f, 1.0f, 0.0f};
+    camera.fov_width_deg = 0.04f;
+    camera.fov_height_deg = 0.03f;
+    ProjectionParams params = make_projection_params(camera);
+    std::vector<float> nx(particles), ny(particles);
+
+    std::vector<double> update_ms, project_ms;
+    size_t live = 0;
+    std::vector<std::shared_ptr<const ParticleFrame>> captured;
+    for (size_t f = 0; f < frames; ++f) {
+        auto start = Clock::now();
+        system.update(dt);
+        update_ms.push_back(ms_since(start));
+        captured.clear();
+        system.capture(captured);
+        start = Clock::now();
+        for (const auto& frame : captured) {
+            JobSystem::global().parallel_for("bench_project", 0, frame->count, [&](size_t b, size_t e) {
+                project_batch(params, &frame->x[b], &frame->y[b], &frame->z[b], e - b, &nx[b], &ny[b]);
+            }, 16384);
+        }
+        project_ms.push_back(ms_since(start));
+        live += system.get_live_count();
+    }
+    std::printf("%zu live on average\n", live / frames);
+    report("update", update_ms);
+    report("project", project_ms);
+    return 0;
+}
@@ -0,0 +1,39 @@
+// Converts a PLY or XYZ point cloud into a page file for the display's --point-cloud.
+//
+//   pc_import INPUT [OUTPUT] [--page-points N] [--memory-mb N]
+//
+// OUTPUT defaults to INPUT.vbdpc, which is also where the display looks when it is started
+// with the original file. See src/pointcloud/point_cloud_import.h for the formats.
+#include "pointcloud/point_cloud_import.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    pointcloud::ImportSettings settings;
+    std::string input, output;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--page-points") == 0 && i + 1 < argc) settings.page_points = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--memory-mb") == 0 && i + 1 < argc) settings.memory_bytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+        else if (argv[i][0] != '-' && input.empty()) input = argv[i];
+        else if (argv[i][0] != '-' && output.empty()) output = argv[i];
+        else {
+            input.clear();
+            break;
+        }
+    }
+    if (input.empty()) {
+        std::printf("usage: %s INPUT [OUTPUT] [--page-points N] [--memory-mb N]\n", argv[0]);
+        return 1;
+    }
+    if (output.empty()) output = input + ".vbdpc";
+    try {
+        pointcloud::import_point_cloud(input, output, settings);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+// Sleep and wake of dynamic bodies (src/physics_engine/body_simulation.h).
+//
+//   physics_check [--bodies N]
+//
+// Scatters N dynamic circles (default 10000) with random velocities next to one kinematic
+// circle, steps at 1/60 s until damping has put every dynamic body to sleep, and checks that
+// the active set shrank to the kinematic one. Then wakes one sleeper with wake(), one with
+// set_velocity() and one by steering the kinematic circle into it, and checks that each
+// comes back into the active set, that the contact pushed the sleeper along and that all of
+// them fall asleep again. Exit code 1 if a check failed. Also reports the step time
+// while everything moves and while everything sleeps.
+#include "physics_engine/body_simulation.h"
+#include "scene/object_list.h"
+#include "shapes/circle.h"
+#include "jobs/job_system.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const float STEP = 1.0f / 60.0f;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool check(bool ok, const char* what) {
+    std::printf("%-58s %s\n", what, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// Steps until pred holds, at most max_steps; false if it never did.
+template <typename Pred>
+static bool step_until(BodySimulation& bodies, ObjectList& list, size_t max_steps, Pred pred) {
+    for (size_t i = 0; i < max_steps; ++i) {
+        bodies.step(list, STEP);
+        if (pred()) return true;
+    }
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = 10000;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--bodies") == 0 && i + 1 < argc) count = std::strtoull(argv[++i], nullptr, 10);
+    }
+    if (count < 2) return 1;
+
+    // Far apart (radius 1 on a 10 unit grid), so nothing touches until the kinematic circle moves
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> speed(-5.0f, 5.0f);
+    size_t side = (size_t)std::ceil(std::sqrt((double)count));
+    std::vector<std::shared_ptr<Circle>> circles;
+    for (size_t i = 0; i < count; ++i) {
+        float x = 10.0f * (i % side), y = 10.0f * (i / side);
+        auto c = std::make_shared<Circle>(std::vector<float>{x, y, 0}, std::vector<float>{0, 0, 0},
+                                          std::vector<float>{1, 1, 1}, 1.0f, 255, 255, 255);
+        c->set_body_type(BODY_DYNAMIC);
+        c->set_velocity(speed(rng), speed(rng), 0.0f);
+        circles.push_back(c);
+    }
+    auto mover = std::make_shared<Circle>(std::vector<float>{-100, -100, 0}, std::vector<float>{0, 0, 0},
+                                          std::vector<float>{1, 1, 1}, 2.0f, 255, 0, 0);
+    mover->set_body_type(BODY_KINEMATIC);
+
+    ObjectList list;
+    for (const auto& c : circles) list.attach(c.get());
+    list.attach(mover.get());
+    BodySimulation bodies;
+
+    bool ok = true;
+    ok &= check(list.get_active().size() == count + 1, "all bodies start in the active set");
+
+    // ln(5 / SLEEP_SPEED) / LINEAR_DAMPING ~ 9.2 s to slow down, then SLEEP_SECONDS at rest
+    auto start = Clock::now();
+    bodies.step(list, STEP);
+    double moving_ms = ms_since(start);
+    bool slept = step_until(bodies, list, 60 * 30, [&] { return list.get_active().size() == 1; });
+    ok &= check(slept, "every dynamic body falls asleep");
+    ok &= check(list.get_active().size() == 1 && list.get_active()[0] == mover.get(),
+                "only the kinematic body stays active");
+    start = Clock::now();
+    bodies.step(list, STEP);
+    double asleep_ms = ms_since(start);
+    if (!ok) return 1;
+
+    // wake(): back in the active set, and asleep again since nothing moves it
+    Circle* woken = circles[0].get();
+    woken->wake();
+    ok &= check(!woken->is_sleeping() && list.get_active().size() == 2, "wake() brings the body back");
+    ok &= check(step_until(bodies, list, 60 * 2, [&] { return woken->is_sleeping(); }),
+                "a woken body at rest sleeps again");
+
+    // set_velocity(): wakes and moves
+    Circle* kicked = circles[1].get();
+    float before = kicked->get_coords()[0];
+    kicked->set_velocity(3.0f, 0.0f, 0.0f);
+    ok &= check(!kicked->is_sleeping() && list.get_active().size() == 2, "set_velocity() brings the body back");
+    bodies.step(list, STEP);
+    ok &= check(kicked->get_coords()[0] > before, "the kicked body moves");
+    ok &= check(step_until(bodies, list, 60 * 30, [&] { return kicked->is_sleeping(); }),
+                "the kicked body sleeps again");
+
+    // Contact: the kinematic circle starts 20 units below the target and moves up into it
+    Circle* target = circles[side / 2].get();
+    const std::vector<float>& p = target->get_coords();
+    mover->move_to(p[0], p[1] - 20.0f, p[2]);
+    mover->set_velocity(0.0f, 30.0f, 0.0f);
+    float target_y = p[1];
+    bool touched = step_until(bodies, list, 60 * 2, [&] { return !target->is_sleeping(); });
+    ok &= check(touched, "a moving body wakes the sleeper it touches");
+    ok &= check(list.get_active().size() == 2, "only the touched body wakes");
+    ok &= check(target->get_velocity()[1] > 0.0f, "the woken body is pushed along");
+    mover->set_velocity(0.0f, 0.0f, 0.0f);
+    bodies.step(list, STEP);
+    ok &= check(target->get_coords()[1] > target_y, "the pushed body moves");
+    ok &= check(step_until(bodies, list, 60 * 30, [&] { return target->is_sleeping(); }),
+                "the pushed body sleeps again");
+    ok &= check(list.get_active().size() == 1, "the active set is back to the kinematic body");
+
+    std::printf("%zu bodies, %d workers: step %.3f ms while moving, %.3f ms while asleep\n",
+                count, JobSystem::global().get_worker_count(), moving_ms, asleep_ms);
+    return ok ? 0 : 1;
+}
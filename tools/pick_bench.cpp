@@ -0,0 +1,136 @@
+// Picking latency on a large triangle mesh (src/picking/bvh.h).
+//
+//   pick_bench [--triangles N] [--rays N] [--verify N]
+//
+// Builds a height field of about N triangles (default 10M), then casts --rays random picks
+// through the camera model and reports build, refit and per query times. --verify compares
+// the first N picks against a brute force loop over every triangle.
+#include "picking/bvh.h"
+#include "renderer/projection.h"
+#include "jobs/job_system.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static float height(float x, float y) {
+    return 2.0f * std::sin(x * 0.05f) * std::cos(y * 0.07f) + 0.5f * std::sin(x * 0.31f + y * 0.17f);
+}
+
+// Nearest triangle hit, every triangle tested
+static float brute_force(const std::vector<Bvh::Prim>& prims, const std::vector<float>& pos, const float o[3], const float d[3]) {
+    float best = INFINITY;
+    for (const auto& p : prims) {
+        const float* a = &pos[3 * (size_t)p.v[0]];
+        const float* b = &pos[3 * (size_t)p.v[1]];
+        const float* c = &pos[3 * (size_t)p.v[2]];
+        float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]}, e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        float pv[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+        float det = e1[0] * pv[0] + e1[1] * pv[1] + e1[2] * pv[2];
+        if (std::fabs(det) < 1e-12f) continue;
+        float tv[3] = {o[0] - a[0], o[1] - a[1], o[2] - a[2]};
+        float u = (tv[0] * pv[0] + tv[1] * pv[1] + tv[2] * pv[2]) / det;
+        if (u < 0.0f || u > 1.0f) continue;
+        float qv[3] = {tv[1] * e1[2] - tv[2] * e1[1], tv[2] * e1[0] - tv[0] * e1[2], tv[0] * e1[1] - tv[1] * e1[0]};
+        float v = (d[0] * qv[0] + d[1] * qv[1] + d[2] * qv[2]) / det;
+        if (v < 0.0f || u + v > 1.0f) continue;
+        float t = (e2[0] * qv[0] + e2[1] * qv[1] + e2[2] * qv[2]) / det;
+        if (t > 0.0f && t < best) best = t;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    size_t triangles = 10000000, rays = 10000, verify = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) triangles = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--rays") == 0 && i + 1 < argc) rays = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--verify") == 0 && i + 1 < argc) verify = std::strtoull(argv[++i], nullptr, 10);
+    }
+
+    // Grid of g x g vertices, two triangles per cell, one unit apart
+    size_t g = (size_t)std::sqrt(triangles / 2.0) + 1;
+    std::vector<float> positions(3 * g * g);
+    for (size_t y = 0; y < g; ++y) {
+        for (size_t x = 0; x < g; ++x) {
+            float* p = &positions[3 * (y * g + x)];
+            p[0] = (float)x;
+            p[1] = (float)y;
+            p[2] = height((float)x, (float)y);
+        }
+    }
+    std::vector<Bvh::Prim> prims;
+    prims.reserve(2 * (g - 1) * (g - 1));
+    for (uint32_t y = 0; y + 1 < g; ++y) {
+        for (uint32_t x = 0; x + 1 < g; ++x) {
+            uint32_t a = y * (uint32_t)g + x, b = a + 1, c = a + (uint32_t)g, d = c + 1;
+            prims.push_back({{a, b, d}, -1});
+            prims.push_back({{a, d, c}, -1});
+        }
+    }
+    std::printf("%zu triangles, %zu vertices, %d job threads\n", prims.size(), g * g, JobSystem::global().get_worker_count());
+    std::vector<Bvh::Prim> reference;
+    if (verify) reference = prims;
+
+    Bvh bvh;
+    auto start = Clock::now();
+    bvh.build(Bvh::TRIANGLES, std::move(prims), positions.data());
+    std::printf("build   %9.1f ms, %zu nodes\n", ms_since(start), bvh.get_node_count());
+    float built_area = bvh.get_surface_area();
+
+    // Camera over the middle of the field looking ahead and down
+    CameraState camera;
+    camera.pos = {g * 0.5f, g * 0.1f, 40.0f};
+    camera.orientation = {0.0f, 1.0f, -0.35f};
+    camera.fov_width_deg = 0.09f;
+    camera.fov_height_deg = 0.07f;
+    ProjectionParams params = make_projection_params(camera);
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> ndc(-1.0f, 1.0f);
+    auto run = [&](const char* name, size_t count, bool check) {
+        std::vector<double> times;
+        size_t hits = 0, mismatches = 0;
+        for (size_t i = 0; i < count; ++i) {
+            float dir[3];
+            unproject_ndc(params, ndc(rng), ndc(rng), dir);
+            Bvh::Hit hit;
+            auto t0 = Clock::now();
+            bool found = bvh.intersect(positions.data(), params.cam_pos, dir, 0.0f, hit);
+            times.push_back(ms_since(t0));
+            hits += found;
+            if (check) {
+                float expected = brute_force(reference, positions, params.cam_pos, dir);
+                bool same = found ? std::fabs(expected - hit.t) <= 1e-3f * expected : std::isinf(expected);
+                mismatches += !same;
+            }
+        }
+        std::sort(times.begin(), times.end());
+        double sum = 0.0;
+        for (double t : times) sum += t;
+        std::printf("%-7s %zu rays, %zu hits: mean %.4f ms, p50 %.4f ms, p99 %.4f ms, max %.4f ms", name, count, hits,
+                    sum / count, times[count / 2], times[count * 99 / 100], times.back());
+        if (check) std::printf(", %zu differ from brute force", mismatches);
+        std::printf("\n");
+    };
+    if (rays) run("query", rays, false);
+    if (verify) run("verify", verify, true);
+
+    // Everything moves: refit, the query cost after it, and how much looser the boxes got
+    for (size_t i = 0; i < g * g; ++i) positions[3 * i + 2] += 0.3f * std::sin(positions[3 * i] * 0.2f);
+    start = Clock::now();
+    bvh.refit(positions.data());
+    std::printf("refit   %9.1f ms, root area x%.2f\n", ms_since(start), bvh.get_surface_area() / built_area);
+    if (rays) run("refit", rays, false);
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Accuracy and throughput of the SIMD projection kernels (src/renderer/projection_simd.cpp).
+//
+//   projection_bench [--points N] [--runs N]
+//
+// Projects N random points (default 4M) around a camera with every kernel the CPU has and
+// compares each result with the scalar project_point. Fails (exit code 1) when a kernel is
+// off by more than the documented bound, 7.2e-4 degrees, plus the float rounding of an angle
+// around 180 degrees. Then reports points per second of each kernel and of the scalar
+// reference, best of --runs, single threaded.
+#include "renderer/projection.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    size_t points = 4000000, runs = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--points") == 0 && i + 1 < argc) points = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) runs = std::strtoull(argv[++i], nullptr, 10);
+    }
+    if (points == 0 || runs == 0) return 1;
+
+    // Away from the origin and turned, so no axis is special
+    CameraState camera;
+    camera.pos = {1.5f, -2.0f, 0.5f};
+    camera.orientation = {0.3f, 1.0f, 0.2f};
+    camera.fov_width_deg = 0.04f;
+    camera.fov_height_deg = 0.03f;
+    ProjectionParams params = make_projection_params(camera);
+
+    // All around the camera, 1 to 1000 units away
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f), dist(1.0f, 1000.0f);
+    std::vector<float> x(points), y(points), z(points);
+    for (size_t i = 0; i < points; ++i) {
+        float d[3], len;
+        do {
+            d[0] = unit(rng); d[1] = unit(rng); d[2] = unit(rng);
+            len = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        } while (len < 0.1f || len > 1.0f);
+        float r = dist(rng) / len;
+        x[i] = params.cam_pos[0] + d[0] * r;
+        y[i] = params.cam_pos[1] + d[1] * r;
+        z[i] = params.cam_pos[2] + d[2] * r;
+    }
+
+    std::vector<float> ref_x(points), ref_y(points), out_x(points), out_y(points);
+    double scalar_ms = INFINITY;
+    for (size_t run = 0; run < runs; ++run) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < points; ++i) {
+            const float pos[3] = {x[i], y[i], z[i]};
+            std::array<float,2> ndc = project_point(params, pos);
+            ref_x[i] = ndc[0];
+            ref_y[i] = ndc[1];
+        }
+        scalar_ms = std::min(scalar_ms, ms_since(start));
+    }
+    std::printf("%zu points\n", points);
+    std::printf("%-8s %8.1f Mpoints/s\n", "scalar", points / scalar_ms / 1000.0);
+
+    const float bound_deg = 7.2e-4f + 2.0f * 180.0f * 1.2e-7f;
+    const float bound_x = bound_deg * std::fabs(params.scale_x), bound_y = bound_deg * std::fabs(params.scale_y);
+    const float wrap_x = 360.0f * std::fabs(params.scale_x);   // +-180 degrees may land on either side
+    bool failed = false;
+    for (int k = 0; k < KERNEL_COUNT; ++k) {
+        ProjectionKernel kernel = (ProjectionKernel)k;
+        double best_ms = INFINITY;
+        bool available = true;
+        for (size_t run = 0; run < runs && available; ++run) {
+            auto start = Clock::now();
+            available = project_batch_with(kernel, params, x.data(), y.data(), z.data(), points, out_x.data(), out_y.data());
+            best_ms = std::min(best_ms, ms_since(start));
+        }
+        if (!available) {
+            std::printf("%-8s not supported\n", projection_kernel_name(kernel));
+            continue;
+        }
+        float max_x = 0.0f, max_y = 0.0f;
+        for (size_t i = 0; i < points; ++i) {
+            float ex = std::fabs(out_x[i] - ref_x[i]);
+            ex = std::min(ex, std::fabs(ex - wrap_x));
+            max_x = std::max(max_x, ex);
+            max_y = std::max(max_y, std::fabs(out_y[i] - ref_y[i]));
+        }
+        bool ok = max_x <= bound_x && max_y <= bound_y;
+        failed |= !ok;
+        std::printf("%-8s %8.1f Mpoints/s, max error %.2e / %.2e NDC (bound %.2e / %.2e)%s\n",
+                    projection_kernel_name(kernel), points / best_ms / 1000.0, max_x, max_y, bound_x, bound_y,
+                    ok ? "" : "  FAILED");
+    }
+    return failed ? 1 : 0;
+}
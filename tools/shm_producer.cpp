@@ -0,0 +1,126 @@
+// Test producer for the display's shared memory ingest (src/ingest/shm_ring.h).
+//
+//   shm_producer [--name vbd_ingest] [--points N | --pixels WxH] [--fps 60] [--frames 0] [--bench]
+//
+// Writes an animated point cloud in front of the default camera or an animated RGBA
+// gradient. Start the display with --ingest <name>. With --bench the producer also reads the
+// presentation reports the display writes back after each swap and prints the write ->
+// swap latency distribution once per second.
+#include "ingest/shm_ring.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static void write_points(shm::PointRecord* out, uint32_t count, uint64_t frame) {
+    // Rotating spiral 10 units ahead of the camera (it looks along +y)
+    float t = frame * 0.02f;
+    for (uint32_t i = 0; i < count; ++i) {
+        float u = (float)i / count;
+        float a = u * 40.0f + t;
+        float r = 0.3f + 1.5f * u;
+        out[i].pos[0] = r * std::cos(a);
+        out[i].pos[1] = 10.0f;
+        out[i].pos[2] = r * std::sin(a);
+        out[i].color[0] = (uint8_t)(255 * u);
+        out[i].color[1] = (uint8_t)(128 + 127 * std::sin(a));
+        out[i].color[2] = 255;
+        out[i].color[3] = 255;
+    }
+}
+
+static void write_pixels(uint8_t* out, uint32_t width, uint32_t height, uint32_t stride, uint64_t frame) {
+    for (uint32_t y = 0; y < height; ++y) {
+        uint8_t* row = out + (size_t)y * stride;
+        for (uint32_t x = 0; x < width; ++x) {
+            row[x * 4 + 0] = (uint8_t)(x + frame);
+            row[x * 4 + 1] = (uint8_t)(y + frame * 2);
+            row[x * 4 + 2] = (uint8_t)((x ^ y) + frame);
+            row[x * 4 + 3] = 255;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const char* name = "vbd_ingest";
+    uint32_t points = 100000, width = 0, height = 0;
+    double fps = 60.0;
+    uint64_t frames = 0; // 0 = run until killed
+    bool bench = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--name") == 0 && i + 1 < argc) name = argv[++i];
+        else if (std::strcmp(argv[i], "--points") == 0 && i + 1 < argc) points = (uint32_t)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--pixels") == 0 && i + 1 < argc) std::sscanf(argv[++i], "%ux%u", &width, &height);
+        else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) fps = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--bench") == 0) bench = true;
+        else {
+            std::printf("usage: %s [--name N] [--points N | --pixels WxH] [--fps F] [--frames N] [--bench]\n", argv[0]);
+            return 1;
+        }
+    }
+    const bool pixels = width > 0 && height > 0;
+    const uint32_t stride = width * 4;
+    size_t slot_bytes = pixels ? (size_t)stride * height : (size_t)points * sizeof(shm::PointRecord);
+
+    // 3 slots: the display reads one while the producer writes another
+    auto ring = ShmRing::create(name, 3, slot_bytes);
+    if (!ring) return 1;
+    std::printf("Producing %s into '%s' at %.1f fps\n", pixels ? "pixels" : "points", name, fps);
+
+    const auto period = std::chrono::nanoseconds((int64_t)(1.0e9 / fps));
+    auto next = std::chrono::steady_clock::now();
+    uint64_t last_presented = 0;
+    std::vector<double> latencies;
+    uint64_t report_at = ShmRing::now_ns() + 1000000000ull;
+
+    for (uint64_t frame = 0; frames == 0 || frame < frames; ++frame) {
+        void* payload = ring->begin_write(frame);
+        shm::FrameInfo info;
+        if (pixels) {
+            write_pixels(static_cast<uint8_t*>(payload), width, height, stride, frame);
+            info.type = shm::PAYLOAD_PIXELS;
+            info.width = width;
+            info.height = height;
+            info.stride = stride;
+        } else {
+            write_points(static_cast<shm::PointRecord*>(payload), points, frame);
+            info.type = shm::PAYLOAD_POINTS;
+            info.count = points;
+        }
+        ring->end_write(frame, info);
+
+        next += period;
+        // Collect presentation reports while waiting for the next frame
+        do {
+            if (bench) {
+                shm::RingHeader& h = ring->get_header();
+                uint64_t presented = h.presented_frame.load(std::memory_order_acquire);
+                if (presented != last_presented) {
+                    uint64_t write_ns = h.presented_write_ns.load(std::memory_order_relaxed);
+                    uint64_t shown_ns = h.presented_ns.load(std::memory_order_relaxed);
+                    if (h.presented_frame.load(std::memory_order_acquire) == presented && shown_ns > write_ns) {
+                        latencies.push_back((shown_ns - write_ns) / 1.0e6);
+                    }
+                    last_presented = presented;
+                }
+                if (ShmRing::now_ns() >= report_at && !latencies.empty()) {
+                    std::sort(latencies.begin(), latencies.end());
+                    double sum = 0.0;
+                    for (double l : latencies) sum += l;
+                    std::printf("write -> swap latency over %zu frames: mean %.2f ms, p50 %.2f, p99 %.2f, max %.2f\n",
+                                latencies.size(), sum / latencies.size(), latencies[latencies.size() / 2],
+                                latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)], latencies.back());
+                    latencies.clear();
+                    report_at = ShmRing::now_ns() + 1000000000ull;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(bench ? 200 : 1000));
+        } while (std::chrono::steady_clock::now() < next);
+    }
+    return 0;
+}